@@ -1,10 +1,15 @@
 #version 450
 layout (location=0) in vec3 vPos;
 
-uniform mat4 _LightSpaceMatrix;
+layout(std140, binding = 1) uniform PassData {
+	mat4 _ViewProjection; //Light space for the shadow pass
+};
 uniform mat4 _Model;
 
+//Must match lit.vert bit for bit when used as the depth prepass
+invariant gl_Position;
+
 void main()
 {
-	gl_Position = _LightSpaceMatrix * _Model * vec4(vPos, 1.0);
+	gl_Position = _ViewProjection * _Model * vec4(vPos, 1.0);
 }
\ No newline at end of file
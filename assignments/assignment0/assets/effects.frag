@@ -1,12 +1,15 @@
 #version 450
+//Kernel chosen at compile time by ShaderVariants: 0 = blur, 1 = sharpen
+#ifndef POST_EFFECT
+#define POST_EFFECT 1
+#endif
+
 out vec4 FragColor;
 in vec2 UV;
 
 uniform sampler2D _HDRTexture;
 const float offset = 1.0 / 300.0;  
 
-uniform int _PostProcessEffect;
-
 const vec2 offsets[9] = vec2[](
         vec2(-offset,  offset), // top-left
         vec2( 0.0f,    offset), // top-center
@@ -19,17 +22,19 @@ const vec2 offsets[9] = vec2[](
         vec2( offset, -offset)  // bottom-right    
     );
 
-float sharpen[9] = float[](
+#if POST_EFFECT == 1
+const float kernel[9] = float[](
         -1, -1, -1,
         -1,  9, -1,
         -1, -1, -1
 );
-
-float blur[9] = float[](
+#else
+const float kernel[9] = float[](
     1.0 / 16, 2.0 / 16, 1.0 / 16,
     2.0 / 16, 4.0 / 16, 2.0 / 16,
     1.0 / 16, 2.0 / 16, 1.0 / 16  
 );
+#endif
 void main()
 {   
     vec3 sampleTex[9];
@@ -40,8 +45,7 @@ void main()
     vec3 col = vec3(0.0);
     for(int i = 0; i < 9; i++)
     {
-        float kernelValue = _PostProcessEffect == 1 ? sharpen[i] : blur[i];
-        col += sampleTex[i] * kernelValue;
+        col += sampleTex[i] * kernel[i];
     }
     FragColor = vec4(col, 1.0);
 }
\ No newline at end of file
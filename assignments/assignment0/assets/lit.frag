@@ -1,57 +1,137 @@
 #version 450
-out vec4 FragColor;
+//Compile-time features, set by ShaderVariants. Defaults match the original shader
+#ifndef SHADOWS
+#define SHADOWS 1
+#endif
+//Shadow map fetches per fragment, each one a hardware 2x2 bilinear comparison
+//0 = 1 tap, 1 = 4 tap bilinear PCF, 2 = 16 tap rotated Poisson disk, 3 = PCSS (16 blocker reads + 16 taps)
+//Lit pass time per tier comes from "tools/coreBench/shadowTiers.py bin/assignment0", which runs --headless --shadow-filter 0..3
+//and prints gpu.Lit.p50/p95 with the renderer in this format. Paste its output here for the GPU it was measured on
+#ifndef SHADOW_FILTER
+#define SHADOW_FILTER 1
+#endif
+//Sample _MainTex as an array, materials pick their layer with _TextureLayer
+#ifndef TEXTURE_ARRAY
+#define TEXTURE_ARRAY 0
+#endif
+
+layout(location = 0) out vec4 FragColor;
+layout(location = 1) out vec4 Motion; //Screen space motion in UV units, the upscaler only reads rg
 in Surface{
 	vec3 WorldPos; 
 	vec3 WorldNormal; 
 	vec2 TexCoord;
-	vec4 WorldPosLightSpace;
+	vec4 ClipPos;
+	vec4 PrevClipPos;
 }fs_in;
 
-uniform sampler2D _MainTex; 
-uniform sampler2D _ShadowMap;
+#if TEXTURE_ARRAY
+layout(binding = 0) uniform sampler2DArray _MainTex;
+uniform int _TextureLayer;
+#else
+layout(binding = 0) uniform sampler2D _MainTex; 
+#endif
+layout(binding = 2) uniform sampler2DArrayShadow _ShadowMap; //One layer per cascade
+#if SHADOW_FILTER == 3
+layout(binding = 3) uniform sampler2DArray _ShadowDepth; //The same layers without the comparison, for the blocker search
+#endif
+
+layout(std140, binding = 0) uniform FrameData {
+	mat4 _LightSpace[4]; //World to light clip space, one per shadow cascade
+	vec4 _CascadeSplits; //View depth each cascade ends at
+	vec3 _EyePos;
+	float _MinBias;
+	vec3 _LightDirection;
+	float _MaxBias;
+	vec3 _CameraForward;
+	int _NumCascades;
+};
 
-uniform vec3 _EyePos;
-uniform vec3 _LightDirection;
 uniform vec3 _LightColor = vec3(1.0);
 uniform vec3 _AmbientColor = vec3(0.3,0.4,0.46);
 
-struct Material{
+layout(std140, binding = 2) uniform MaterialData {
 	float Ka; //Ambient coefficient (0-1)
 	float Kd; //Diffuse coefficient (0-1)
 	float Ks; //Specular coefficient (0-1)
 	float Shininess; //Affects size of specular highlight
-};
-uniform Material _Material;
+}_Material;
+
+#if SHADOWS
+#if SHADOW_FILTER >= 2
+const vec2 POISSON_DISK[16] = vec2[](
+	vec2(-0.94201624, -0.39906216), vec2(0.94558609, -0.76890725), vec2(-0.09418410, -0.92938870), vec2(0.34495938, 0.29387760),
+	vec2(-0.91588581, 0.45771432), vec2(-0.81544232, -0.87912464), vec2(-0.38277543, 0.27676845), vec2(0.97484398, 0.75648379),
+	vec2(0.44323325, -0.97511554), vec2(0.53742981, -0.47373420), vec2(-0.26496911, -0.41893023), vec2(0.79197514, 0.19090188),
+	vec2(-0.24188840, 0.99706507), vec2(-0.81409955, 0.91437590), vec2(0.19984126, 0.78641367), vec2(0.14383161, -0.14100790)
+);
+const float POISSON_RADIUS = 2.0; //In shadow texels
+#endif
+#if SHADOW_FILTER == 3
+const float BLOCKER_SEARCH_RADIUS = 8.0; //In shadow texels
+const float LIGHT_SIZE = 400.0; //Penumbra texels per unit of light space depth between blocker and receiver
+const float MAX_PENUMBRA = 12.0; //In shadow texels
+#endif
 
-uniform float _MinBias = 0.005;
-uniform float _MaxBias = 0.05;
+//Fraction of the light that is blocked. Every texture() on _ShadowMap compares against depth in hardware
+float CalculateShadow(vec3 worldPos, vec3 normal){
+	//The first cascade whose slice of the view the fragment is in, past the last one nothing is shadowed
+	float viewDepth = dot(worldPos - _EyePos, _CameraForward);
+	int cascade = 0;
+	while (cascade < _NumCascades && viewDepth > _CascadeSplits[cascade])
+		cascade++;
+	if (cascade >= _NumCascades)
+		return 0.0;
 
-float CalculateShadow(vec4 lightSpacePosition){
+	vec4 lightSpacePosition = _LightSpace[cascade] * vec4(worldPos, 1.0);
 	vec3 projection = lightSpacePosition.xyz / lightSpacePosition.w;
 	projection = projection * 0.5 + 0.5;
 
-	float closestDepth = texture(_ShadowMap, projection.xy).r;
-	float currentDepth = projection.z;
-
-	//float shadow = currentDepth - bias > closestDepth ? 1.0 : 0.0;
-	
-	float bias = max(_MaxBias * (1.0 - dot(fs_in.WorldNormal, _LightDirection)), _MinBias);
+	//Surfaces facing away from the light need more bias
+	float bias = max(_MaxBias * (1.0 - dot(normal, -normalize(_LightDirection))), _MinBias);
+	float reference = projection.z - bias;
+	vec2 texelSize = 1.0 / vec2(textureSize(_ShadowMap, 0).xy);
 
-	float shadow = 0.0;
-
-	vec2 texelSize = 1.0 / textureSize(_ShadowMap, 0);
-	for (int x = -1; x <= 1; ++x)
+#if SHADOW_FILTER == 0
+	return 1.0 - texture(_ShadowMap, vec4(projection.xy, cascade, reference));
+#elif SHADOW_FILTER == 1
+	//Half a texel apart, so the four bilinear footprints tile a 3x3 tent
+	float lit = 0.0;
+	lit += texture(_ShadowMap, vec4(projection.xy + vec2(-0.5, -0.5) * texelSize, cascade, reference));
+	lit += texture(_ShadowMap, vec4(projection.xy + vec2(0.5, -0.5) * texelSize, cascade, reference));
+	lit += texture(_ShadowMap, vec4(projection.xy + vec2(-0.5, 0.5) * texelSize, cascade, reference));
+	lit += texture(_ShadowMap, vec4(projection.xy + vec2(0.5, 0.5) * texelSize, cascade, reference));
+	return 1.0 - lit * 0.25;
+#else
+	//Rotated per pixel so neighbouring pixels sample different points and the banding turns into noise
+	float angle = 6.28318531 * fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+	mat2 rotation = mat2(cos(angle), sin(angle), -sin(angle), cos(angle));
+	float radius = POISSON_RADIUS;
+#if SHADOW_FILTER == 3
+	//Blockers closer to the light than the receiver, averaged, give the penumbra width
+	float blockerDepth = 0.0;
+	float numBlockers = 0.0;
+	for (int i = 0; i < 16; i++)
 	{
-		for (int y = -1; y <= 1; ++y)
+		float depth = texture(_ShadowDepth, vec3(projection.xy + rotation * POISSON_DISK[i] * BLOCKER_SEARCH_RADIUS * texelSize, cascade)).r;
+		if (depth < reference)
 		{
-			float pcfDepth = texture(_ShadowMap, projection.xy + vec2(x,y) * texelSize).r;
-			shadow += currentDepth - bias > pcfDepth ? 1.0 : 0.0;
+			blockerDepth += depth;
+			numBlockers += 1.0;
 		}
 	}
-	shadow /= 9.0;
-
-	return shadow;
+	if (numBlockers == 0.0)
+		return 0.0;
+	blockerDepth /= numBlockers;
+	radius = clamp((reference - blockerDepth) * LIGHT_SIZE, 1.0, MAX_PENUMBRA);
+#endif
+	float lit = 0.0;
+	for (int i = 0; i < 16; i++)
+		lit += texture(_ShadowMap, vec4(projection.xy + rotation * POISSON_DISK[i] * radius * texelSize, cascade, reference));
+	return 1.0 - lit / 16.0;
+#endif
 }
+#endif
 
 void main(){
 	vec3 normal = normalize(fs_in.WorldNormal);
@@ -62,10 +142,21 @@ void main(){
 
 	float specularFactor = pow(max(dot(normal,h),0.0),_Material.Shininess);
 
-	float shadow = CalculateShadow(fs_in.WorldPosLightSpace);
+#if SHADOWS
+	float shadow = CalculateShadow(fs_in.WorldPos, normal);
+#else
+	float shadow = 0.0;
+#endif
 
 	vec3 lightColor = ((_AmbientColor * _Material.Ka) + (1.0 - shadow) * (_Material.Kd * diffuseFactor + _Material.Ks * specularFactor)) * _LightColor;
 
+#if TEXTURE_ARRAY
+	vec3 objectColor = texture(_MainTex,vec3(fs_in.TexCoord,_TextureLayer)).rgb;
+#else
 	vec3 objectColor = texture(_MainTex,fs_in.TexCoord).rgb;
+#endif
 	FragColor = vec4(objectColor * lightColor,1.0);
+
+	//Alpha of 1 so blending passes it through unchanged
+	Motion = vec4((fs_in.ClipPos.xy / fs_in.ClipPos.w - fs_in.PrevClipPos.xy / fs_in.PrevClipPos.w) * 0.5, 0.0, 1.0);
 }
@@ -5,16 +5,35 @@ layout(location = 1) in vec3 vNormal;
 layout(location = 2) in vec2 vTexCoord;
 
 uniform mat4 _Model; 
-uniform mat4 _ViewProjection;
-uniform mat4 _LightSpace;
+
+layout(std140, binding = 0) uniform FrameData {
+	mat4 _LightSpace[4]; //World to light clip space, one per shadow cascade
+	vec4 _CascadeSplits; //View depth each cascade ends at
+	vec3 _EyePos;
+	float _MinBias;
+	vec3 _LightDirection;
+	float _MaxBias;
+	vec3 _CameraForward;
+	int _NumCascades;
+};
+
+layout(std140, binding = 1) uniform PassData {
+	mat4 _ViewProjection; //Jittered when upscaling
+	mat4 _UnjitteredViewProjection;
+	mat4 _PrevViewProjection; //Last frame's, unjittered
+};
 
 out Surface{
 	vec3 WorldPos; //Vertex position in world space
 	vec3 WorldNormal; //Vertex normal in world space
 	vec2 TexCoord;
-	vec4 WorldPosLightSpace; //Vertex position in light space for shadows
+	vec4 ClipPos; //Unjittered, this frame and last, for motion vectors
+	vec4 PrevClipPos;
 }vs_out;
 
+//The depth prepass computes the same expression in depthShader.vert, the lit pass tests against it with GL_EQUAL
+invariant gl_Position;
+
 void main(){
 	//Transform vertex position to World Space.
 	vs_out.WorldPos = vec3(_Model * vec4(vPos,1.0));
@@ -23,7 +42,9 @@ void main(){
 	vs_out.WorldNormal = transpose(inverse(mat3(_Model))) * vNormal;
 	vs_out.TexCoord = vTexCoord;
 
-	vs_out.WorldPosLightSpace = _LightSpace * vec4(vs_out.WorldPos, 1.0);
+	//Only the camera's motion is tracked, objects are assumed to stay put between frames
+	vs_out.ClipPos = _UnjitteredViewProjection * vec4(vs_out.WorldPos, 1.0);
+	vs_out.PrevClipPos = _PrevViewProjection * vec4(vs_out.WorldPos, 1.0);
 
 	gl_Position = _ViewProjection * _Model * vec4(vPos,1.0);
 }
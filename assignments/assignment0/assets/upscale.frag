@@ -0,0 +1,47 @@
+#version 450
+out vec4 FragColor;
+in vec2 UV;
+
+layout(binding = 0) uniform sampler2D _SceneColor; //Only the bottom left _RenderScale of it is rendered
+layout(binding = 1) uniform sampler2D _Motion; //Current minus previous position, in UV units
+layout(binding = 2) uniform sampler2D _History; //Last frame's output, full resolution
+
+uniform vec2 _RenderScale;
+uniform vec2 _Jitter; //This frame's projection offset, in render pixels
+uniform float _HistoryWeight; //0 skips the history entirely
+
+void main()
+{
+    vec2 sceneSize = vec2(textureSize(_SceneColor, 0));
+    vec2 renderSize = sceneSize * _RenderScale;
+
+    //The jitter moved everything by _Jitter pixels, so the unjittered point under this pixel was rendered that far along
+    vec2 renderPos = UV * renderSize + _Jitter;
+    //Keep bilinear taps off the unrendered part of the texture
+    vec2 samplePos = clamp(renderPos, vec2(0.5), renderSize - 0.5);
+    vec3 current = texture(_SceneColor, samplePos / sceneSize).rgb;
+
+    //Whatever history survives has to look like something near this pixel now, or it's from an object that moved away
+    ivec2 center = ivec2(samplePos);
+    ivec2 maxTexel = ivec2(renderSize) - 1;
+    vec3 neighborhoodMin = current;
+    vec3 neighborhoodMax = current;
+    for (int x = -1; x <= 1; x++)
+    {
+        for (int y = -1; y <= 1; y++)
+        {
+            vec3 neighbor = texelFetch(_SceneColor, clamp(center + ivec2(x, y), ivec2(0), maxTexel), 0).rgb;
+            neighborhoodMin = min(neighborhoodMin, neighbor);
+            neighborhoodMax = max(neighborhoodMax, neighbor);
+        }
+    }
+
+    vec2 motion = texture(_Motion, samplePos / sceneSize).rg;
+    vec2 historyUV = UV - motion;
+    float weight = _HistoryWeight;
+    if (any(lessThan(historyUV, vec2(0.0))) || any(greaterThan(historyUV, vec2(1.0))))
+        weight = 0.0; //Came from off screen
+    vec3 history = clamp(texture(_History, historyUV).rgb, neighborhoodMin, neighborhoodMax);
+
+    FragColor = vec4(mix(current, history, weight), 1.0);
+}
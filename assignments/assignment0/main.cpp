@@ -1,6 +1,11 @@
 #include <stdio.h>
 #include <math.h>
+#include <stdlib.h>
 #include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
 
 #include <ew/external/glad.h>
 
@@ -22,9 +27,28 @@
 #include <ew/Framebuffer.h>
 #include <ew/Animation.h>
 #include <ew/FKSolver.h>
+#include <ew/GeometryArena.h>
+#include <ew/Terrain.h>
+#include <ew/UniformBuffer.h>
+#include <ew/ShaderVariants.h>
+#include <ew/ShaderReloader.h>
+#include <ew/GLState.h>
+#include <ew/RenderQueue.h>
+#include <ew/TextureRegistry.h>
+#include <ew/TextureStreamer.h>
+#include <ew/TextureArray.h>
+#include <ew/RenderTargetPool.h>
+#include <ew/RenderGraph.h>
+#include <ew/DynamicResolution.h>
+#include <ew/TemporalUpscaler.h>
+#include <ew/GpuProfiler.h>
+#include <ew/Trace.h>
+#include <ew/BenchmarkReport.h>
+#include <ew/CascadedShadowMap.h>
+#include <ew/SampleCounter.h>
 
 void framebufferSizeCallback(GLFWwindow* window, int width, int height);
-GLFWwindow* initWindow(const char* title, int width, int height);
+GLFWwindow* initWindow(const char* title, int width, int height, bool headless = false);
 void drawUI();
 
 //Global state
@@ -40,6 +64,49 @@ void resetCamera(ew::Camera* camera, ew::CameraController* controller)
 	controller->yaw = controller->pitch = 0;
 }
 
+// --headless [--frames N] [--warmup N] [--width W] [--height H] [--shadow-filter 0-3] [--depth-prepass 0|1] [--report path]
+// renders offscreen with a fixed timestep along a scripted camera path, then writes a JSON report
+struct HeadlessOptions
+{
+	bool enabled = false;
+	int frames = 600;
+	int warmupFrames = 60; // not measured, lets shader variants and texture streaming settle
+	int shadowFilter = -1; // -1 keeps the default, reports are compared per tier
+	int depthPrepass = -1; // same
+	std::string reportPath = "benchmark_report.json";
+};
+
+HeadlessOptions parseHeadlessOptions(int argc, char** argv)
+{
+	HeadlessOptions options;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--headless") options.enabled = true;
+		else if (arg == "--frames" && hasValue) options.frames = std::max(1, atoi(argv[++i]));
+		else if (arg == "--warmup" && hasValue) options.warmupFrames = std::max(0, atoi(argv[++i]));
+		else if (arg == "--width" && hasValue) screenWidth = std::max(1, atoi(argv[++i]));
+		else if (arg == "--height" && hasValue) screenHeight = std::max(1, atoi(argv[++i]));
+		else if (arg == "--shadow-filter" && hasValue) options.shadowFilter = std::max(0, std::min(3, atoi(argv[++i])));
+		else if (arg == "--depth-prepass" && hasValue) options.depthPrepass = atoi(argv[++i]) != 0 ? 1 : 0;
+		else if (arg == "--report" && hasValue) options.reportPath = argv[++i];
+		else printf("Unknown argument %s\n", arg.c_str());
+	}
+	return options;
+}
+
+/// <summary>
+/// One orbit around the monkey over t in [0, 1), dipping toward the floor and back so the shadow and terrain get close ups too.
+/// </summary>
+void followCameraPath(ew::Camera* camera, float t)
+{
+	float angle = t * 6.28318531f;
+	float radius = 6.0f - 2.5f * sinf(angle * 2.0f);
+	camera->position = glm::vec3(sinf(angle) * radius, 1.5f + 1.0f * cosf(angle * 3.0f), cosf(angle) * radius);
+	camera->target = glm::vec3(0.0f, -0.5f, 0.0f);
+}
+
 struct Material
 {
 	float Ambient = 1.0;
@@ -48,6 +115,35 @@ struct Material
 	float Shininess = 128;
 } material;
 
+// std140 mirrors of the uniform blocks in lit.vert / lit.frag / depthShader.vert
+struct FrameData // binding 0, once per frame
+{
+	glm::mat4 LightSpace[vg3o::MAX_SHADOW_CASCADES];
+	glm::vec4 CascadeSplits;
+	glm::vec3 EyePos;
+	float MinBias;
+	glm::vec3 LightDirection;
+	float MaxBias;
+	glm::vec3 CameraForward;
+	int NumCascades;
+};
+static_assert(sizeof(FrameData) == 320, "FrameData must match the std140 layout");
+
+struct PassData // binding 1, once per pass
+{
+	glm::mat4 ViewProjection;
+	glm::mat4 UnjitteredViewProjection;
+	glm::mat4 PrevViewProjection;
+};
+
+struct MaterialData // binding 2, once per material change
+{
+	float Ka;
+	float Kd;
+	float Ks;
+	float Shininess;
+};
+
 ew::CameraController cameraControl;
 ew::Camera camera;
 
@@ -59,12 +155,74 @@ glm::vec3 lightDirection = glm::vec3(0.0f, -1.0f, -0.2f);
 
 float maxBias = 0.005, minBias = 0.005;
 
-unsigned int depthTexture;
-
-
-
-int main() {
-	GLFWwindow* window = initWindow("Assignment 4", screenWidth, screenHeight);
+bool terrainEnabled = false;
+vg3o::TerrainStats terrainStats;
+
+ew::ShaderStats shaderStats; // GL calls made by the last frame
+unsigned int uniformBufferUpdates;
+
+bool shadowsEnabled = true;
+vg3o::CascadedShadowSettings shadowSettings;
+vg3o::ShadowCascadeStats shadowCascadeStats[vg3o::MAX_SHADOW_CASCADES]; // last frame
+unsigned int shadowLayerViews[vg3o::MAX_SHADOW_CASCADES];
+unsigned int numShadowCascades;
+int shadowPreviewCascade = 0;
+int shadowFilter = 1; // SHADOW_FILTER tier in lit.frag
+const char* const shadowFilterNames[4] = { "1 tap (1 fetch)", "Bilinear PCF (4 fetches)", "Poisson disk (16 fetches)", "PCSS (32 fetches)" };
+bool depthPrepassEnabled = false;
+unsigned long long prepassSamples, litSamples; // same frame, a few frames back
+float shadedPerPixel; // lit fragments per rendered pixel, background included
+float overdrawRatio; // fragments the lit pass would shade without the prepass per fragment it shades with it, 0 without the prepass
+bool textureArraysEnabled = true;
+vg3o::ShaderVariantStats litVariantStats;
+vg3o::ShaderReloader shaderReloader;
+vg3o::ShaderReloadStats shaderReloadStats;
+vg3o::GLStateStats glStateStats; // last frame
+vg3o::RenderQueueStats renderQueueStats; // last frame
+vg3o::RenderQueueStats sortBenchmarkStats;
+bool runSortBenchmark = false;
+vg3o::TextureRegistryStats textureRegistryStats;
+vg3o::TextureStreamerStats textureStreamerStats;
+vg3o::TextureArrayStats textureArrayStats;
+vg3o::RenderTargetPoolStats renderTargetStats;
+vg3o::RenderGraphStats renderGraphStats; // last frame
+bool printRenderGraph = false;
+vg3o::DynamicResolutionSettings dynamicResolutionSettings;
+bool temporalUpscaleEnabled = true;
+unsigned int renderWidth, renderHeight; // part of the scene target rendered this frame
+float gpuFrameMilliseconds;
+std::vector<float> resolutionScaleHistory;
+std::vector<float> gpuTimeHistory;
+int resolutionHistoryOffset = 0;
+vg3o::GpuProfilerStats gpuProfilerStats;
+std::vector<vg3o::GpuScopeStats> gpuScopes;
+std::string gpuRenderer;
+bool exportGpuTrace = false;
+int traceCaptureFrames = 60; // F12 or the button captures this many frames to cpu_trace.json
+bool startTraceCapture = false;
+bool runTraceBenchmark = false;
+vg3o::TraceStats traceStats;
+vg3o::TraceOverhead traceOverhead;
+
+enum RenderPass
+{
+	SHADOW_STATIC_PASS = 0, // + cascade, casters kept in the cache until something invalidates it
+	SHADOW_DYNAMIC_PASS = SHADOW_STATIC_PASS + vg3o::MAX_SHADOW_CASCADES, // + cascade, casters drawn every frame
+	DEPTH_PREPASS = SHADOW_DYNAMIC_PASS + vg3o::MAX_SHADOW_CASCADES, // camera depth only, so the lit pass shades each pixel once
+	MAIN_PASS = DEPTH_PREPASS + 1
+};
+
+
+
+int main(int argc, char** argv) {
+	HeadlessOptions headless = parseHeadlessOptions(argc, argv);
+	if (headless.shadowFilter >= 0)
+		shadowFilter = headless.shadowFilter;
+	if (headless.depthPrepass >= 0)
+		depthPrepassEnabled = headless.depthPrepass == 1;
+	GLFWwindow* window = initWindow("Assignment 4", screenWidth, screenHeight, headless.enabled);
+	if (window == nullptr)
+		return 1;
 	glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
 
 	vg3o::ScreenBuffer::genScreenQuad();
@@ -76,10 +234,42 @@ int main() {
 	
 	// shaders
 
-	ew::Shader shader = ew::Shader("assets/lit.vert", "assets/lit.frag");
+	vg3o::ShaderVariants litVariants("assets/lit.vert", "assets/lit.frag");
+	unsigned int shadowsFeature = litVariants.addFeature("SHADOWS");
+	unsigned int shadowFilterFeature = litVariants.addFeature("SHADOW_FILTER", 4);
+	unsigned int textureArrayFeature = litVariants.addFeature("TEXTURE_ARRAY");
+	unsigned int litFallback = litVariants.setFeature(0, shadowsFeature, 1);
+	litFallback = litVariants.setFeature(litFallback, shadowFilterFeature, 1);
+	litFallback = litVariants.setFeature(litFallback, textureArrayFeature, 1);
+	litVariants.setFallback(litFallback);
+
 	ew::Shader depthShader = ew::Shader("assets/depthShader.vert", "assets/empty.frag");
 	ew::Shader screenShader = ew::Shader("assets/screen.vert", "assets/screen.frag");
-	ew::Shader postShader = ew::Shader("assets/screen.vert", "assets/effects.frag");
+	ew::Shader upscaleShader = ew::Shader("assets/screen.vert", "assets/upscale.frag");
+	vg3o::ShaderVariants postVariants("assets/screen.vert", "assets/effects.frag");
+	unsigned int effectFeature = postVariants.addFeature("POST_EFFECT", 2);
+	postVariants.setFallback(postVariants.setFeature(0, effectFeature, postProcessEffect));
+	postVariants.request(postVariants.setFeature(0, effectFeature, 1 - postProcessEffect));
+	//Run twice to compare: the first launch compiles and fills shader_cache/, later ones load the binaries
+	ew::ShaderCacheStats shaderCacheStats = ew::getShaderCacheStats();
+	printf("Shaders loaded in %.2fms (%s start: %u cached, %u compiled, %u rejected)\n", shaderCacheStats.milliseconds,
+		shaderCacheStats.hits > 0 && shaderCacheStats.misses == 0 ? "warm" : "cold",
+		shaderCacheStats.hits, shaderCacheStats.misses, shaderCacheStats.rejected);
+
+	// edit anything in assets/ while running and it gets recompiled in the background
+	litVariants.watch(shaderReloader);
+	postVariants.watch(shaderReloader);
+	shaderReloader.add(&depthShader, "assets/depthShader.vert", "assets/empty.frag");
+	shaderReloader.add(&screenShader, "assets/screen.vert", "assets/screen.frag");
+	shaderReloader.add(&upscaleShader, "assets/screen.vert", "assets/upscale.frag");
+
+
+	vg3o::UniformBuffer frameUniforms(sizeof(FrameData), 0);
+	vg3o::UniformBuffer cascadePassUniforms[vg3o::MAX_SHADOW_CASCADES];
+	for (vg3o::UniformBuffer& uniforms : cascadePassUniforms)
+		uniforms = vg3o::UniformBuffer(sizeof(PassData), 1);
+	vg3o::UniformBuffer cameraPassUniforms(sizeof(PassData), 1);
+	vg3o::UniformBuffer materialUniforms(sizeof(MaterialData), 2);
 
 	ew::Model monkey = ew::Model("assets/Suzanne.obj");
 	ew::Transform monkeyTransform;
@@ -88,13 +278,61 @@ int main() {
 	ew::Transform floorTransform;
 	floorTransform.position = glm::vec3(0.0f, -2.0f, 0.0f);
 
-	GLuint brickTex = ew::loadTexture("assets/brick_color.jpg");
-	GLuint grassTex = ew::loadTexture("assets/grass.jpg");
-
-	vg3o::ScreenBuffer framebuffer(screenWidth, screenHeight, 1);
-	vg3o::ScreenBuffer depthMap(screenWidth, screenHeight, 1, true);
-
-	depthTexture = depthMap.getDepthTexture();
+	// decodes each file once for both the streamer and the packer below, they read the same images
+	vg3o::TextureRegistry textureRegistry;
+
+	// small mips load first, finer ones stream in as the camera gets close
+	//Cook with "textureCooker --bc1 assets/*.jpg" and run again to compare, the .dds files are picked up automatically
+	vg3o::TextureStreamer textureStreamer(textureRegistry);
+	int brickTex = textureStreamer.add("assets/brick_color.jpg");
+	int grassTex = textureStreamer.add("assets/grass.jpg");
+
+	// the same two textures packed as layers of one array, so both materials bind the same texture
+	vg3o::TextureArraySettings textureArraySettings;
+	textureArraySettings.layerSize = 1024;
+	vg3o::TextureArrayPacker texturePacker(textureRegistry, textureArraySettings);
+	int brickLayer = texturePacker.add("assets/brick_color.jpg");
+	int grassLayer = texturePacker.add("assets/grass.jpg");
+	texturePacker.build();
+	textureArrayStats = texturePacker.getStats();
+	printf("Packed %u textures into %u arrays in %.2fms\n", textureArrayStats.numTextures, textureArrayStats.numArrays, textureArrayStats.milliseconds);
+
+	// the frame is rebuilt as a graph every frame, its targets come from the pool only for as long as a pass needs them
+	vg3o::RenderTargetPool renderTargets;
+	vg3o::RenderGraph renderGraph(renderTargets);
+	vg3o::RenderTargetDesc sceneDesc; // HDR color + motion vectors + depth/stencil, screen sized
+	sceneDesc.colorFormats[1] = GL_RG16F;
+	// a fixed size layer per cascade, owned by the shadow map since static casters are cached across frames
+	vg3o::CascadedShadowMap shadowCascades(shadowSettings);
+	vg3o::RenderResource cascadeTargets[vg3o::MAX_SHADOW_CASCADES];
+	bool shadowTerrainEnabled = false;
+	unsigned int shadowTerrainGenerated = 0, shadowTerrainEvicted = 0;
+	vg3o::RenderResource sceneColor = -1;
+	vg3o::RenderResource backbuffer = -1;
+	vg3o::RenderResource history = -1;
+	vg3o::RenderResource upscaled = -1;
+
+	// the scene is rendered into a scaled corner of sceneColor, sized from the GPU time, and upscaled back to the window
+	// it stays screen sized so a new scale never reallocates it
+	if (headless.enabled) // the scale would follow the machine's timings, which isn't repeatable
+		dynamicResolutionSettings.enabled = false;
+	vg3o::DynamicResolution dynamicResolution(dynamicResolutionSettings);
+	vg3o::TemporalUpscaler upscaler;
+	glm::mat4 prevViewProjection = camera.projectionMatrix() * camera.viewMatrix();
+
+	// every graph pass is timed under its own name, results show up a few frames late
+	vg3o::GpuProfilerSettings gpuProfilerSettings;
+	if (headless.enabled) // percentiles over the whole run
+		gpuProfilerSettings.windowSize = headless.frames;
+	vg3o::GpuProfiler gpuProfiler(gpuProfilerSettings);
+	renderGraph.setProfiler(&gpuProfiler);
+	gpuRenderer = gpuProfiler.getRenderer();
+	vg3o::Trace::setThreadName("Main");
+	bool traceKeyWasDown = false;
+
+	vg3o::Terrain terrain(vg3o::TerrainSettings(), vg3o::createNoiseHeight(1337));
+	ew::Transform terrainTransform;
+	terrainTransform.position = glm::vec3(0.0f, -12.0f, 0.0f);
 
 	vg3o::Joint torso("Torso", glm::vec3(0.f, 0.f, 0.f));
 	vg3o::Joint head("Head", glm::vec3(1.f, 0.f, 0.f));
@@ -104,112 +342,458 @@ int main() {
 	vg3o::Skeleton skeleton;
 	skeleton.root = &torso;
 
+	// passes run in id order, the queue sorts the draws inside each one
+	vg3o::RenderQueue renderQueue;
+	// the graph has already bound each pass's target when these run
+	// the shadow map binds and clears each layer, these only set up the cascade's light matrix
+	for (unsigned int cascade = 0; cascade < vg3o::MAX_SHADOW_CASCADES; cascade++) {
+		auto beginShadowPass = [&, cascade]() {
+			cascadePassUniforms[cascade].bind();
+			vg3o::GLState::setDepthTest(true);
+			vg3o::GLState::setCullFace(GL_FRONT);
+		};
+		renderQueue.setPass(SHADOW_STATIC_PASS + cascade, beginShadowPass);
+		renderQueue.setPass(SHADOW_DYNAMIC_PASS + cascade, beginShadowPass);
+	}
+	renderQueue.setPass(DEPTH_PREPASS, [&]() {
+		cameraPassUniforms.bind(); // the same jittered matrix as the lit pass, or the depths won't be equal
+		vg3o::GLState::setDepthTest(true);
+		vg3o::GLState::setDepthWrite(true);
+		glClear(GL_DEPTH_BUFFER_BIT);
+		// empty.frag has no outputs, which leaves the color attachments undefined rather than untouched
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		vg3o::GLState::setCullFace(GL_BACK);
+	});
+	renderQueue.setPass(MAIN_PASS, [&]() {
+		cameraPassUniforms.bind();
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		glClearColor(backgroundColor.x, backgroundColor.y, backgroundColor.z, 1.0f);
+		vg3o::GLState::setDepthTest(true); // the shadow pass is culled without shadows, it can't be relied on to set this
+		if (depthPrepassEnabled) {
+			// depth is already final, only the nearest fragment of each pixel passes
+			glClear(GL_COLOR_BUFFER_BIT);
+			vg3o::GLState::setDepthFunc(GL_EQUAL);
+			vg3o::GLState::setDepthWrite(false);
+		}
+		else {
+			vg3o::GLState::setDepthWrite(true);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		}
+		float noMotion[4] = { 0.0f, 0.0f, 0.0f, 1.0f }; // the background doesn't move, rather than moving by its clear color
+		glClearBufferfv(GL_COLOR, 1, noMotion);
+		vg3o::GLState::setCullFace(GL_BACK);
+		vg3o::GLState::bindTexture(2, shadowCascades.getTexture());
+		vg3o::GLState::bindTexture(3, shadowCascades.getDepthView()); // only read by the PCSS blocker search
+	});
+	vg3o::RenderMaterial noTextures;
+	vg3o::RenderMaterial brickMaterial;
+	vg3o::RenderMaterial grassMaterial;
+
 	// Global settings
 	glEnable(GL_MULTISAMPLE);
-	glEnable(GL_CULL_FACE);
-	glCullFace(GL_BACK);
-	glEnable(GL_DEPTH_TEST);
-	glDepthFunc(GL_LESS);
-
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	vg3o::GLState::setCull(true);
+	vg3o::GLState::setCullFace(GL_BACK);
+	vg3o::GLState::setDepthTest(true);
+	vg3o::GLState::setDepthFunc(GL_LESS);
+
+	vg3o::GLState::setBlend(true);
+	vg3o::GLState::setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	// headless runs offscreen into a target of their own, there's no default framebuffer to present
+	vg3o::RenderTargetDesc offscreenDesc;
+	offscreenDesc.colorFormats[0] = GL_RGBA8;
+	offscreenDesc.depthFormat = 0;
+	int frameIndex = 0;
+	unsigned long long frameNumber = 0; // tags the sample counts, so the two passes are compared on the same frame
+	vg3o::SampleCounter prepassCounter, litCounter;
+	std::vector<double> cpuFrameMilliseconds;
+	vg3o::GLStateStats glStateTotals;
+	ew::ShaderStats shaderTotals;
+	unsigned long long uniformBufferTotal = 0;
+	unsigned long long renderItemTotal = 0;
+	double shadedPerPixelTotal = 0, overdrawTotal = 0;
+	// results lag a few frames and can repeat, so only a matched pair seen for the first time is averaged
+	unsigned long long overdrawFrames = 0, lastOverdrawFrame = ~0ull;
 
 	while (!glfwWindowShouldClose(window)) {
+		auto frameStart = std::chrono::high_resolution_clock::now();
 		glfwPollEvents();
-
-		float time = (float)glfwGetTime();
-		deltaTime = time - prevFrameTime;
-		prevFrameTime = time;
+		bool traceKeyDown = glfwGetKey(window, GLFW_KEY_F12) == GLFW_PRESS;
+		if ((traceKeyDown && !traceKeyWasDown) || startTraceCapture) {
+			if (!vg3o::Trace::isRecording())
+				vg3o::Trace::beginCapture(traceCaptureFrames, "cpu_trace.json");
+			startTraceCapture = false;
+		}
+		traceKeyWasDown = traceKeyDown;
+		dynamicResolution.getSettings() = dynamicResolutionSettings;
+		dynamicResolution.beginFrame();
+		gpuProfiler.beginFrame();
+		float renderScale = dynamicResolution.getScale();
+		renderWidth = (unsigned int)std::max(1, (int)(screenWidth * renderScale + 0.5f));
+		renderHeight = (unsigned int)std::max(1, (int)(screenHeight * renderScale + 0.5f));
+		upscaler.beginFrame(screenWidth, screenHeight, renderWidth, renderHeight);
+		if (!temporalUpscaleEnabled)
+			upscaler.reset();
+		// swaps in any shader that finished recompiling, so uniform ids are fetched after this
+		shaderReloader.update();
+		shaderReloadStats = shaderReloader.getStats();
 
 		// UPDATE TRANSFORMS
 
-		cameraControl.move(window, &camera, deltaTime);
-
-		// RENDER DEPTH MAP
-		depthMap.useBuffer();
-		depthShader.use();
-		glClear(GL_DEPTH_BUFFER_BIT);
-		glEnable(GL_DEPTH_TEST);
-		glCullFace(GL_FRONT);
-
-		glm::mat4 lightProjection = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, 0.5f, 50.f);
-		glm::mat4 lightView = glm::lookAt(lightDirection,
-			glm::vec3(0.0f,5.0f,0.0f), // camera
-										  
-										  glm::vec3(0.0f, 1.0f, 0.0f));
-
-		glm::mat4 lightSpaceMatrix = lightProjection * lightView;
-		
-		depthShader.setMat4("_LightSpaceMatrix", lightSpaceMatrix);
-
-
-		depthShader.setMat4("_Model", monkeyTransform.modelMatrix());
-		monkey.draw();
-
-		
-		depthShader.setMat4("_Model", floorTransform.modelMatrix());
-		quad.draw();
-
-
-		// RENDER MAIN SCENE
-		framebuffer.useBuffer();
-		glClearColor(backgroundColor.x, backgroundColor.y, backgroundColor.z, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		glCullFace(GL_BACK);
-
-		glBindTextureUnit(0, brickTex);
-		glBindTextureUnit(1, grassTex);
-		glBindTextureUnit(2, depthMap.getDepthTexture());
-
-		shader.use();
+		if (headless.enabled) {
+			// fixed step and a scripted path, so every run renders the same frames
+			deltaTime = 1.0f / 60.0f;
+			followCameraPath(&camera, (float)frameIndex / (headless.warmupFrames + headless.frames));
+		}
+		else {
+			float time = (float)glfwGetTime();
+			deltaTime = time - prevFrameTime;
+			prevFrameTime = time;
+			cameraControl.move(window, &camera, deltaTime);
+		}
+		monkey.updateMorphTargets();
 
-		// lighting & materials
-		shader.setVec3("_LightDirection", lightDirection);
-		shader.setVec3("_EyePos", camera.position);
-		shader.setFloat("_Material.Ka", material.Ambient);
-		shader.setFloat("_Material.Kd", material.Diffuse);
-		shader.setFloat("_Material.Ks", material.Specular);
-		shader.setFloat("_Material.Ks", material.Specular);
-		shader.setFloat("_Material.Shininess", material.Shininess);
+		if (terrainEnabled) {
+			terrain.update(camera);
+			terrainStats = terrain.getStats();
+		}
 
-		shader.setFloat("_MaxBias", maxBias);
-		shader.setFloat("_MinBias", minBias);
+		// terrain chunks are static casters, but streaming them in or out changes what the cache should hold
+		if (terrainEnabled != shadowTerrainEnabled || (terrainEnabled && (terrainStats.chunksGenerated != shadowTerrainGenerated
+			|| terrainStats.chunksEvicted != shadowTerrainEvicted))) {
+			shadowCascades.invalidateStatic();
+			shadowTerrainEnabled = terrainEnabled;
+			shadowTerrainGenerated = terrainStats.chunksGenerated;
+			shadowTerrainEvicted = terrainStats.chunksEvicted;
+		}
+		shadowCascades.getSettings() = shadowSettings;
+		shadowCascades.update(camera, lightDirection);
+		numShadowCascades = shadowCascades.getNumCascades();
+
+		// UPDATE UNIFORM BLOCKS
+		FrameData frameData;
+		for (unsigned int cascade = 0; cascade < vg3o::MAX_SHADOW_CASCADES; cascade++)
+			frameData.LightSpace[cascade] = cascade < numShadowCascades ? shadowCascades.getLightMatrix(cascade) : glm::mat4(1.0f);
+		frameData.CascadeSplits = shadowCascades.getSplits();
+		frameData.EyePos = camera.position;
+		frameData.MinBias = minBias;
+		frameData.LightDirection = lightDirection;
+		frameData.MaxBias = maxBias;
+		frameData.CameraForward = glm::normalize(camera.target - camera.position);
+		frameData.NumCascades = (int)numShadowCascades;
+		frameUniforms.update(frameData);
+
+		for (unsigned int cascade = 0; cascade < numShadowCascades; cascade++) {
+			const glm::mat4& lightMatrix = shadowCascades.getLightMatrix(cascade);
+			PassData cascadePass = { lightMatrix, lightMatrix, lightMatrix };
+			cascadePassUniforms[cascade].update(cascadePass);
+		}
+		glm::mat4 viewProjection = camera.projectionMatrix() * camera.viewMatrix();
+		glm::mat4 jitteredViewProjection = temporalUpscaleEnabled ? upscaler.jitterProjection(camera.projectionMatrix()) * camera.viewMatrix() : viewProjection;
+		PassData cameraPass = { jitteredViewProjection, viewProjection, prevViewProjection };
+		cameraPassUniforms.update(cameraPass);
+		prevViewProjection = viewProjection;
+
+		MaterialData materialData = { material.Ambient, material.Diffuse, material.Specular, material.Shininess };
+		materialUniforms.update(materialData);
+
+		// variants compile a couple per frame, the fallback draws until they're ready
+		litVariants.update(1);
+		postVariants.update(1);
+		unsigned int litKey = litVariants.setFeature(0, shadowsFeature, shadowsEnabled ? 1 : 0);
+		litKey = litVariants.setFeature(litKey, shadowFilterFeature, shadowFilter);
+		litKey = litVariants.setFeature(litKey, textureArrayFeature, textureArraysEnabled ? 1 : 0);
+		const ew::Shader& shader = litVariants.get(litKey);
+		litVariantStats = litVariants.getStats();
+
+		// SUBMIT SCENE
+		glm::mat4 monkeyMatrix = monkeyTransform.modelMatrix();
+		glm::mat4 floorMatrix = floorTransform.modelMatrix();
+		glm::mat4 terrainMatrix = terrainTransform.modelMatrix();
+		float monkeyDepth = glm::length(camera.position - monkeyTransform.position);
+		float floorDepth = glm::length(camera.position - floorTransform.position);
+
+		textureStreamer.requestFootprint(brickTex, camera, monkeyTransform.position, 1.5f, (float)screenHeight);
+		textureStreamer.requestFootprint(grassTex, camera, floorTransform.position, 7.1f, (float)screenHeight);
+		if (terrainEnabled) // it surrounds the camera, so the ground underneath always wants the finest level
+			textureStreamer.requestFootprint(grassTex, camera, camera.position, 1.0f, (float)screenHeight);
+		{
+			VG3O_TRACE_SCOPE("Texture Uploads");
+			vg3o::GpuScope scope(gpuProfiler, "Texture Uploads");
+			textureStreamer.update();
+		}
+		textureStreamerStats = textureStreamer.getStats();
+		textureRegistryStats = textureRegistry.getStats();
+		if (textureArraysEnabled) {
+			brickMaterial.textures[0] = texturePacker.getSlot(brickLayer).texture;
+			brickMaterial.layer = texturePacker.getSlot(brickLayer).layer;
+			grassMaterial.textures[0] = texturePacker.getSlot(grassLayer).texture;
+			grassMaterial.layer = texturePacker.getSlot(grassLayer).layer;
+		}
+		else {
+			brickMaterial.textures[0] = textureStreamer.getId(brickTex);
+			grassMaterial.textures[0] = textureStreamer.getId(grassTex);
+		}
 
-		shader.setMat4("_LightSpace", lightSpaceMatrix);
+		auto drawMonkey = [&]() { monkey.draw(); };
+		auto drawTerrain = [&]() { terrain.draw(); };
+
+		// the monkey morphs, so it is redrawn into every cascade each frame. The floor and terrain only go
+		// into cascades whose cache has to be redrawn
+		for (unsigned int cascade = 0; shadowsEnabled && cascade < numShadowCascades; cascade++) {
+			renderQueue.submit(SHADOW_DYNAMIC_PASS + cascade, drawMonkey, depthShader, noTextures, monkeyMatrix, monkeyDepth);
+			if (!shadowCascades.isStaticDirty(cascade))
+				continue;
+			renderQueue.submit(SHADOW_STATIC_PASS + cascade, quad, depthShader, noTextures, floorMatrix, floorDepth);
+			if (terrainEnabled)
+				renderQueue.submit(SHADOW_STATIC_PASS + cascade, drawTerrain, depthShader, noTextures, terrainMatrix, 1e30f);
+		}
+		if (depthPrepassEnabled) {
+			renderQueue.submit(DEPTH_PREPASS, drawMonkey, depthShader, noTextures, monkeyMatrix, monkeyDepth);
+			renderQueue.submit(DEPTH_PREPASS, quad, depthShader, noTextures, floorMatrix, floorDepth);
+			if (terrainEnabled)
+				renderQueue.submit(DEPTH_PREPASS, drawTerrain, depthShader, noTextures, terrainMatrix, 1e30f);
+		}
+		renderQueue.submit(MAIN_PASS, drawMonkey, shader, brickMaterial, monkeyMatrix, monkeyDepth);
+		renderQueue.submit(MAIN_PASS, quad, shader, grassMaterial, floorMatrix, floorDepth);
+		if (terrainEnabled) {
+			// terrain is drawn last in each pass, it covers most of the screen and benefits least from early depth
+			renderQueue.submit(MAIN_PASS, drawTerrain, shader, grassMaterial, terrainMatrix, 1e30f);
+		}
 
-		//texture
-		shader.setInt("_MainTex", 0);
-		shader.setInt("_ShadowMap", 2);
-		
-		shader.setMat4("_Model", monkeyTransform.modelMatrix());
-		shader.setMat4("_ViewProjection", camera.projectionMatrix() * camera.viewMatrix());
-		monkey.draw();
+		// BUILD FRAME
+		renderTargets.beginFrame(screenWidth, screenHeight);
+		renderGraph.reset();
+		for (unsigned int cascade = 0; shadowsEnabled && cascade < numShadowCascades; cascade++)
+			cascadeTargets[cascade] = renderGraph.importTarget("shadowCascade" + std::to_string(cascade), shadowCascades.getTarget(cascade));
+		sceneColor = renderGraph.createTarget("sceneColor", sceneDesc);
+		if (headless.enabled)
+			backbuffer = renderGraph.createTarget("offscreen", offscreenDesc);
+		else {
+			vg3o::RenderTarget screenTarget;
+			screenTarget.width = screenWidth;
+			screenTarget.height = screenHeight;
+			backbuffer = renderGraph.importTarget("backbuffer", screenTarget);
+		}
+		history = renderGraph.importTarget("history", upscaler.getHistory());
+		upscaled = renderGraph.importTarget("upscaled", upscaler.getOutput());
+
+		// one pass per cascade so each is timed on its own. Writing an imported target keeps a pass alive,
+		// so without shadows they are left out rather than culled
+		for (unsigned int cascade = 0; shadowsEnabled && cascade < numShadowCascades; cascade++) {
+			renderGraph.addPass("Shadow Cascade " + std::to_string(cascade), [&, cascade]() {
+				if (shadowCascades.isStaticDirty(cascade)) {
+					shadowCascades.beginStatic(cascade);
+					renderQueue.executePass(SHADOW_STATIC_PASS + cascade);
+					shadowCascades.endStatic(cascade);
+				}
+				shadowCascades.beginCascade(cascade);
+				renderQueue.executePass(SHADOW_DYNAMIC_PASS + cascade);
+			}).write(cascadeTargets[cascade]);
+		}
 
-		
-		shader.setMat4("_Model", floorTransform.modelMatrix());
-		shader.setInt("_MainTex", 1);
-		quad.draw();
+		// a separate pass so its cost shows up next to what it saves the lit pass
+		if (depthPrepassEnabled) {
+			renderGraph.addPass("Depth Prepass", [&]() {
+				glViewport(0, 0, renderWidth, renderHeight);
+				prepassCounter.begin(frameNumber);
+				renderQueue.executePass(DEPTH_PREPASS);
+				prepassCounter.end();
+			}).write(sceneColor);
+		}
 
-		// FINISH RENDER
+		vg3o::RenderPassBuilder litPass = renderGraph.addPass("Lit", [&]() {
+			glViewport(0, 0, renderWidth, renderHeight);
+			litCounter.begin(frameNumber);
+			renderQueue.executePass(MAIN_PASS);
+			litCounter.end();
+			// the shadow passes draw with the defaults
+			vg3o::GLState::setDepthFunc(GL_LESS);
+			vg3o::GLState::setDepthWrite(true);
+		});
+		litPass.write(sceneColor);
+		for (unsigned int cascade = 0; shadowsEnabled && cascade < numShadowCascades; cascade++)
+			litPass.read(cascadeTargets[cascade]);
+
+		renderGraph.addPass("Upscale", [&]() {
+			const vg3o::RenderTarget& scene = renderGraph.getTarget(sceneColor);
+			vg3o::GLState::setDepthTest(false);
+			glm::vec2 scale = glm::vec2((float)renderWidth / scene.width, (float)renderHeight / scene.height);
+			upscaler.resolve(upscaleShader, scene.colorTextures[0], scene.colorTextures[1], scale);
+		}).read(sceneColor).read(history).write(upscaled);
+
+		renderGraph.addPass("Post", [&]() {
+			if (!postProcessEnabled) { screenShader.use();/* screenShader.setInt("depthTexture", 0);*/ }
+			else
+			{
+				postVariants.get(postVariants.setFeature(0, effectFeature, postProcessEffect)).use();
+			}
+
+			vg3o::GLState::setDepthTest(false); // disable depth testing cause we want the framebuffer to be on top of everything else
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			vg3o::GLState::bindTexture(0, renderGraph.getTarget(upscaled).colorTextures[0]);
+			vg3o::ScreenBuffer::draw();
+		}).read(upscaled).write(backbuffer).setSideEffect(); // nothing reads the offscreen target when headless
+
+		renderGraph.execute();
+		frameNumber++;
+		// the prepass passes every fragment the lit pass would shade without it, in the same order, so
+		// the two counts from one frame give the overdraw the prepass removes
+		prepassCounter.update();
+		litCounter.update();
+		litSamples = litCounter.getSamples();
+		shadedPerPixel = (float)litSamples / (renderWidth * renderHeight);
+		bool overdrawFresh = false;
+		if (!depthPrepassEnabled)
+			overdrawRatio = 0.0f;
+		else if (prepassCounter.hasResult() && prepassCounter.getFrame() == litCounter.getFrame()) {
+			prepassSamples = prepassCounter.getSamples();
+			overdrawRatio = litSamples > 0 ? (float)prepassSamples / litSamples : 0.0f;
+			overdrawFresh = litCounter.getFrame() != lastOverdrawFrame;
+			lastOverdrawFrame = litCounter.getFrame();
+		}
+		renderQueueStats = renderQueue.getStats();
+		renderQueue.clear();
+		renderGraphStats = renderGraph.getStats();
+		renderTargetStats = renderTargets.getStats();
+		for (unsigned int cascade = 0; cascade < numShadowCascades; cascade++) {
+			shadowCascadeStats[cascade] = shadowCascades.getStats(cascade);
+			shadowLayerViews[cascade] = shadowCascades.getLayerView(cascade);
+		}
+		if (printRenderGraph) {
+			printf("%s", renderGraph.dump().c_str());
+			printRenderGraph = false;
+		}
 
-		framebuffer.useDefaultBuffer(); // go back to the framebuffer we want to draw on screen
+		if (runSortBenchmark) {
+			// 100k random items over a handful of shaders and materials, sorted but never drawn
+			const ew::Shader* shaders[3] = { &depthShader, &shader, &screenShader };
+			vg3o::RenderQueue benchmarkQueue;
+			srand(1234);
+			for (int i = 0; i < 100000; i++) {
+				vg3o::RenderMaterial randomMaterial;
+				randomMaterial.textures[0] = 1 + rand() % 64;
+				benchmarkQueue.submit(rand() % 2, quad, *shaders[rand() % 3], randomMaterial, floorMatrix, (float)(rand() % 10000) * 0.01f);
+			}
+			benchmarkQueue.sort();
+			sortBenchmarkStats = benchmarkQueue.getStats();
+			printf("Sorted %u items in %.3fms: %u pass, %u shader, %u material changes\n", sortBenchmarkStats.numItems, sortBenchmarkStats.sortMilliseconds,
+				sortBenchmarkStats.passChanges, sortBenchmarkStats.shaderChanges, sortBenchmarkStats.materialChanges);
+			benchmarkQueue.clear();
+			runSortBenchmark = false;
+		}
+		if (runTraceBenchmark) {
+			traceOverhead = vg3o::Trace::measureOverhead(1000000);
+			printf("Trace scope overhead: %.2fns idle, %.2fns recording\n", traceOverhead.idleNanoseconds, traceOverhead.recordingNanoseconds);
+			runTraceBenchmark = false;
+		}
 
-		if (!postProcessEnabled) { screenShader.use();/* screenShader.setInt("depthTexture", 0);*/ }
-		else
-		{
-			postShader.use();
-			postShader.setInt("_PostProcessEffect", postProcessEffect);
+		shaderStats = ew::getShaderStats();
+		uniformBufferUpdates = vg3o::UniformBuffer::getNumUpdates();
+		glStateStats = vg3o::GLState::getStats();
+		if (headless.enabled && frameIndex >= headless.warmupFrames) {
+			glStateTotals.issued += glStateStats.issued;
+			glStateTotals.skipped += glStateStats.skipped;
+			glStateTotals.textureBinds += glStateStats.textureBinds;
+			glStateTotals.drawCalls += glStateStats.drawCalls;
+			shaderTotals.programBinds += shaderStats.programBinds;
+			shaderTotals.uniformCalls += shaderStats.uniformCalls;
+			uniformBufferTotal += uniformBufferUpdates;
+			renderItemTotal += renderQueueStats.numItems;
+			shadedPerPixelTotal += shadedPerPixel;
+			if (overdrawFresh) {
+				overdrawTotal += overdrawRatio;
+				overdrawFrames++;
+			}
+		}
+		ew::resetShaderStats();
+		vg3o::UniformBuffer::resetNumUpdates();
+		vg3o::GLState::resetStats();
+
+		gpuFrameMilliseconds = dynamicResolution.getGpuMilliseconds();
+		resolutionScaleHistory = dynamicResolution.getScaleHistory();
+		gpuTimeHistory = dynamicResolution.getGpuHistory();
+		resolutionHistoryOffset = dynamicResolution.getHistoryOffset();
+		gpuProfilerStats = gpuProfiler.getStats();
+		gpuScopes = gpuProfiler.getScopes();
+		if (exportGpuTrace) {
+			if (gpuProfiler.exportChromeTrace("gpu_trace.json"))
+				printf("Wrote gpu_trace.json, open it in chrome://tracing\n");
+			exportGpuTrace = false;
 		}
 
-		glDisable(GL_DEPTH_TEST); // disable depth testing cause we want the framebuffer to be on top of everything else
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, framebuffer.getColorBuffers()[0]);
-		vg3o::ScreenBuffer::draw();
+		traceStats = vg3o::Trace::getStats();
 
-		drawUI();
+		if (!headless.enabled) {
+			VG3O_TRACE_SCOPE("ImGui");
+			vg3o::GpuScope scope(gpuProfiler, "ImGui");
+			drawUI();
+		}
+		gpuProfiler.endFrame();
+		dynamicResolution.endFrame();
+
+		if (headless.enabled) {
+			// a software rasterizer only draws when flushed, waiting here puts its work in the frame time
+			glFinish();
+			if (frameIndex >= headless.warmupFrames)
+				cpuFrameMilliseconds.push_back(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - frameStart).count());
+		}
+		else {
+			VG3O_TRACE_SCOPE("Swap Buffers");
+			glfwSwapBuffers(window);
+		}
+		// ends a frame-limited capture and writes the file once enough frames have gone by
+		vg3o::Trace::frame();
+		if (headless.enabled && ++frameIndex >= headless.warmupFrames + headless.frames)
+			break;
+	}
 
-		glfwSwapBuffers(window);
+	if (headless.enabled) {
+		// everything has finished after the glFinish, so this reads back the last frames
+		gpuProfiler.beginFrame();
+		gpuProfiler.endFrame();
+
+		double frames = (double)headless.frames;
+		vg3o::BenchmarkReport report;
+		report.setInfo("renderer", gpuProfiler.getRenderer());
+		report.setInfo("gpu_timer", gpuProfiler.getStats().timerQueries ? "GL_TIME_ELAPSED" : "cpu");
+		report.setInfo("resolution", std::to_string(screenWidth) + "x" + std::to_string(screenHeight));
+		report.setInfo("frames", std::to_string(headless.frames));
+		report.setInfo("warmup_frames", std::to_string(headless.warmupFrames));
+		report.setInfo("shadow_filter", shadowFilterNames[shadowFilter]);
+		report.setInfo("depth_prepass", depthPrepassEnabled ? "on" : "off");
+		report.addSamples("cpu_frame", cpuFrameMilliseconds, "ms");
+		for (const vg3o::GpuScopeStats& scope : gpuProfiler.getScopes()) {
+			report.addMetric("gpu." + scope.name + ".avg", scope.averageMilliseconds, "ms");
+			report.addMetric("gpu." + scope.name + ".p50", scope.p50Milliseconds, "ms");
+			report.addMetric("gpu." + scope.name + ".p95", scope.p95Milliseconds, "ms");
+			report.addMetric("gpu." + scope.name + ".p99", scope.p99Milliseconds, "ms");
+		}
+		report.addMetric("frame.draw_calls", glStateTotals.drawCalls / frames, "count");
+		report.addMetric("frame.render_items", renderItemTotal / frames, "count");
+		report.addMetric("frame.state_changes", glStateTotals.issued / frames, "count");
+		report.addMetric("frame.state_changes_skipped", glStateTotals.skipped / frames, "count");
+		report.addMetric("frame.texture_binds", glStateTotals.textureBinds / frames, "count");
+		report.addMetric("frame.program_binds", shaderTotals.programBinds / frames, "count");
+		report.addMetric("frame.uniform_calls", shaderTotals.uniformCalls / frames, "count");
+		report.addMetric("frame.uniform_block_updates", uniformBufferTotal / frames, "count");
+		report.addMetric("frame.lit_fragments_per_pixel", shadedPerPixelTotal / frames, "ratio");
+		if (depthPrepassEnabled && overdrawFrames > 0)
+			report.addMetric("frame.overdraw_removed", overdrawTotal / overdrawFrames, "ratio");
+		report.addMetric("memory.peak_resident", (double)vg3o::getPeakResidentBytes(), "bytes");
+		report.addMetric("memory.render_targets", (double)renderTargets.getStats().bytesAllocated, "bytes");
+		report.addMetric("memory.streamed_textures", (double)textureStreamer.getStats().residentBytes, "bytes");
+		report.addMetric("memory.texture_arrays", (double)textureArrayStats.gpuBytes, "bytes");
+		report.addMetric("memory.loaded_textures", (double)ew::getTextureStats().gpuBytes, "bytes");
+		vg3o::ArenaStats arenaStats = vg3o::GeometryArena::get().getStats();
+		report.addMetric("memory.arena_vertices", arenaStats.vertexUsed, "count");
+		report.addMetric("memory.arena_indices", arenaStats.indexUsed, "count");
+		bool written = report.write(headless.reportPath);
+		vg3o::SampleSummary frameSummary = vg3o::summarizeSamples(cpuFrameMilliseconds);
+		printf("%d frames at %dx%d: %.3fms avg, %.3fms p95, %.3fms p99 CPU. Report %s %s\n", headless.frames, screenWidth, screenHeight,
+			frameSummary.average, frameSummary.p95, frameSummary.p99, written ? "written to" : "failed to write to", headless.reportPath.c_str());
+		vg3o::Animation::Cleanup();
+		return written ? 0 : 1;
 	}
 	printf("Shutting down...");
 	vg3o::Animation::Cleanup();
@@ -232,10 +816,17 @@ void drawUI() {
 
 		ImGui::SliderFloat("Max Bias", &maxBias, 0.f, 1.f);
 		ImGui::SliderFloat("Min Bias", &minBias, 0.f, 1.f);
-
+		ImGui::Checkbox("Shadows", &shadowsEnabled);
+		ImGui::Combo("Shadow Filter", &shadowFilter, shadowFilterNames, 4);
+		for (const vg3o::GpuScopeStats& scope : gpuScopes)
+			if (scope.name == "Lit") ImGui::Text("Lit pass: %.3fms avg, %.3fms p95", scope.averageMilliseconds, scope.p95Milliseconds);
+		ImGui::Text("Lit variants: %u compiled, %u pending", litVariantStats.numCompiled, litVariantStats.numPending);
+
+		ImGui::SliderInt("Preview Cascade", &shadowPreviewCascade, 0, (int)numShadowCascades - 1);
+		shadowPreviewCascade = std::min(shadowPreviewCascade, (int)numShadowCascades - 1);
 		ImGui::BeginChild("Shadow Map");
 		ImVec2 windowSize = ImGui::GetWindowSize();
-		ImGui::Image((ImTextureID)depthTexture, windowSize, ImVec2(0, 1), ImVec2(1, 0));
+		ImGui::Image((ImTextureID)shadowLayerViews[shadowPreviewCascade], windowSize, ImVec2(0, 1), ImVec2(1, 0));
 		ImGui::EndChild();
 
 		ImGui::Separator();
@@ -245,12 +836,115 @@ void drawUI() {
 			resetCamera(&camera, &cameraControl);
 		}
 
+		if (ImGui::CollapsingHeader("Shadow Cascades")) {
+			int numCascades = (int)shadowSettings.numCascades;
+			if (ImGui::SliderInt("Cascades", &numCascades, 1, (int)vg3o::MAX_SHADOW_CASCADES))
+				shadowSettings.numCascades = (unsigned int)numCascades;
+			const char* resolutions[] = { "512", "1024", "2048", "4096" };
+			int resolutionIndex = 0;
+			while (resolutionIndex < 3 && (512u << resolutionIndex) < shadowSettings.resolution)
+				resolutionIndex++;
+			if (ImGui::Combo("Resolution", &resolutionIndex, resolutions, 4))
+				shadowSettings.resolution = 512u << resolutionIndex;
+			ImGui::SliderFloat("Distance", &shadowSettings.maxDistance, 5.0f, 100.0f);
+			ImGui::SliderFloat("Split Lambda", &shadowSettings.splitLambda, 0.0f, 1.0f);
+			ImGui::SliderFloat("Cache Margin", &shadowSettings.cacheMargin, 0.0f, 1.0f);
+			for (unsigned int cascade = 0; cascade < numShadowCascades; cascade++) {
+				const vg3o::ShadowCascadeStats& stats = shadowCascadeStats[cascade];
+				std::string passName = "Shadow Cascade " + std::to_string(cascade);
+				float gpuMilliseconds = 0.0f;
+				for (const vg3o::GpuScopeStats& scope : gpuScopes)
+					if (scope.name == passName) gpuMilliseconds = scope.averageMilliseconds;
+				ImGui::Text("%u: %.1f-%.1f, %.3f per texel, %.3fms, static redrawn %u times%s", cascade, stats.nearDepth, stats.farDepth,
+					stats.texelSize, gpuMilliseconds, stats.staticRenders, stats.staticRendered ? " (this frame)" : "");
+			}
+		}
+		if (ImGui::CollapsingHeader("Depth Prepass")) {
+			ImGui::Checkbox("Enabled", &depthPrepassEnabled);
+			float prepassMilliseconds = 0.0f, litMilliseconds = 0.0f;
+			for (const vg3o::GpuScopeStats& scope : gpuScopes) {
+				if (scope.name == "Depth Prepass") prepassMilliseconds = scope.averageMilliseconds;
+				if (scope.name == "Lit") litMilliseconds = scope.averageMilliseconds;
+			}
+			ImGui::Text("Prepass %.3fms + lit %.3fms = %.3fms", depthPrepassEnabled ? prepassMilliseconds : 0.0f, litMilliseconds,
+				(depthPrepassEnabled ? prepassMilliseconds : 0.0f) + litMilliseconds);
+			ImGui::Text("Lit fragments: %llu, %.2f per pixel", litSamples, shadedPerPixel);
+			if (depthPrepassEnabled)
+				ImGui::Text("Overdraw: %.2fx (%llu fragments pass the prepass)", overdrawRatio, prepassSamples);
+			else
+				ImGui::Text("Overdraw: enable the prepass to measure");
+		}
 		if (ImGui::CollapsingHeader("Material Settings")) {
 			ImGui::SliderFloat("AmbientK", &material.Ambient, 0.0f, 1.0f);
 			ImGui::SliderFloat("DiffuseK", &material.Diffuse, 0.0f, 1.0f);
 			ImGui::SliderFloat("SpecularK", &material.Specular, 0.0f, 1.0f);
 			ImGui::SliderFloat("Shininess", &material.Shininess, 2.0f, 1024.0f);
 		}
+		if (ImGui::CollapsingHeader("Shader Calls")) {
+			ImGui::Text("Uniform calls per frame: %u", shaderStats.uniformCalls);
+			ImGui::Text("Location lookups per frame: %u", shaderStats.locationLookups);
+			ImGui::Text("Program binds per frame: %u", shaderStats.programBinds);
+			ImGui::Text("Uniform block updates per frame: %u", uniformBufferUpdates);
+			ImGui::Text("State changes per frame: %u issued, %u skipped", glStateStats.issued, glStateStats.skipped);
+			ImGui::Text("Texture binds per frame: %u, layer changes: %u", glStateStats.textureBinds, renderQueueStats.layerChanges);
+			ImGui::Text("Hot reloads: %u (%u failed, %u compiling)", shaderReloadStats.reloads, shaderReloadStats.failures, shaderReloadStats.pending);
+			ImGui::Text("Frames stalled on compiles: %u%s", shaderReloadStats.stalledFrames, ew::hasParallelShaderCompile() ? "" : " (no parallel compile extension)");
+			if (ImGui::Button("Reload Shaders"))
+				shaderReloader.reloadAll();
+		}
+		if (ImGui::CollapsingHeader("Render Queue")) {
+			ImGui::Text("Items: %u, sorted in %.3fms", renderQueueStats.numItems, renderQueueStats.sortMilliseconds);
+			ImGui::Text("Changes: %u pass, %u shader, %u material", renderQueueStats.passChanges, renderQueueStats.shaderChanges, renderQueueStats.materialChanges);
+			if (ImGui::Button("Sort 100k Items"))
+				runSortBenchmark = true;
+			if (sortBenchmarkStats.numItems > 0) {
+				ImGui::Text("100k sort: %.3fms", sortBenchmarkStats.sortMilliseconds);
+				ImGui::Text("Changes: %u pass, %u shader, %u material", sortBenchmarkStats.passChanges, sortBenchmarkStats.shaderChanges, sortBenchmarkStats.materialChanges);
+			}
+		}
+		if (ImGui::CollapsingHeader("Textures")) {
+			ImGui::Checkbox("Texture Arrays", &textureArraysEnabled);
+			ImGui::Text("Arrays: %u holding %u textures, %.2f MB", textureArrayStats.numArrays, textureArrayStats.numTextures, textureArrayStats.gpuBytes / (1024.0 * 1024.0));
+			ImGui::Text("Textures: %u (%u streaming, %u requests pending)", textureStreamerStats.numTextures, textureStreamerStats.numStreaming, textureStreamerStats.pendingRequests);
+			ImGui::Text("Resident: %.2f / %.2f MB", textureStreamerStats.residentBytes / (1024.0 * 1024.0), textureStreamerStats.memoryBudget / (1024.0 * 1024.0));
+			ImGui::Text("Streamed: %.2f MB last frame, %.2f MB total", textureStreamerStats.bytesStreamedLastUpdate / (1024.0 * 1024.0), textureStreamerStats.bytesStreamedTotal / (1024.0 * 1024.0));
+			ImGui::Text("Levels: %u loaded, %u evicted", textureStreamerStats.levelsLoaded, textureStreamerStats.levelsEvicted);
+			ImGui::Text("Decodes shared: %u, %.2f MB cached", textureRegistryStats.decodeShares, textureRegistryStats.decodeCacheBytes / (1024.0 * 1024.0));
+		}
+		if (ImGui::CollapsingHeader("Render Targets")) {
+			ImGui::Text("Textures: %u (%u in use), framebuffers: %u", renderTargetStats.numTextures, renderTargetStats.numInUse, renderTargetStats.numFramebuffers);
+			ImGui::Text("Memory: %.2f MB allocated, %.2f MB in use", renderTargetStats.bytesAllocated / (1024.0 * 1024.0), renderTargetStats.bytesInUse / (1024.0 * 1024.0));
+			ImGui::Text("Allocations: %u, reuses: %u", renderTargetStats.numAllocations, renderTargetStats.numReuses);
+			ImGui::Text("Graph: %u passes (%u culled), %u barriers, peak %.2f MB", renderGraphStats.numPasses, renderGraphStats.numCulled,
+				renderGraphStats.numBarriers, renderGraphStats.peakBytes / (1024.0 * 1024.0));
+			if (ImGui::Button("Print Render Graph"))
+				printRenderGraph = true;
+		}
+		if (ImGui::CollapsingHeader("Dynamic Resolution")) {
+			ImGui::Checkbox("Dynamic Resolution", &dynamicResolutionSettings.enabled);
+			ImGui::Checkbox("Temporal Upscaling", &temporalUpscaleEnabled);
+			ImGui::SliderFloat("GPU Budget (ms)", &dynamicResolutionSettings.targetMilliseconds, 1.0f, 33.3f);
+			ImGui::SliderFloat("Min Scale", &dynamicResolutionSettings.minScale, 0.25f, 1.0f);
+			ImGui::SliderFloat("Max Scale", &dynamicResolutionSettings.maxScale, 0.25f, 1.0f);
+			ImGui::Text("Rendering %ux%u of %dx%d, GPU %.2fms", renderWidth, renderHeight, screenWidth, screenHeight, gpuFrameMilliseconds);
+			ImGui::PlotLines("Scale", resolutionScaleHistory.data(), (int)resolutionScaleHistory.size(), resolutionHistoryOffset, NULL, 0.0f, 1.0f, ImVec2(0, 60));
+			ImGui::PlotLines("GPU ms", gpuTimeHistory.data(), (int)gpuTimeHistory.size(), resolutionHistoryOffset, NULL, 0.0f, dynamicResolutionSettings.targetMilliseconds * 2.0f, ImVec2(0, 60));
+		}
+		if (ImGui::CollapsingHeader("Terrain")) {
+			ImGui::Checkbox("Enable Terrain", &terrainEnabled);
+			ImGui::Text("Chunks: %u resident, %u pending, %u evicted", terrainStats.chunksResident, terrainStats.chunksPending, terrainStats.chunksEvicted);
+			ImGui::Text("Resident: %.2f MB", terrainStats.residentBytes / (1024.0 * 1024.0));
+			ImGui::Text("Generation: %.1f chunks/s, %.0f vertices/s", terrainStats.chunksPerSecond(), terrainStats.verticesPerSecond());
+		}
+		if (ImGui::CollapsingHeader("Geometry Arena")) {
+			vg3o::ArenaStats stats = vg3o::GeometryArena::get().getStats();
+			ImGui::Text("Allocations: %u", stats.numAllocations);
+			ImGui::Text("Vertices: %u / %u (%u free blocks, %.2f fragmented)", stats.vertexUsed, stats.vertexCapacity, stats.vertexFreeBlocks, stats.vertexFragmentation());
+			ImGui::Text("Indices: %u / %u (%u free blocks, %.2f fragmented)", stats.indexUsed, stats.indexCapacity, stats.indexFreeBlocks, stats.indexFragmentation());
+			ImGui::Text("Grows: %u, Defragments: %u", stats.numGrows, stats.numDefragments);
+			if (ImGui::Button("Defragment"))
+				vg3o::GeometryArena::get().defragment();
+		}
 		ImGui::Separator();
 		ImGui::Checkbox("Enable Post Processing", &postProcessEnabled);
 		if (postProcessEnabled)
@@ -260,6 +954,45 @@ void drawUI() {
 
 		ImGui::End();
 	}
+	{ // GPU Profiler
+		ImGui::Begin("GPU Profiler");
+		ImGui::Text("%s%s", gpuRenderer.c_str(), gpuProfilerStats.timerQueries ? "" : " (no timer queries, CPU times)");
+		if (gpuProfilerStats.softwareRenderer)
+			ImGui::TextWrapped("Software renderer: work runs when the rasterizer flushes, so per pass times are only rough.");
+		ImGui::Text("Frame: %.3fms over %u frames (%u skipped)", gpuProfilerStats.frameMilliseconds, gpuProfilerStats.framesRecorded, gpuProfilerStats.framesSkipped);
+		ImGui::Separator();
+		ImGui::Text("%-16s %8s %8s %8s %8s %8s", "Scope", "last", "avg", "p50", "p95", "p99");
+		for (const vg3o::GpuScopeStats& scope : gpuScopes)
+		{
+			ImGui::Text("%-16s %8.3f %8.3f %8.3f %8.3f %8.3f", scope.name.c_str(), scope.lastMilliseconds, scope.averageMilliseconds,
+				scope.p50Milliseconds, scope.p95Milliseconds, scope.p99Milliseconds);
+		}
+		if (gpuProfilerStats.nestedScopes > 0)
+			ImGui::Text("%u nested scopes ignored", gpuProfilerStats.nestedScopes);
+		if (ImGui::Button("Export Chrome Trace"))
+			exportGpuTrace = true;
+		ImGui::End();
+	}
+	{ // CPU Trace
+		ImGui::Begin("CPU Trace");
+		ImGui::SliderInt("Frames", &traceCaptureFrames, 1, 600);
+		if (traceStats.capturing)
+			ImGui::Text("Capturing, %u frames left", traceStats.framesLeft);
+		else if (ImGui::Button("Capture (F12)"))
+			startTraceCapture = true;
+		if (!traceStats.lastFile.empty())
+			ImGui::Text("Last capture: %s", traceStats.lastFile.c_str());
+		ImGui::Text("Threads: %u, events: %llu recorded, %llu dropped", traceStats.numThreads, traceStats.eventsRecorded, traceStats.eventsDropped);
+#if VG3O_TRACE
+		if (ImGui::Button("Measure Scope Overhead"))
+			runTraceBenchmark = true;
+		if (traceOverhead.idleNanoseconds > 0)
+			ImGui::Text("Per scope: %.2fns idle, %.2fns recording", traceOverhead.idleNanoseconds, traceOverhead.recordingNanoseconds);
+#else
+		ImGui::Text("Scopes compiled out (VG3O_TRACE=OFF)");
+#endif
+		ImGui::End();
+	}
 	{ // Animator Settings
 		ImGui::Begin("Animator");
 
@@ -286,14 +1019,33 @@ void framebufferSizeCallback(GLFWwindow* window, int width, int height)
 /// <param name="width">Window width</param>
 /// <param name="height">Window height</param>
 /// <returns>Returns window handle on success or null on fail</returns>
-GLFWwindow* initWindow(const char* title, int width, int height) {
+GLFWwindow* initWindow(const char* title, int width, int height, bool headless) {
 	printf("Initializing...");
+	if (headless) {
+		// no window system at all, the context comes from EGL's surfaceless platform or OSMesa
+		glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+	}
 	if (!glfwInit()) {
 		printf("GLFW failed to init!");
 		return nullptr;
 	}
 
-	GLFWwindow* window = glfwCreateWindow(width, height, title, NULL, NULL);
+	GLFWwindow* window = NULL;
+	if (headless) {
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+		window = glfwCreateWindow(width, height, title, NULL, NULL);
+		if (window == NULL) {
+			printf("EGL context failed, trying OSMesa...");
+			glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+			window = glfwCreateWindow(width, height, title, NULL, NULL);
+		}
+	}
+	else
+		window = glfwCreateWindow(width, height, title, NULL, NULL);
 	if (window == NULL) {
 		printf("GLFW failed to create window");
 		return nullptr;
@@ -305,6 +1057,9 @@ GLFWwindow* initWindow(const char* title, int width, int height) {
 		return nullptr;
 	}
 
+	if (headless) // nothing is drawn on top, and there's no input to hand it
+		return window;
+
 	//Initialize ImGUI
 	IMGUI_CHECKVERSION();
 	ImGui::CreateContext();
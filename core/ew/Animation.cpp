@@ -1,4 +1,5 @@
 #include "Animation.h"
+#include "Trace.h"
 #include <cmath>
 #include <algorithm>
 #include <iostream>
@@ -121,6 +122,7 @@ namespace vg3o {
 
 	ew::Transform Animator::UpdateAnimations(float dt)
 	{
+		VG3O_TRACE_SCOPE("Animator::UpdateAnimations");
 		if (playing)
 		{
 			dt *= playbackSpeed;
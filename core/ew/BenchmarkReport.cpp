@@ -0,0 +1,111 @@
+#include "BenchmarkReport.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <math.h>
+#include <stdio.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#define PSAPI_VERSION 2 // K32GetProcessMemoryInfo from kernel32, no psapi.lib needed
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+namespace vg3o {
+	std::string escapeJson(const std::string& text) {
+		std::string out;
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\') out += '\\';
+			if ((unsigned char)c < 0x20) continue;
+			out += c;
+		}
+		return out;
+	}
+
+	SampleSummary summarizeSamples(std::vector<double> samples) {
+		SampleSummary summary;
+		if (samples.empty())
+			return summary;
+		std::sort(samples.begin(), samples.end());
+		double sum = 0;
+		for (double sample : samples)
+			sum += sample;
+		summary.average = sum / samples.size();
+		summary.min = samples.front();
+		summary.p50 = getPercentile(samples, 0.50);
+		summary.p95 = getPercentile(samples, 0.95);
+		summary.p99 = getPercentile(samples, 0.99);
+		summary.max = samples.back();
+		summary.count = samples.size();
+		return summary;
+	}
+
+	size_t getPeakResidentBytes() {
+#if defined(_WIN32)
+		PROCESS_MEMORY_COUNTERS counters;
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+			return counters.PeakWorkingSetSize;
+		return 0;
+#elif defined(__APPLE__)
+		struct rusage usage;
+		return getrusage(RUSAGE_SELF, &usage) == 0 ? (size_t)usage.ru_maxrss : 0; // bytes on macOS
+#elif defined(__unix__)
+		struct rusage usage;
+		return getrusage(RUSAGE_SELF, &usage) == 0 ? (size_t)usage.ru_maxrss * 1024 : 0; // kilobytes on Linux
+#else
+		return 0;
+#endif
+	}
+
+	void BenchmarkReport::setInfo(const std::string& key, const std::string& value) {
+		mInfo[key] = value;
+	}
+
+	void BenchmarkReport::addMetric(const std::string& name, double value, const std::string& unit) {
+		mMetrics[name] = { value, unit };
+	}
+
+	void BenchmarkReport::addSamples(const std::string& name, const std::vector<double>& samples, const std::string& unit) {
+		SampleSummary summary = summarizeSamples(samples);
+		addMetric(name + ".avg", summary.average, unit);
+		addMetric(name + ".p50", summary.p50, unit);
+		addMetric(name + ".p95", summary.p95, unit);
+		addMetric(name + ".p99", summary.p99, unit);
+		addMetric(name + ".max", summary.max, unit);
+	}
+
+	bool BenchmarkReport::write(const std::string& path) const {
+		std::ofstream file(path, std::ios::trunc);
+		if (!file.is_open())
+		{
+			std::cout << "ERROR::BENCHMARKREPORT:: Could not write " << path << std::endl;
+			return false;
+		}
+		file << "{\n  \"info\": {";
+		bool first = true;
+		for (const auto& info : mInfo)
+		{
+			file << (first ? "\n" : ",\n") << "    \"" << escapeJson(info.first) << "\": \"" << escapeJson(info.second) << "\"";
+			first = false;
+		}
+		file << "\n  },\n  \"metrics\": {";
+		first = true;
+		char value[64];
+		for (const auto& metric : mMetrics)
+		{
+			// JSON has no NaN or infinity
+			snprintf(value, sizeof(value), "%.6g", isfinite(metric.second.value) ? metric.second.value : 0.0);
+			file << (first ? "\n" : ",\n") << "    \"" << escapeJson(metric.first) << "\": { \"value\": " << value
+				<< ", \"unit\": \"" << escapeJson(metric.second.unit) << "\" }";
+			first = false;
+		}
+		file << "\n  }\n}\n";
+		return file.good();
+	}
+}
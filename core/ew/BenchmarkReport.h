@@ -0,0 +1,76 @@
+/*
+	BenchmarkReport // Brandon Salvietti
+
+	Flat JSON report for benchmark runs. Every number is a named metric with a unit, sample sets are
+	summarized into average/percentile metrics, so two reports can be compared key by key without
+	knowing what produced them.
+*/
+
+#pragma once
+#include <stddef.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace vg3o {
+
+	struct SampleSummary {
+		double average = 0;
+		double min = 0;
+		double p50 = 0;
+		double p95 = 0;
+		double p99 = 0;
+		double max = 0;
+		size_t count = 0;
+	};
+
+	/// <summary>
+	/// Nearest rank percentile of samples already sorted ascending. Must not be empty.
+	/// </summary>
+	/// <param name="p">0 to 1.</param>
+	template <typename T>
+	T getPercentile(const std::vector<T>& sorted, double p) {
+		return sorted[(size_t)(p * (sorted.size() - 1) + 0.5)];
+	}
+
+	/// <summary>
+	/// Nearest rank percentiles, all zero for no samples.
+	/// </summary>
+	SampleSummary summarizeSamples(std::vector<double> samples);
+
+	/// <summary>
+	/// Escapes quotes and backslashes and drops control characters, for names written into JSON strings.
+	/// </summary>
+	std::string escapeJson(const std::string& text);
+
+	/// <summary>
+	/// Peak resident memory of this process, 0 where the platform can't say.
+	/// </summary>
+	size_t getPeakResidentBytes();
+
+	class BenchmarkReport {
+	public:
+		/// <summary>
+		/// Describes the run, e.g. the renderer or the frame count. Not compared.
+		/// </summary>
+		void setInfo(const std::string& key, const std::string& value);
+
+		void addMetric(const std::string& name, double value, const std::string& unit);
+
+		/// <summary>
+		/// Adds name.avg, name.p50, name.p95, name.p99 and name.max.
+		/// </summary>
+		void addSamples(const std::string& name, const std::vector<double>& samples, const std::string& unit);
+
+		/// <returns>False if the file couldn't be written.</returns>
+		bool write(const std::string& path) const;
+	private:
+		struct Metric {
+			double value;
+			std::string unit;
+		};
+		// sorted, so reports diff cleanly
+		std::map<std::string, std::string> mInfo;
+		std::map<std::string, Metric> mMetrics;
+	};
+}
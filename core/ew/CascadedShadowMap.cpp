@@ -0,0 +1,240 @@
+#include "CascadedShadowMap.h"
+#include "GLState.h"
+#include "external/glad.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <iostream>
+#include <math.h>
+
+namespace vg3o {
+	CascadedShadowMap::CascadedShadowMap(const CascadedShadowSettings& settings) {
+		mSettings = settings;
+	}
+
+	CascadedShadowMap::~CascadedShadowMap() {
+		release();
+	}
+
+	/*
+		----
+		Textures
+		----
+	*/
+	void CascadedShadowMap::allocate() {
+		release();
+		mAllocated = mSettings;
+		mNumCascades = mSettings.numCascades;
+		unsigned int resolution = mSettings.resolution;
+
+		unsigned int* textures[2] = { &mShadowTexture, &mStaticTexture };
+		for (unsigned int* texture : textures)
+		{
+			glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, texture);
+			glTextureStorage3D(*texture, 1, mSettings.depthFormat, resolution, resolution, mNumCascades);
+			glTextureParameteri(*texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTextureParameteri(*texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			// outside a cascade is lit rather than repeating the opposite edge
+			float border[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+			glTextureParameteri(*texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+			glTextureParameteri(*texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+			glTextureParameterfv(*texture, GL_TEXTURE_BORDER_COLOR, border);
+		}
+
+		for (unsigned int cascade = 0; cascade < mNumCascades; cascade++)
+		{
+			RenderTarget& target = mTargets[cascade];
+			target.depthTexture = mShadowTexture;
+			target.width = resolution;
+			target.height = resolution;
+			unsigned int* framebuffers[2] = { &target.framebuffer, &mStaticFramebuffers[cascade] };
+			unsigned int layerTextures[2] = { mShadowTexture, mStaticTexture };
+			for (int i = 0; i < 2; i++)
+			{
+				glCreateFramebuffers(1, framebuffers[i]);
+				glNamedFramebufferTextureLayer(*framebuffers[i], GL_DEPTH_ATTACHMENT, layerTextures[i], 0, cascade);
+				glNamedFramebufferDrawBuffer(*framebuffers[i], GL_NONE);
+				glNamedFramebufferReadBuffer(*framebuffers[i], GL_NONE);
+				if (glCheckNamedFramebufferStatus(*framebuffers[i], GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+					std::cout << "ERROR::CASCADEDSHADOWMAP:: Cascade framebuffer is not complete!" << std::endl;
+			}
+
+			// views need a name that was never bound, so no glCreateTextures here
+			glGenTextures(1, &mLayerViews[cascade]);
+			glTextureView(mLayerViews[cascade], GL_TEXTURE_2D, mShadowTexture, mSettings.depthFormat, 0, 1, cascade, 1);
+			glTextureParameteri(mLayerViews[cascade], GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTextureParameteri(mLayerViews[cascade], GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+			mExtents[cascade] = 0.0f;
+			mStaticValid[cascade] = false;
+		}
+
+		// sampled through a sampler2DArrayShadow, the filter makes each fetch a bilinear blend of four comparisons
+		glTextureParameteri(mShadowTexture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTextureParameteri(mShadowTexture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTextureParameteri(mShadowTexture, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+		glTextureParameteri(mShadowTexture, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+		// the same depths without the comparison, for reading blocker depths. Views start with a copy of the
+		// parent's parameters, compare mode included, so it has to be turned off here
+		glGenTextures(1, &mDepthView);
+		glTextureView(mDepthView, GL_TEXTURE_2D_ARRAY, mShadowTexture, mSettings.depthFormat, 0, 1, 0, mNumCascades);
+		glTextureParameteri(mDepthView, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+		glTextureParameteri(mDepthView, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTextureParameteri(mDepthView, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTextureParameteri(mDepthView, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(mDepthView, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+
+	void CascadedShadowMap::release() {
+		for (unsigned int cascade = 0; cascade < MAX_SHADOW_CASCADES; cascade++)
+		{
+			unsigned int* framebuffers[2] = { &mTargets[cascade].framebuffer, &mStaticFramebuffers[cascade] };
+			for (unsigned int* framebuffer : framebuffers)
+			{
+				if (*framebuffer == 0) continue;
+				glDeleteFramebuffers(1, framebuffer);
+				GLState::framebufferDeleted(*framebuffer);
+				*framebuffer = 0;
+			}
+			if (mLayerViews[cascade] != 0)
+			{
+				glDeleteTextures(1, &mLayerViews[cascade]);
+				GLState::textureDeleted(mLayerViews[cascade]);
+				mLayerViews[cascade] = 0;
+			}
+			mTargets[cascade] = RenderTarget();
+			mStaticValid[cascade] = false;
+		}
+		unsigned int* textures[3] = { &mDepthView, &mShadowTexture, &mStaticTexture };
+		for (unsigned int* texture : textures)
+		{
+			if (*texture == 0) continue;
+			glDeleteTextures(1, texture);
+			GLState::textureDeleted(*texture);
+			*texture = 0;
+		}
+		mNumCascades = 0;
+	}
+
+	/*
+		----
+		Fitting
+		----
+	*/
+	void CascadedShadowMap::update(const ew::Camera& camera, const glm::vec3& lightDirection) {
+		mSettings.numCascades = std::max(1u, std::min(mSettings.numCascades, MAX_SHADOW_CASCADES));
+		mSettings.resolution = std::max(1u, mSettings.resolution);
+		if (mShadowTexture == 0 || mSettings.numCascades != mAllocated.numCascades || mSettings.resolution != mAllocated.resolution
+			|| mSettings.depthFormat != mAllocated.depthFormat)
+			allocate();
+
+		glm::vec3 direction = glm::length(lightDirection) > 0.0f ? glm::normalize(lightDirection) : glm::vec3(0.0f, -1.0f, 0.0f);
+		if (direction != mLightDirection)
+		{
+			mLightDirection = direction;
+			glm::vec3 up = glm::abs(glm::dot(direction, glm::vec3(0, 1, 0))) > 0.99f ? glm::vec3(0, 0, 1) : glm::vec3(0, 1, 0);
+			mLightView = glm::lookAt(glm::vec3(0.0f), direction, up);
+			// every cascade recenters in the new light space
+			for (unsigned int cascade = 0; cascade < mNumCascades; cascade++)
+				mExtents[cascade] = 0.0f;
+		}
+
+		float nearDepth = camera.nearPlane;
+		float farDepth = std::max(std::min(camera.farPlane, mSettings.maxDistance), nearDepth + 0.001f);
+		glm::mat4 cameraToWorld = glm::inverse(camera.viewMatrix());
+		float tanHalfFov = tanf(glm::radians(camera.fov) * 0.5f);
+		float lambda = glm::clamp(mSettings.splitLambda, 0.0f, 1.0f);
+		auto split = [&](float t) {
+			float logarithmic = nearDepth * powf(farDepth / nearDepth, t);
+			float uniform = nearDepth + (farDepth - nearDepth) * t;
+			return lambda * logarithmic + (1.0f - lambda) * uniform;
+		};
+
+		for (unsigned int cascade = 0; cascade < mNumCascades; cascade++)
+		{
+			float sliceNear = cascade == 0 ? nearDepth : split((float)cascade / mNumCascades);
+			float sliceFar = split((float)(cascade + 1) / mNumCascades);
+
+			// the sphere is centered on the view axis, so turning the camera never changes its radius
+			float halfDepth = (sliceFar - sliceNear) * 0.5f;
+			float radius = 0.0f;
+			for (float depth : { sliceNear, sliceFar })
+			{
+				float halfHeight = camera.orthographic ? camera.orthoHeight * 0.5f : depth * tanHalfFov;
+				radius = std::max(radius, glm::length(glm::vec3(halfHeight * camera.aspectRatio, halfHeight, halfDepth)));
+			}
+			radius = ceilf(radius * 16.0f) / 16.0f; // float noise in the corners shouldn't count as a change
+			glm::vec3 worldCenter = glm::vec3(cameraToWorld * glm::vec4(0.0f, 0.0f, -(sliceNear + halfDepth), 1.0f));
+			glm::vec3 lightCenter = glm::vec3(mLightView * glm::vec4(worldCenter, 1.0f));
+
+			float extent = radius * (1.0f + std::max(mSettings.cacheMargin, 0.0f));
+			glm::vec3 offset = glm::abs(lightCenter - mCenters[cascade]);
+			float slack = extent - radius;
+			if (extent != mExtents[cascade] || offset.x > slack || offset.y > slack || offset.z > slack)
+			{
+				// whole texels, so the rasterized edges land on the same texels until the next recenter
+				float texelSize = 2.0f * extent / mSettings.resolution;
+				mCenters[cascade] = glm::floor(lightCenter / texelSize + 0.5f) * texelSize;
+				mExtents[cascade] = extent;
+				glm::vec3 center = mCenters[cascade];
+				// the light looks down -z, casters up to casterDistance in front of the cascade still land in it
+				glm::mat4 projection = glm::ortho(center.x - extent, center.x + extent, center.y - extent, center.y + extent,
+					-center.z - extent - mSettings.casterDistance, -center.z + extent);
+				mLightMatrices[cascade] = projection * mLightView;
+				mStaticValid[cascade] = false;
+			}
+
+			ShadowCascadeStats& stats = mStats[cascade];
+			stats.nearDepth = sliceNear;
+			stats.farDepth = sliceFar;
+			stats.texelSize = 2.0f * extent / mSettings.resolution;
+			stats.staticRendered = false;
+		}
+	}
+
+	glm::vec4 CascadedShadowMap::getSplits() const {
+		glm::vec4 splits(0.0f);
+		for (unsigned int cascade = 0; cascade < mNumCascades; cascade++)
+			splits[cascade] = mStats[cascade].farDepth;
+		return splits;
+	}
+
+	void CascadedShadowMap::invalidateStatic() {
+		for (unsigned int cascade = 0; cascade < MAX_SHADOW_CASCADES; cascade++)
+			mStaticValid[cascade] = false;
+	}
+
+	/*
+		----
+		Rendering
+		----
+	*/
+	void CascadedShadowMap::beginStatic(unsigned int cascade) {
+		GLState::bindFramebuffer(mStaticFramebuffers[cascade]);
+		glViewport(0, 0, mAllocated.resolution, mAllocated.resolution);
+		GLState::setDepthWrite(true);
+		glClear(GL_DEPTH_BUFFER_BIT);
+	}
+
+	void CascadedShadowMap::endStatic(unsigned int cascade) {
+		mStaticValid[cascade] = true;
+		mStats[cascade].staticRenders++;
+		mStats[cascade].staticRendered = true;
+	}
+
+	void CascadedShadowMap::beginCascade(unsigned int cascade) {
+		mTargets[cascade].use();
+		if (mStaticValid[cascade])
+		{
+			glCopyImageSubData(mStaticTexture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, cascade,
+				mShadowTexture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, cascade, mAllocated.resolution, mAllocated.resolution, 1);
+		}
+		else
+		{
+			// nothing static was drawn, start from empty
+			GLState::setDepthWrite(true);
+			glClear(GL_DEPTH_BUFFER_BIT);
+		}
+	}
+}
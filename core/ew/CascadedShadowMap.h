@@ -0,0 +1,131 @@
+/*
+	CascadedShadowMap // Brandon Salvietti
+
+	Directional light shadows split into cascades along the camera's view depth, each a layer of one
+	depth texture array at a fixed resolution. A cascade covers a bounding sphere of its slice of the
+	camera frustum, so its size doesn't change as the camera turns, and its center is snapped to whole
+	shadow texels so edges don't shimmer as the camera moves.
+
+	Casters are split in two. Static ones are rendered into a separate cache array and only redrawn
+	when their cascade's light matrix changes or invalidateStatic() is called. Dynamic ones are drawn
+	every frame over a copy of the cache. To keep the matrices still while the camera moves around,
+	each cascade covers a margin past its sphere and only recenters once the sphere leaves it.
+*/
+
+#pragma once
+#include "RenderTargetPool.h"
+#include "camera.h"
+#include <glm/glm.hpp>
+
+namespace vg3o {
+
+	const unsigned int MAX_SHADOW_CASCADES = 4;
+
+	struct CascadedShadowSettings {
+		unsigned int numCascades = 4; // up to MAX_SHADOW_CASCADES
+		unsigned int resolution = 1024; // per cascade
+		unsigned int depthFormat = 0x81A6; // GL_DEPTH_COMPONENT24
+		float maxDistance = 50.0f; // view depth the last cascade ends at, or the camera's far plane if that is nearer
+		float splitLambda = 0.75f; // 0 splits the depth range evenly, 1 logarithmically
+		float cacheMargin = 0.25f; // extra coverage around each cascade's sphere, as a fraction of its radius
+		float casterDistance = 50.0f; // how far toward the light casters outside a cascade are still drawn into it
+	};
+
+	struct ShadowCascadeStats {
+		float nearDepth = 0; // view depth range this cascade is used for
+		float farDepth = 0;
+		float texelSize = 0; // world units covered by one shadow texel
+		unsigned int staticRenders = 0; // times the static cache was redrawn since startup
+		bool staticRendered = false; // redrawn this frame
+	};
+
+	class CascadedShadowMap {
+	public:
+		CascadedShadowMap(const CascadedShadowSettings& settings = CascadedShadowSettings());
+		~CascadedShadowMap();
+		CascadedShadowMap(const CascadedShadowMap&) = delete;
+		CascadedShadowMap& operator=(const CascadedShadowMap&) = delete;
+
+		/// <summary>
+		/// Fits the cascades to the camera for this frame. Any cascade whose light matrix changed needs its static casters again.
+		/// Changing the settings reallocates the textures on the next update.
+		/// </summary>
+		/// <param name="lightDirection">The direction light travels in, need not be normalized.</param>
+		void update(const ew::Camera& camera, const glm::vec3& lightDirection);
+
+		/// <summary>
+		/// Static casters moved, appeared or went away. Every cascade's cache is redrawn.
+		/// </summary>
+		void invalidateStatic();
+
+		/// <summary>
+		/// True if static casters have to be submitted and drawn for this cascade this frame.
+		/// </summary>
+		bool isStaticDirty(unsigned int cascade) const { return !mStaticValid[cascade]; }
+
+		/// <summary>
+		/// Binds and clears the cascade's static cache layer. Draw the static casters, then call endStatic().
+		/// </summary>
+		void beginStatic(unsigned int cascade);
+		void endStatic(unsigned int cascade);
+
+		/// <summary>
+		/// Copies the static cache into the cascade's layer and binds it, ready for the dynamic casters.
+		/// </summary>
+		void beginCascade(unsigned int cascade);
+
+		/// <summary>
+		/// The cascade's layer as a framebuffer, for importing into the render graph as a pass's write.
+		/// </summary>
+		const RenderTarget& getTarget(unsigned int cascade) const { return mTargets[cascade]; }
+
+		/// <summary>
+		/// The depth array the lit pass samples, one layer per cascade. Compares against a reference depth
+		/// with linear filtering, so sample it as a sampler2DArrayShadow.
+		/// </summary>
+		unsigned int getTexture() const { return mShadowTexture; }
+		/// <summary>
+		/// A view of the same array without the comparison, for shaders that need the stored depths (blocker searches).
+		/// </summary>
+		unsigned int getDepthView() const { return mDepthView; }
+		/// <summary>
+		/// A 2D view of one cascade's layer, for previews.
+		/// </summary>
+		unsigned int getLayerView(unsigned int cascade) const { return mLayerViews[cascade]; }
+
+		/// <summary>
+		/// World to light clip space for the cascade.
+		/// </summary>
+		const glm::mat4& getLightMatrix(unsigned int cascade) const { return mLightMatrices[cascade]; }
+		/// <summary>
+		/// View depth each cascade ends at, unused cascades are zero.
+		/// </summary>
+		glm::vec4 getSplits() const;
+
+		unsigned int getNumCascades() const { return mNumCascades; }
+		const ShadowCascadeStats& getStats(unsigned int cascade) const { return mStats[cascade]; }
+		CascadedShadowSettings& getSettings() { return mSettings; }
+	private:
+		void allocate();
+		void release();
+
+		CascadedShadowSettings mSettings;
+		CascadedShadowSettings mAllocated; // what the textures were made with
+		unsigned int mNumCascades = 0;
+
+		unsigned int mShadowTexture = 0;
+		unsigned int mStaticTexture = 0;
+		unsigned int mDepthView = 0;
+		RenderTarget mTargets[MAX_SHADOW_CASCADES];
+		unsigned int mStaticFramebuffers[MAX_SHADOW_CASCADES] = {};
+		unsigned int mLayerViews[MAX_SHADOW_CASCADES] = {};
+
+		glm::vec3 mLightDirection = glm::vec3(0.0f);
+		glm::mat4 mLightView = glm::mat4(1.0f);
+		glm::mat4 mLightMatrices[MAX_SHADOW_CASCADES];
+		glm::vec3 mCenters[MAX_SHADOW_CASCADES]; // light space, snapped to texels
+		float mExtents[MAX_SHADOW_CASCADES] = {}; // half the width of each cascade
+		bool mStaticValid[MAX_SHADOW_CASCADES] = {};
+		ShadowCascadeStats mStats[MAX_SHADOW_CASCADES];
+	};
+}
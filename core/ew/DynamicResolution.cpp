@@ -0,0 +1,76 @@
+#include "DynamicResolution.h"
+#include "external/glad.h"
+
+#include <math.h>
+
+namespace vg3o {
+	DynamicResolution::DynamicResolution(const DynamicResolutionSettings& settings) {
+		mSettings = settings;
+		mScale = settings.maxScale;
+		for (FrameQueries& frame : mFrames)
+		{
+			glGenQueries(1, &frame.begin);
+			glGenQueries(1, &frame.end);
+		}
+		mScaleHistory.resize(settings.historySize > 0 ? settings.historySize : 1, mScale);
+		mGpuHistory.resize(mScaleHistory.size(), 0.0f);
+	}
+
+	DynamicResolution::~DynamicResolution() {
+		for (FrameQueries& frame : mFrames)
+		{
+			glDeleteQueries(1, &frame.begin);
+			glDeleteQueries(1, &frame.end);
+		}
+	}
+
+	void DynamicResolution::beginFrame() {
+		mCurrent = (mCurrent + 1) % NUM_FRAMES;
+		// oldest first, results arrive in order so the first unfinished one ends the search
+		for (unsigned int i = 0; i < NUM_FRAMES; i++)
+		{
+			FrameQueries& frame = mFrames[(mCurrent + i) % NUM_FRAMES];
+			if (!frame.pending) continue;
+			int available = 0;
+			glGetQueryObjectiv(frame.end, GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available) break;
+			GLuint64 begin = 0, end = 0;
+			glGetQueryObjectui64v(frame.begin, GL_QUERY_RESULT, &begin);
+			glGetQueryObjectui64v(frame.end, GL_QUERY_RESULT, &end);
+			frame.pending = false;
+			updateScale((float)((double)(end - begin) / 1000000.0));
+		}
+
+		// the GPU is more than NUM_FRAMES behind, skip timing rather than wait on it
+		mTiming = !mFrames[mCurrent].pending;
+		if (mTiming)
+			glQueryCounter(mFrames[mCurrent].begin, GL_TIMESTAMP);
+	}
+
+	void DynamicResolution::endFrame() {
+		if (!mTiming) return;
+		glQueryCounter(mFrames[mCurrent].end, GL_TIMESTAMP);
+		mFrames[mCurrent].pending = true;
+		mTiming = false;
+	}
+
+	void DynamicResolution::updateScale(float gpuMilliseconds) {
+		mGpuMilliseconds = gpuMilliseconds;
+		float minScale = fminf(mSettings.minScale, mSettings.maxScale);
+		if (!mSettings.enabled)
+			mScale = mSettings.maxScale;
+		else if (gpuMilliseconds > 0.0f)
+		{
+			// cost goes with the pixel count, the square of the scale
+			float wanted = mScale * sqrtf(mSettings.targetMilliseconds * mSettings.headroom / gpuMilliseconds);
+			float step = wanted - mScale;
+			step = fmaxf(fminf(step, mSettings.maxIncrease), -mSettings.maxDecrease);
+			mScale += step;
+		}
+		mScale = fmaxf(fminf(mScale, mSettings.maxScale), minScale);
+
+		mScaleHistory[mHistoryOffset] = mScale;
+		mGpuHistory[mHistoryOffset] = gpuMilliseconds;
+		mHistoryOffset = (mHistoryOffset + 1) % (unsigned int)mScaleHistory.size();
+	}
+}
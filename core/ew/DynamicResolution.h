@@ -0,0 +1,79 @@
+/*
+	DynamicResolution // Brandon Salvietti
+
+	Picks the fraction of the screen to render at from how long the GPU took on recent frames.
+	Frames are timed with a small ring of timestamp queries that are read back a few frames late
+	instead of stalling, and the scale moves toward whatever would bring the time back under budget.
+*/
+
+#pragma once
+#include <vector>
+
+namespace vg3o {
+
+	struct DynamicResolutionSettings {
+		bool enabled = true; // off holds the scale at maxScale
+		float targetMilliseconds = 16.6f; // GPU time per frame to stay under
+		float headroom = 0.9f; // aims for this much of the target, so small spikes don't go over
+		float minScale = 0.5f;
+		float maxScale = 1.0f;
+		float maxDecrease = 0.1f; // scale change per measured frame when over budget
+		float maxIncrease = 0.02f; // and when under, slower so it doesn't oscillate
+		unsigned int historySize = 256; // frames kept for getScaleHistory()
+	};
+
+	class DynamicResolution {
+	public:
+		DynamicResolution(const DynamicResolutionSettings& settings = DynamicResolutionSettings());
+		~DynamicResolution();
+		DynamicResolution(const DynamicResolution&) = delete;
+		DynamicResolution& operator=(const DynamicResolution&) = delete;
+
+		/// <summary>
+		/// Reads back any finished frame timings, updates the scale and starts timing this frame. Call before the first draw.
+		/// </summary>
+		void beginFrame();
+		/// <summary>
+		/// Stops timing this frame. Call after the last draw, before swapping buffers.
+		/// </summary>
+		void endFrame();
+
+		/// <summary>
+		/// Fraction of the output width and height to render this frame.
+		/// </summary>
+		float getScale() const { return mScale; }
+		/// <summary>
+		/// The most recent GPU frame time read back, a few frames old.
+		/// </summary>
+		float getGpuMilliseconds() const { return mGpuMilliseconds; }
+
+		/// <summary>
+		/// Ring of the scale and GPU time per frame, oldest at getHistoryOffset(). Laid out for ImGui::PlotLines.
+		/// </summary>
+		const std::vector<float>& getScaleHistory() const { return mScaleHistory; }
+		const std::vector<float>& getGpuHistory() const { return mGpuHistory; }
+		int getHistoryOffset() const { return (int)mHistoryOffset; }
+
+		DynamicResolutionSettings& getSettings() { return mSettings; }
+	private:
+		static const unsigned int NUM_FRAMES = 4; // in flight before a query is read back
+
+		struct FrameQueries {
+			unsigned int begin = 0;
+			unsigned int end = 0;
+			bool pending = false;
+		};
+
+		void updateScale(float gpuMilliseconds);
+
+		DynamicResolutionSettings mSettings;
+		FrameQueries mFrames[NUM_FRAMES];
+		unsigned int mCurrent = 0;
+		bool mTiming = false; // this frame's queries were issued
+		float mScale = 1.0f;
+		float mGpuMilliseconds = 0.0f;
+		std::vector<float> mScaleHistory;
+		std::vector<float> mGpuHistory;
+		unsigned int mHistoryOffset = 0;
+	};
+}
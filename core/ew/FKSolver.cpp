@@ -1,4 +1,5 @@
 #include "FKSolver.h"
+#include "Trace.h"
 
 using namespace vg3o;
 
@@ -14,4 +15,10 @@ void SolveFK(Joint* joint)
 	}
 	for (auto& child : joint->children)
 		SolveFK(child);
+}
+
+void vg3o::SolveFK(Skeleton* skeleton, Joint* joint)
+{
+	VG3O_TRACE_SCOPE("SolveFK");
+	::SolveFK(joint != nullptr ? joint : skeleton->root);
 }
\ No newline at end of file
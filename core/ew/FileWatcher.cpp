@@ -0,0 +1,98 @@
+#include "FileWatcher.h"
+
+#include <iostream>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+namespace vg3o {
+	FileWatcher::FileWatcher() {
+#ifdef __linux__
+		mInotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (mInotify < 0)
+			std::cout << "ERROR::FILEWATCHER:: inotify_init1 failed, errno " << errno << std::endl;
+#endif
+	}
+
+	FileWatcher::~FileWatcher() {
+#ifdef __linux__
+		if (mInotify >= 0)
+			close(mInotify);
+#endif
+	}
+
+	std::string FileWatcher::normalize(const std::string& path) {
+		std::error_code error;
+		std::filesystem::path absolute = std::filesystem::absolute(path, error);
+		if (error)
+			absolute = path;
+		return absolute.lexically_normal().generic_string();
+	}
+
+	void FileWatcher::watch(const std::string& path) {
+		std::string normalized = normalize(path);
+		if (mWatched.count(normalized) != 0)
+			return;
+		mWatched[normalized] = path;
+#ifdef __linux__
+		if (mInotify < 0)
+			return;
+		// watch the directory, editors often save by writing a new file and renaming it over the old one
+		std::string directory = std::filesystem::path(normalized).parent_path().generic_string();
+		int wd = inotify_add_watch(mInotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+		if (wd < 0)
+		{
+			std::cout << "ERROR::FILEWATCHER:: Can't watch " << directory << ", errno " << errno << std::endl;
+			return;
+		}
+		mDirectories[wd] = directory;
+#else
+		std::error_code error;
+		mWriteTimes[normalized] = std::filesystem::last_write_time(normalized, error);
+#endif
+	}
+
+	std::vector<std::string> FileWatcher::poll() {
+		std::unordered_set<std::string> changed;
+#ifdef __linux__
+		if (mInotify >= 0)
+		{
+			alignas(inotify_event) char buffer[4096];
+			while (true)
+			{
+				ssize_t length = read(mInotify, buffer, sizeof(buffer));
+				if (length <= 0)
+					break; // EAGAIN, nothing left
+				for (ssize_t i = 0; i < length; )
+				{
+					const inotify_event* event = (const inotify_event*)(buffer + i);
+					i += sizeof(inotify_event) + event->len;
+					auto dir = mDirectories.find(event->wd);
+					if (dir == mDirectories.end() || event->len == 0)
+						continue;
+					std::string path = dir->second + "/" + event->name;
+					if (mWatched.count(path) != 0)
+						changed.insert(path);
+				}
+			}
+		}
+#else
+		for (auto& it : mWriteTimes)
+		{
+			std::error_code error;
+			std::filesystem::file_time_type time = std::filesystem::last_write_time(it.first, error);
+			if (!error && time != it.second)
+			{
+				it.second = time;
+				changed.insert(it.first);
+			}
+		}
+#endif
+		std::vector<std::string> result;
+		for (const std::string& path : changed)
+			result.push_back(mWatched[path]);
+		return result;
+	}
+}
@@ -0,0 +1,42 @@
+/*
+	FileWatcher // Brandon Salvietti
+
+	Reports files that changed on disk. Uses inotify on Linux so polling is a single non-blocking read,
+	other platforms compare modification times.
+*/
+
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <filesystem>
+
+namespace vg3o {
+
+	class FileWatcher {
+	public:
+		FileWatcher();
+		~FileWatcher();
+		FileWatcher(const FileWatcher&) = delete;
+		FileWatcher& operator=(const FileWatcher&) = delete;
+
+		void watch(const std::string& path);
+
+		/// <summary>
+		/// Never blocks.
+		/// </summary>
+		/// <returns>Watched paths written since the last call, each listed once, in the form they were passed to watch().</returns>
+		std::vector<std::string> poll();
+	private:
+		static std::string normalize(const std::string& path);
+
+		std::unordered_map<std::string, std::string> mWatched; // normalized -> path as given
+#ifdef __linux__
+		int mInotify = -1;
+		std::unordered_map<int, std::string> mDirectories; // watch descriptor -> normalized directory
+#else
+		std::unordered_map<std::string, std::filesystem::file_time_type> mWriteTimes;
+#endif
+	};
+}
@@ -1,6 +1,7 @@
 #include "Framebuffer.h"
 #include "glm/glm.hpp"
 #include "external/glad.h"
+#include "GLState.h"
 
 #include <iostream>
 
@@ -8,15 +9,46 @@
 namespace vg3o {
 	unsigned int ScreenBuffer::mVAO = 0;
 	void ScreenBuffer::draw() {
-		glBindVertexArray(mVAO);
+		GLState::bindVertexArray(mVAO);
 		glDrawArrays(GL_TRIANGLES, 0, 6);
-		glBindVertexArray(0);
+		GLState::countDrawCall();
 	}
 	void ScreenBuffer::useBuffer() {
-		glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+		GLState::bindFramebuffer(mFramebuffer);
 	}
 	void ScreenBuffer::useDefaultBuffer() {
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		GLState::bindFramebuffer(0);
+	}
+	ScreenBuffer::~ScreenBuffer() {
+		release();
+	}
+	void ScreenBuffer::resize(int width, int height) {
+		if (width == mWidth && height == mHeight)
+			return;
+		release();
+		mFramebuffer = loadFramebuffer(width, height, mNumColorBuffers, mIsDepthMap);
+	}
+	void ScreenBuffer::release() {
+		for (unsigned int texture : mColorBuffers)
+		{
+			glDeleteTextures(1, &texture);
+			GLState::textureDeleted(texture);
+		}
+		mColorBuffers.clear();
+		if (mDepthTexture != 0)
+		{
+			glDeleteTextures(1, &mDepthTexture);
+			GLState::textureDeleted(mDepthTexture);
+			mDepthTexture = 0;
+		}
+		glDeleteRenderbuffers(1, &mRenderbuffer);
+		mRenderbuffer = 0;
+		if (mFramebuffer != 0)
+		{
+			glDeleteFramebuffers(1, &mFramebuffer);
+			GLState::framebufferDeleted(mFramebuffer);
+			mFramebuffer = 0;
+		}
 	}
 	void ScreenBuffer::genScreenQuad() {
 		float buffferVertices[] = {
@@ -33,7 +65,7 @@ namespace vg3o {
 		unsigned int quadVAO, quadVBO;
 		glGenVertexArrays(1, &quadVAO);
 		glGenBuffers(1, &quadVBO);
-		glBindVertexArray(quadVAO);
+		GLState::bindVertexArray(quadVAO);
 		glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(buffferVertices), &buffferVertices, GL_STATIC_DRAW);
 
@@ -47,10 +79,12 @@ namespace vg3o {
 
 	unsigned int ScreenBuffer::loadFramebuffer(const int SCREEN_WIDTH, const int SCREEN_HEIGHT, int colorBuffers, bool depthMap) {
 		mColorBuffers.clear();
+		mWidth = SCREEN_WIDTH;
+		mHeight = SCREEN_HEIGHT;
 
 		unsigned int framebuffer;
 		glGenFramebuffers(1, &framebuffer);
-		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		GLState::bindFramebuffer(framebuffer);
 		if (depthMap)
 		{
 			// make the only color buffer the depth map
@@ -69,7 +103,7 @@ namespace vg3o {
 			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depth, 0);
 			glDrawBuffer(GL_NONE);
 			glReadBuffer(GL_NONE);
-			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			GLState::bindFramebuffer(0);
 			mDepthTexture = depth;
 		}
 		else
@@ -94,6 +128,7 @@ namespace vg3o {
 		// create a renderbuffer object for depth and stencil attachment
 		unsigned int rbo;
 		glGenRenderbuffers(1, &rbo);
+		mRenderbuffer = rbo;
 		glBindRenderbuffer(GL_RENDERBUFFER, rbo);
 		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, SCREEN_WIDTH, SCREEN_HEIGHT); // use a single renderbuffer object for both a depth AND stencil buffer.
 		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo); // now actually attach it
@@ -104,7 +139,9 @@ namespace vg3o {
 		// now that we actually created the framebuffer and added all attachments we want to check if it is actually complete now
 		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
 			std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		GLState::bindFramebuffer(0);
+		// the attachments above were bound with glBindTexture on the active unit (0)
+		GLState::invalidateTexture(0);
 		return framebuffer;
 	}
 }
\ No newline at end of file
@@ -10,8 +10,19 @@ namespace vg3o {
 	class ScreenBuffer {
 	public:
 		ScreenBuffer(const int SCREEN_WIDTH, const int SCREEN_HEIGHT, int numColorBuffers, bool depthMap = false) {
+			mNumColorBuffers = numColorBuffers;
+			mIsDepthMap = depthMap;
 			mFramebuffer = loadFramebuffer(SCREEN_WIDTH, SCREEN_HEIGHT, numColorBuffers, depthMap);
 		};
+		~ScreenBuffer();
+		ScreenBuffer(const ScreenBuffer&) = delete;
+		ScreenBuffer& operator=(const ScreenBuffer&) = delete;
+
+		/// <summary>
+		/// Reallocates every attachment at the new size. Does nothing if the size is unchanged.
+		/// Texture names change, so fetch them again afterwards.
+		/// </summary>
+		void resize(int width, int height);
 		/// <summary>
 		/// Use the currently bound buffer.
 		/// </summary>
@@ -32,20 +43,27 @@ namespace vg3o {
 		/// </summary>
 		static void genScreenQuad();
 
-		std::vector<unsigned int> getColorBuffers() { return mColorBuffers; }
+		const std::vector<unsigned int>& getColorBuffers() const { return mColorBuffers; }
+		int getWidth() const { return mWidth; }
+		int getHeight() const { return mHeight; }
 
 		/// <summary>
 		/// Gets the depth texture attached to this framebuffer, if one exists.
 		/// </summary>
 		/// <returns>The location of the depth texture.</returns>
-		unsigned int getDepthTexture() { return mDepthTexture; }
+		unsigned int getDepthTexture() const { return mDepthTexture; }
 	private:
 		unsigned int loadFramebuffer(const int SCREEN_WIDTH, const int SCREEN_HEIGHT, int colorBuffers, bool depthMap);
+		void release();
 
 		static unsigned int mVAO;
 		std::vector<unsigned int> mColorBuffers;
-		unsigned int mTextureColorBuffer;
-		unsigned int mDepthTexture;
-		unsigned int mFramebuffer;
+		unsigned int mDepthTexture = 0;
+		unsigned int mRenderbuffer = 0;
+		unsigned int mFramebuffer = 0;
+		int mWidth = 0;
+		int mHeight = 0;
+		int mNumColorBuffers = 0;
+		bool mIsDepthMap = false;
 	};
 }
\ No newline at end of file
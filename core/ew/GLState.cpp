@@ -0,0 +1,156 @@
+#include "GLState.h"
+#include "external/glad.h"
+
+namespace vg3o {
+	// UNKNOWN never matches a real value, so the first call after invalidate() is always made
+	static const unsigned int UNKNOWN = 0xFFFFFFFF;
+
+	struct CachedState {
+		unsigned int program = UNKNOWN;
+		unsigned int vao = UNKNOWN;
+		unsigned int framebuffer = UNKNOWN;
+		unsigned int textures[GLState::MAX_TEXTURE_UNITS];
+		unsigned int blend = UNKNOWN;
+		unsigned int blendSource = UNKNOWN;
+		unsigned int blendDestination = UNKNOWN;
+		unsigned int depthTest = UNKNOWN;
+		unsigned int depthWrite = UNKNOWN;
+		unsigned int depthFunc = UNKNOWN;
+		unsigned int cull = UNKNOWN;
+		unsigned int cullFace = UNKNOWN;
+
+		CachedState() {
+			for (unsigned int i = 0; i < GLState::MAX_TEXTURE_UNITS; i++)
+				textures[i] = UNKNOWN;
+		}
+	};
+
+	static CachedState sState;
+	static GLStateStats sStats;
+
+	// returns true if the caller should make the GL call
+	static bool change(unsigned int& cached, unsigned int value) {
+		if (cached == value)
+		{
+			sStats.skipped++;
+			return false;
+		}
+		cached = value;
+		sStats.issued++;
+		return true;
+	}
+
+	static void setCapability(unsigned int& cached, GLenum capability, bool enabled) {
+		if (!change(cached, enabled ? 1 : 0)) return;
+		if (enabled) glEnable(capability);
+		else glDisable(capability);
+	}
+
+	void GLState::useProgram(unsigned int program) {
+		if (change(sState.program, program))
+			glUseProgram(program);
+	}
+
+	void GLState::bindVertexArray(unsigned int vao) {
+		if (change(sState.vao, vao))
+			glBindVertexArray(vao);
+	}
+
+	void GLState::bindFramebuffer(unsigned int framebuffer) {
+		if (change(sState.framebuffer, framebuffer))
+			glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	}
+
+	void GLState::bindTexture(unsigned int unit, unsigned int texture) {
+		if (unit >= MAX_TEXTURE_UNITS)
+		{
+			glBindTextureUnit(unit, texture);
+			sStats.issued++;
+			sStats.textureBinds++;
+			return;
+		}
+		if (change(sState.textures[unit], texture))
+		{
+			glBindTextureUnit(unit, texture);
+			sStats.textureBinds++;
+		}
+	}
+
+	void GLState::setBlend(bool enabled) {
+		setCapability(sState.blend, GL_BLEND, enabled);
+	}
+
+	void GLState::setBlendFunc(unsigned int sourceFactor, unsigned int destinationFactor) {
+		if (sState.blendSource == sourceFactor && sState.blendDestination == destinationFactor)
+		{
+			sStats.skipped++;
+			return;
+		}
+		sState.blendSource = sourceFactor;
+		sState.blendDestination = destinationFactor;
+		sStats.issued++;
+		glBlendFunc(sourceFactor, destinationFactor);
+	}
+
+	void GLState::setDepthTest(bool enabled) {
+		setCapability(sState.depthTest, GL_DEPTH_TEST, enabled);
+	}
+
+	void GLState::setDepthWrite(bool enabled) {
+		if (change(sState.depthWrite, enabled ? 1 : 0))
+			glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+	}
+
+	void GLState::setDepthFunc(unsigned int func) {
+		if (change(sState.depthFunc, func))
+			glDepthFunc(func);
+	}
+
+	void GLState::setCull(bool enabled) {
+		setCapability(sState.cull, GL_CULL_FACE, enabled);
+	}
+
+	void GLState::setCullFace(unsigned int face) {
+		if (change(sState.cullFace, face))
+			glCullFace(face);
+	}
+
+	void GLState::invalidate() {
+		sState = CachedState();
+	}
+
+	void GLState::vertexArrayDeleted(unsigned int vao) {
+		if (sState.vao == vao)
+			sState.vao = 0;
+	}
+
+	void GLState::framebufferDeleted(unsigned int framebuffer) {
+		if (sState.framebuffer == framebuffer)
+			sState.framebuffer = 0;
+	}
+
+	void GLState::textureDeleted(unsigned int texture) {
+		for (unsigned int i = 0; i < MAX_TEXTURE_UNITS; i++)
+		{
+			if (sState.textures[i] == texture)
+				sState.textures[i] = 0;
+		}
+	}
+
+	void GLState::invalidateTexture(unsigned int unit) {
+		if (unit < MAX_TEXTURE_UNITS)
+			sState.textures[unit] = UNKNOWN;
+	}
+
+	void GLState::countDrawCall() {
+		sStats.drawCalls++;
+	}
+
+	GLStateStats GLState::getStats() {
+		return sStats;
+	}
+
+	void GLState::resetStats() {
+		sStats = GLStateStats();
+	}
+}
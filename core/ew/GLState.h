@@ -0,0 +1,67 @@
+/*
+	GLState // Brandon Salvietti
+
+	Remembers the GL state that gets set every frame and drops calls that wouldn't change anything.
+	Everything that binds programs, VAOs, framebuffers or textures for drawing should go through here,
+	otherwise the cache goes stale. Code that has to touch that state directly calls invalidate() after.
+	ImGui's renderer restores what it changes, so it doesn't need to.
+*/
+
+#pragma once
+
+namespace vg3o {
+
+	struct GLStateStats {
+		unsigned int issued = 0; // GL calls that were actually made
+		unsigned int skipped = 0; // calls dropped because the state already matched
+		unsigned int textureBinds = 0; // issued glBindTextureUnit calls, also counted in issued
+		unsigned int drawCalls = 0; // glDraw* calls, a multi-draw counts once
+	};
+
+	class GLState {
+	public:
+		static const unsigned int MAX_TEXTURE_UNITS = 32;
+
+		static void useProgram(unsigned int program);
+		static void bindVertexArray(unsigned int vao);
+		static void bindFramebuffer(unsigned int framebuffer);
+
+		/// <summary>
+		/// glBindTextureUnit, so the active texture unit is never changed. The texture must have a target already.
+		/// </summary>
+		static void bindTexture(unsigned int unit, unsigned int texture);
+
+		static void setBlend(bool enabled);
+		static void setBlendFunc(unsigned int sourceFactor, unsigned int destinationFactor);
+		static void setDepthTest(bool enabled);
+		static void setDepthWrite(bool enabled);
+		static void setDepthFunc(unsigned int func);
+		static void setCull(bool enabled);
+		static void setCullFace(unsigned int face);
+
+		/// <summary>
+		/// Forgets everything, the next call of each kind always reaches GL.
+		/// </summary>
+		static void invalidate();
+
+		/// <summary>
+		/// Deleting a bound VAO or framebuffer reverts its binding to 0, call these right after deleting so the cache follows.
+		/// </summary>
+		static void vertexArrayDeleted(unsigned int vao);
+		static void framebufferDeleted(unsigned int framebuffer);
+		static void textureDeleted(unsigned int texture);
+
+		/// <summary>
+		/// Forgets one texture unit, for code that bound something to it with glBindTexture.
+		/// </summary>
+		static void invalidateTexture(unsigned int unit);
+
+		/// <summary>
+		/// Draws don't go through here, the code issuing one calls this so it shows up in the stats.
+		/// </summary>
+		static void countDrawCall();
+
+		static GLStateStats getStats();
+		static void resetStats();
+	};
+}
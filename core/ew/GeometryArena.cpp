@@ -0,0 +1,378 @@
+#include "GeometryArena.h"
+#include "external/glad.h"
+#include "GLState.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace vg3o {
+	// starting sizes, in elements. ~1.5MB of vertices and ~1MB of indices
+	const unsigned int INITIAL_VERTEX_CAPACITY = 1 << 16;
+	const unsigned int INITIAL_INDEX_CAPACITY = 1 << 18;
+
+	/*
+	----
+	RangeAllocator
+	----
+	*/
+
+	void RangeAllocator::reset(unsigned int capacity) {
+		mFreeBlocks.clear();
+		mFreeBlocks.push_back({ 0, capacity });
+		mCapacity = capacity;
+		mUsed = 0;
+	}
+
+	void RangeAllocator::grow(unsigned int newCapacity) {
+		if (newCapacity <= mCapacity) return;
+		free(mCapacity, newCapacity - mCapacity);
+		mUsed += newCapacity - mCapacity; // free() above subtracted space that was never used
+		mCapacity = newCapacity;
+	}
+
+	bool RangeAllocator::allocate(unsigned int count, unsigned int& offset) {
+		if (count == 0) { offset = 0; return true; }
+		for (size_t i = 0; i < mFreeBlocks.size(); i++)
+		{
+			Block& block = mFreeBlocks[i];
+			if (block.count < count) continue;
+
+			offset = block.offset;
+			block.offset += count;
+			block.count -= count;
+			if (block.count == 0)
+				mFreeBlocks.erase(mFreeBlocks.begin() + i);
+			mUsed += count;
+			return true;
+		}
+		return false;
+	}
+
+	void RangeAllocator::free(unsigned int offset, unsigned int count) {
+		if (count == 0) return;
+		auto it = std::lower_bound(mFreeBlocks.begin(), mFreeBlocks.end(), offset,
+			[](const Block& block, unsigned int value) { return block.offset < value; });
+		it = mFreeBlocks.insert(it, { offset, count });
+		mUsed -= count;
+
+		// merge with the next block, then the previous one
+		auto next = it + 1;
+		if (next != mFreeBlocks.end() && it->offset + it->count == next->offset)
+		{
+			it->count += next->count;
+			mFreeBlocks.erase(next);
+		}
+		if (it != mFreeBlocks.begin())
+		{
+			auto prev = it - 1;
+			if (prev->offset + prev->count == it->offset)
+			{
+				prev->count += it->count;
+				mFreeBlocks.erase(it);
+			}
+		}
+	}
+
+	unsigned int RangeAllocator::getLargestFreeBlock() const {
+		unsigned int largest = 0;
+		for (const Block& block : mFreeBlocks)
+			largest = std::max(largest, block.count);
+		return largest;
+	}
+
+	/*
+	----
+	ArenaStats
+	----
+	*/
+
+	static float fragmentation(unsigned int capacity, unsigned int used, unsigned int largest) {
+		unsigned int totalFree = capacity - used;
+		if (totalFree == 0) return 0.f;
+		return 1.f - (float)largest / totalFree;
+	}
+
+	float ArenaStats::vertexFragmentation() const {
+		return fragmentation(vertexCapacity, vertexUsed, largestFreeVertexBlock);
+	}
+
+	float ArenaStats::indexFragmentation() const {
+		return fragmentation(indexCapacity, indexUsed, largestFreeIndexBlock);
+	}
+
+	/*
+	----
+	GeometryArena
+	----
+	*/
+
+	GeometryArena& GeometryArena::get() {
+		static GeometryArena arena;
+		return arena;
+	}
+
+	void GeometryArena::init() {
+		glCreateVertexArrays(1, &mVAO);
+
+		//Position attribute
+		glVertexArrayAttribFormat(mVAO, 0, 3, GL_FLOAT, GL_FALSE, offsetof(ew::Vertex, pos));
+		glVertexArrayAttribBinding(mVAO, 0, 0);
+		glEnableVertexArrayAttrib(mVAO, 0);
+
+		//Normal attribute
+		glVertexArrayAttribFormat(mVAO, 1, 3, GL_FLOAT, GL_FALSE, offsetof(ew::Vertex, normal));
+		glVertexArrayAttribBinding(mVAO, 1, 0);
+		glEnableVertexArrayAttrib(mVAO, 1);
+
+		//UV attribute
+		glVertexArrayAttribFormat(mVAO, 2, 2, GL_FLOAT, GL_FALSE, offsetof(ew::Vertex, uv));
+		glVertexArrayAttribBinding(mVAO, 2, 0);
+		glEnableVertexArrayAttrib(mVAO, 2);
+
+		glCreateBuffers(1, &mVBO);
+		glNamedBufferData(mVBO, sizeof(ew::Vertex) * INITIAL_VERTEX_CAPACITY, NULL, GL_STATIC_DRAW);
+		glCreateBuffers(1, &mEBO);
+		glNamedBufferData(mEBO, sizeof(unsigned int) * INITIAL_INDEX_CAPACITY, NULL, GL_STATIC_DRAW);
+
+		mVertexRanges.reset(INITIAL_VERTEX_CAPACITY);
+		mIndexRanges.reset(INITIAL_INDEX_CAPACITY);
+		attachBuffers();
+		mInitialized = true;
+	}
+
+	void GeometryArena::attachBuffers() {
+		glVertexArrayVertexBuffer(mVAO, 0, mVBO, 0, sizeof(ew::Vertex));
+		glVertexArrayElementBuffer(mVAO, mEBO);
+	}
+
+	/// <summary>
+	/// Replaces a buffer with a larger one, keeping the first copySize bytes.
+	/// </summary>
+	static unsigned int resizeBuffer(unsigned int buffer, size_t copySize, size_t newSize) {
+		unsigned int newBuffer;
+		glCreateBuffers(1, &newBuffer);
+		glNamedBufferData(newBuffer, newSize, NULL, GL_STATIC_DRAW);
+		glCopyNamedBufferSubData(buffer, newBuffer, 0, 0, copySize);
+		glDeleteBuffers(1, &buffer);
+		return newBuffer;
+	}
+
+	void GeometryArena::growVertices(unsigned int minCapacity) {
+		unsigned int capacity = mVertexRanges.getCapacity();
+		unsigned int newCapacity = std::max(capacity * 2, minCapacity);
+		mVBO = resizeBuffer(mVBO, sizeof(ew::Vertex) * capacity, sizeof(ew::Vertex) * newCapacity);
+		mVertexRanges.grow(newCapacity);
+		attachBuffers();
+		mNumGrows++;
+	}
+
+	void GeometryArena::growIndices(unsigned int minCapacity) {
+		unsigned int capacity = mIndexRanges.getCapacity();
+		unsigned int newCapacity = std::max(capacity * 2, minCapacity);
+		mEBO = resizeBuffer(mEBO, sizeof(unsigned int) * capacity, sizeof(unsigned int) * newCapacity);
+		mIndexRanges.grow(newCapacity);
+		attachBuffers();
+		mNumGrows++;
+	}
+
+	int GeometryArena::allocate(const ew::MeshData& meshData) {
+		if (!mInitialized) init();
+
+		unsigned int numVertices = (unsigned int)meshData.vertices.size();
+		unsigned int numIndices = (unsigned int)meshData.indices.size();
+
+		// make room for both ranges before taking either, defragment() only knows about recorded allocations
+		bool vertexFits = mVertexRanges.getLargestFreeBlock() >= numVertices;
+		bool indexFits = mIndexRanges.getLargestFreeBlock() >= numIndices;
+		if (!vertexFits || !indexFits)
+		{
+			// try to reclaim fragmented space before asking the driver for more
+			bool vertexSpace = mVertexRanges.getCapacity() - mVertexRanges.getUsed() >= numVertices;
+			bool indexSpace = mIndexRanges.getCapacity() - mIndexRanges.getUsed() >= numIndices;
+			if ((vertexFits || vertexSpace) && (indexFits || indexSpace))
+				defragment();
+			// the free space may still be split up if defragment() was skipped, only the added tail is sure to be one block
+			if (mVertexRanges.getLargestFreeBlock() < numVertices)
+				growVertices(mVertexRanges.getCapacity() + numVertices);
+			if (mIndexRanges.getLargestFreeBlock() < numIndices)
+				growIndices(mIndexRanges.getCapacity() + numIndices);
+		}
+
+		unsigned int vertexOffset, indexOffset;
+		bool vertexAllocated = mVertexRanges.allocate(numVertices, vertexOffset);
+		if (!vertexAllocated || !mIndexRanges.allocate(numIndices, indexOffset))
+		{
+			if (vertexAllocated)
+				mVertexRanges.free(vertexOffset, numVertices);
+			std::cout << "ERROR::GEOMETRYARENA:: Failed to allocate " << numVertices << " vertices, " << numIndices << " indices" << std::endl;
+			return -1;
+		}
+
+		int id;
+		if (!mFreeIds.empty())
+		{
+			id = mFreeIds.back();
+			mFreeIds.pop_back();
+		}
+		else
+		{
+			id = (int)mAllocations.size();
+			mAllocations.push_back({});
+		}
+
+		ArenaAllocation& allocation = mAllocations[id];
+		allocation.baseVertex = (int)vertexOffset;
+		allocation.firstIndex = indexOffset;
+		allocation.numVertices = numVertices;
+		allocation.numIndices = numIndices;
+		allocation.live = true;
+
+		// indices stay local to the mesh, baseVertex offsets them at draw time
+		if (numVertices > 0)
+			glNamedBufferSubData(mVBO, sizeof(ew::Vertex) * vertexOffset, sizeof(ew::Vertex) * numVertices, meshData.vertices.data());
+		if (numIndices > 0)
+			glNamedBufferSubData(mEBO, sizeof(unsigned int) * indexOffset, sizeof(unsigned int) * numIndices, meshData.indices.data());
+		return id;
+	}
+
+	int GeometryArena::reallocate(int id, const ew::MeshData& meshData) {
+		if (id >= 0 && mAllocations[id].live
+			&& meshData.vertices.size() == mAllocations[id].numVertices
+			&& meshData.indices.size() == mAllocations[id].numIndices)
+		{
+			const ArenaAllocation& allocation = mAllocations[id];
+			if (allocation.numVertices > 0)
+				glNamedBufferSubData(mVBO, sizeof(ew::Vertex) * allocation.baseVertex, sizeof(ew::Vertex) * allocation.numVertices, meshData.vertices.data());
+			if (allocation.numIndices > 0)
+				glNamedBufferSubData(mEBO, sizeof(unsigned int) * allocation.firstIndex, sizeof(unsigned int) * allocation.numIndices, meshData.indices.data());
+			return id;
+		}
+		free(id);
+		return allocate(meshData);
+	}
+
+	void GeometryArena::free(int id) {
+		if (id < 0 || id >= (int)mAllocations.size() || !mAllocations[id].live) return;
+
+		ArenaAllocation& allocation = mAllocations[id];
+		mVertexRanges.free((unsigned int)allocation.baseVertex, allocation.numVertices);
+		mIndexRanges.free(allocation.firstIndex, allocation.numIndices);
+		allocation.live = false;
+		mFreeIds.push_back(id);
+	}
+
+	void GeometryArena::bind() const {
+		GLState::bindVertexArray(mVAO);
+	}
+
+	void GeometryArena::defragment() {
+		if (!mInitialized) return;
+
+		std::vector<int> live;
+		for (int i = 0; i < (int)mAllocations.size(); i++)
+		{
+			if (mAllocations[i].live) live.push_back(i);
+		}
+
+		// copy into fresh buffers in offset order, so each block lands at or before where it was
+		std::sort(live.begin(), live.end(), [this](int a, int b) { return mAllocations[a].baseVertex < mAllocations[b].baseVertex; });
+
+		unsigned int vertexCapacity = mVertexRanges.getCapacity();
+		unsigned int indexCapacity = mIndexRanges.getCapacity();
+
+		unsigned int newVBO, newEBO;
+		glCreateBuffers(1, &newVBO);
+		glNamedBufferData(newVBO, sizeof(ew::Vertex) * vertexCapacity, NULL, GL_STATIC_DRAW);
+		glCreateBuffers(1, &newEBO);
+		glNamedBufferData(newEBO, sizeof(unsigned int) * indexCapacity, NULL, GL_STATIC_DRAW);
+
+		unsigned int vertexCursor = 0, indexCursor = 0;
+		for (int id : live)
+		{
+			ArenaAllocation& allocation = mAllocations[id];
+			if (allocation.numVertices > 0)
+				glCopyNamedBufferSubData(mVBO, newVBO, sizeof(ew::Vertex) * allocation.baseVertex, sizeof(ew::Vertex) * vertexCursor, sizeof(ew::Vertex) * allocation.numVertices);
+			if (allocation.numIndices > 0)
+				glCopyNamedBufferSubData(mEBO, newEBO, sizeof(unsigned int) * allocation.firstIndex, sizeof(unsigned int) * indexCursor, sizeof(unsigned int) * allocation.numIndices);
+			allocation.baseVertex = (int)vertexCursor;
+			allocation.firstIndex = indexCursor;
+			vertexCursor += allocation.numVertices;
+			indexCursor += allocation.numIndices;
+		}
+
+		glDeleteBuffers(1, &mVBO);
+		glDeleteBuffers(1, &mEBO);
+		mVBO = newVBO;
+		mEBO = newEBO;
+		attachBuffers();
+
+		mVertexRanges.reset(vertexCapacity);
+		mIndexRanges.reset(indexCapacity);
+		unsigned int offset;
+		mVertexRanges.allocate(vertexCursor, offset);
+		mIndexRanges.allocate(indexCursor, offset);
+
+		mGeneration++;
+		mNumDefragments++;
+	}
+
+	ArenaStats GeometryArena::getStats() const {
+		ArenaStats stats;
+		stats.vertexCapacity = mVertexRanges.getCapacity();
+		stats.vertexUsed = mVertexRanges.getUsed();
+		stats.vertexFreeBlocks = mVertexRanges.getNumFreeBlocks();
+		stats.largestFreeVertexBlock = mVertexRanges.getLargestFreeBlock();
+
+		stats.indexCapacity = mIndexRanges.getCapacity();
+		stats.indexUsed = mIndexRanges.getUsed();
+		stats.indexFreeBlocks = mIndexRanges.getNumFreeBlocks();
+		stats.largestFreeIndexBlock = mIndexRanges.getLargestFreeBlock();
+
+		stats.numAllocations = (unsigned int)(mAllocations.size() - mFreeIds.size());
+		stats.numGrows = mNumGrows;
+		stats.numDefragments = mNumDefragments;
+		return stats;
+	}
+
+	/*
+	----
+	IndirectBatch
+	----
+	*/
+
+	unsigned int IndirectBatch::sNumSubmits = 0;
+
+	void IndirectBatch::add(const ew::Mesh& mesh, unsigned int baseInstance) {
+		if (mesh.getArenaId() < 0) return;
+
+		const ArenaAllocation& allocation = GeometryArena::get().getAllocation(mesh.getArenaId());
+		DrawElementsIndirectCommand command;
+		command.count = allocation.numIndices;
+		command.instanceCount = 1;
+		command.firstIndex = allocation.firstIndex;
+		command.baseVertex = allocation.baseVertex;
+		command.baseInstance = baseInstance;
+		mCommands.push_back(command);
+	}
+
+	void IndirectBatch::submit() {
+		if (mCommands.empty()) return;
+
+		size_t size = sizeof(DrawElementsIndirectCommand) * mCommands.size();
+		if (mBuffer == 0)
+			glCreateBuffers(1, &mBuffer);
+		if (size > mBufferCapacity)
+		{
+			mBufferCapacity = size * 2;
+			glNamedBufferData(mBuffer, mBufferCapacity, NULL, GL_DYNAMIC_DRAW);
+		}
+		glNamedBufferSubData(mBuffer, 0, size, mCommands.data());
+
+		GeometryArena::get().bind();
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mBuffer);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, NULL, (int)mCommands.size(), 0);
+		GLState::countDrawCall();
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		sNumSubmits++;
+	}
+}
@@ -0,0 +1,168 @@
+/*
+	GeometryArena // Brandon Salvietti
+
+	One large vertex buffer and one large index buffer shared by every arena-backed mesh.
+	Meshes get sub-ranges of those buffers, so a whole pass can be drawn with one VAO bind
+	and a single glMultiDrawElementsIndirect call.
+*/
+
+#pragma once
+#include "mesh.h"
+#include <vector>
+
+namespace vg3o {
+
+	/// <summary>
+	/// First-fit free list over a linear range of elements. Adjacent free blocks are merged on free.
+	/// </summary>
+	class RangeAllocator {
+	public:
+		struct Block {
+			unsigned int offset;
+			unsigned int count;
+		};
+
+		void reset(unsigned int capacity);
+
+		/// <summary>
+		/// Extends the range to a new capacity, the added space becomes a free block.
+		/// </summary>
+		void grow(unsigned int newCapacity);
+
+		/// <returns>False if no free block is large enough.</returns>
+		bool allocate(unsigned int count, unsigned int& offset);
+		void free(unsigned int offset, unsigned int count);
+
+		unsigned int getCapacity() const { return mCapacity; }
+		unsigned int getUsed() const { return mUsed; }
+		unsigned int getNumFreeBlocks() const { return (unsigned int)mFreeBlocks.size(); }
+		unsigned int getLargestFreeBlock() const;
+	private:
+		std::vector<Block> mFreeBlocks; // sorted by offset
+		unsigned int mCapacity = 0;
+		unsigned int mUsed = 0;
+	};
+
+	struct ArenaAllocation {
+		int baseVertex = 0;
+		unsigned int firstIndex = 0;
+		unsigned int numVertices = 0;
+		unsigned int numIndices = 0;
+		bool live = false;
+	};
+
+	struct ArenaStats {
+		unsigned int vertexCapacity = 0;
+		unsigned int vertexUsed = 0;
+		unsigned int vertexFreeBlocks = 0;
+		unsigned int largestFreeVertexBlock = 0;
+
+		unsigned int indexCapacity = 0;
+		unsigned int indexUsed = 0;
+		unsigned int indexFreeBlocks = 0;
+		unsigned int largestFreeIndexBlock = 0;
+
+		unsigned int numAllocations = 0;
+		unsigned int numGrows = 0;
+		unsigned int numDefragments = 0;
+
+		/// <summary>
+		/// 0 when all free space is one block, approaches 1 as free space gets split up.
+		/// </summary>
+		float vertexFragmentation() const;
+		float indexFragmentation() const;
+	};
+
+	class GeometryArena {
+	public:
+		/// <summary>
+		/// The global arena. Buffers are created lazily on the first allocation, so a GL context must be current by then.
+		/// </summary>
+		static GeometryArena& get();
+
+		/// <summary>
+		/// Copies mesh data into the arena.
+		/// </summary>
+		/// <returns>An allocation id, or -1 on failure.</returns>
+		int allocate(const ew::MeshData& meshData);
+
+		/// <summary>
+		/// Overwrites an existing allocation. Reallocates if the data no longer fits.
+		/// </summary>
+		/// <returns>The (possibly new) allocation id.</returns>
+		int reallocate(int id, const ew::MeshData& meshData);
+
+		void free(int id);
+
+		const ArenaAllocation& getAllocation(int id) const { return mAllocations[id]; }
+
+		/// <summary>
+		/// Binds the shared VAO.
+		/// </summary>
+		void bind() const;
+
+		/// <summary>
+		/// Packs all live allocations to the front of the buffers so the free space becomes one block.
+		/// Allocation ids stay valid, but their offsets change.
+		/// </summary>
+		void defragment();
+
+		ArenaStats getStats() const;
+
+		/// <summary>
+		/// Bumped whenever offsets of existing allocations change. Cached draw commands compare against this.
+		/// </summary>
+		unsigned int getGeneration() const { return mGeneration; }
+		unsigned int getVAO() const { return mVAO; }
+	private:
+		GeometryArena() {};
+		void init();
+		void growVertices(unsigned int minCapacity);
+		void growIndices(unsigned int minCapacity);
+		void attachBuffers();
+
+		RangeAllocator mVertexRanges;
+		RangeAllocator mIndexRanges;
+		std::vector<ArenaAllocation> mAllocations;
+		std::vector<int> mFreeIds;
+
+		unsigned int mVAO = 0;
+		unsigned int mVBO = 0;
+		unsigned int mEBO = 0;
+		unsigned int mGeneration = 0;
+		unsigned int mNumGrows = 0;
+		unsigned int mNumDefragments = 0;
+		bool mInitialized = false;
+	};
+
+	/// <summary>
+	/// Matches the layout GL expects for glMultiDrawElementsIndirect.
+	/// </summary>
+	struct DrawElementsIndirectCommand {
+		unsigned int count;
+		unsigned int instanceCount;
+		unsigned int firstIndex;
+		int baseVertex;
+		unsigned int baseInstance;
+	};
+
+	/// <summary>
+	/// Collects draws of arena-backed meshes and submits them as one multi-draw.
+	/// baseInstance is left to the caller so shaders can use it as a per-draw index.
+	/// </summary>
+	class IndirectBatch {
+	public:
+		void clear() { mCommands.clear(); }
+		void add(const ew::Mesh& mesh, unsigned int baseInstance = 0);
+		void submit();
+
+		size_t getNumCommands() const { return mCommands.size(); }
+		static unsigned int getNumSubmits() { return sNumSubmits; }
+		static void resetNumSubmits() { sNumSubmits = 0; }
+	private:
+		std::vector<DrawElementsIndirectCommand> mCommands;
+		unsigned int mBuffer = 0;
+		size_t mBufferCapacity = 0;
+		static unsigned int sNumSubmits;
+	};
+}
@@ -0,0 +1,255 @@
+#include "GpuProfiler.h"
+#include "BenchmarkReport.h"
+#include "external/glad.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <stdio.h>
+#include <string.h>
+
+namespace vg3o {
+	static bool isSoftwareRenderer(const std::string& renderer) {
+		const char* names[] = { "llvmpipe", "softpipe", "SwiftShader", "Software Rasterizer" };
+		for (const char* name : names)
+		{
+			if (renderer.find(name) != std::string::npos)
+				return true;
+		}
+		return false;
+	}
+
+	GpuProfiler::GpuProfiler(const GpuProfilerSettings& settings) {
+		mSettings = settings;
+		mFrames.resize(settings.framesInFlight > 0 ? settings.framesInFlight : 1);
+
+		const char* renderer = (const char*)glGetString(GL_RENDERER);
+		mRenderer = renderer != NULL ? renderer : "unknown";
+		mStats.softwareRenderer = isSoftwareRenderer(mRenderer);
+		// a counter with no bits means the driver can't time anything, scopes are timed on the CPU instead
+		int elapsedBits = 0, timestampBits = 0;
+		glGetQueryiv(GL_TIME_ELAPSED, GL_QUERY_COUNTER_BITS, &elapsedBits);
+		glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &timestampBits);
+		mStats.timerQueries = elapsedBits > 0 && timestampBits > 0;
+		if (!mStats.timerQueries)
+			std::cout << "ERROR::GPUPROFILER:: " << mRenderer << " has no timer queries, falling back to CPU timings" << std::endl;
+	}
+
+	GpuProfiler::~GpuProfiler() {
+		for (FrameSlot& frame : mFrames)
+		{
+			if (frame.elapsedQueries.empty()) continue;
+			glDeleteQueries((int)frame.elapsedQueries.size(), frame.elapsedQueries.data());
+			glDeleteQueries((int)frame.timestampQueries.size(), frame.timestampQueries.data());
+		}
+	}
+
+	double GpuProfiler::cpuMicroseconds() const {
+		return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	int GpuProfiler::getScope(const std::string& name) {
+		auto it = mScopeIndices.find(name);
+		if (it != mScopeIndices.end())
+			return it->second;
+		int scope = (int)mScopes.size();
+		mScopeIndices[name] = scope;
+		GpuScopeStats stats;
+		stats.name = name;
+		mScopes.push_back(stats);
+		mWindows.push_back(std::vector<float>());
+		mWindowOffsets.push_back(0);
+		return scope;
+	}
+
+	/*
+		----
+		Recording
+		----
+	*/
+	void GpuProfiler::beginFrame() {
+		mCurrent = (mCurrent + 1) % (unsigned int)mFrames.size();
+		// oldest first, results arrive in order so the first unfinished frame ends the search
+		for (unsigned int i = 0; i < mFrames.size(); i++)
+		{
+			FrameSlot& frame = mFrames[(mCurrent + i) % mFrames.size()];
+			if (frame.pending && !readFrame(frame))
+				break;
+		}
+
+		FrameSlot& frame = mFrames[mCurrent];
+		mRecording = !frame.pending;
+		if (mRecording)
+			frame.scopes.clear();
+		else
+			mStats.framesSkipped++;
+		mOpenScope = -1;
+		mDepth = 0;
+	}
+
+	void GpuProfiler::endFrame() {
+		if (mOpenScope >= 0)
+		{
+			mDepth = 1;
+			endScope();
+		}
+		if (mRecording)
+			mFrames[mCurrent].pending = !mFrames[mCurrent].scopes.empty();
+		mRecording = false;
+	}
+
+	void GpuProfiler::beginScope(const std::string& name) {
+		mDepth++;
+		if (mDepth > 1)
+		{
+			mStats.nestedScopes++;
+			return;
+		}
+		if (!mRecording) return;
+
+		FrameSlot& frame = mFrames[mCurrent];
+		size_t index = frame.scopes.size();
+		if (index >= frame.elapsedQueries.size())
+		{
+			unsigned int queries[2];
+			glGenQueries(2, queries);
+			frame.elapsedQueries.push_back(queries[0]);
+			frame.timestampQueries.push_back(queries[1]);
+		}
+		ScopeQuery query;
+		query.scope = getScope(name);
+		query.elapsed = frame.elapsedQueries[index];
+		query.timestamp = frame.timestampQueries[index];
+		query.cpuStart = cpuMicroseconds();
+		query.cpuEnd = query.cpuStart;
+		if (mStats.timerQueries)
+		{
+			glQueryCounter(query.timestamp, GL_TIMESTAMP);
+			glBeginQuery(GL_TIME_ELAPSED, query.elapsed);
+		}
+		frame.scopes.push_back(query);
+		mOpenScope = (int)index;
+	}
+
+	void GpuProfiler::endScope() {
+		if (mDepth == 0) return;
+		mDepth--;
+		if (mDepth > 0 || mOpenScope < 0) return;
+		ScopeQuery& query = mFrames[mCurrent].scopes[mOpenScope];
+		if (mStats.timerQueries)
+			glEndQuery(GL_TIME_ELAPSED);
+		query.cpuEnd = cpuMicroseconds();
+		mOpenScope = -1;
+	}
+
+	/*
+		----
+		Results
+		----
+	*/
+	bool GpuProfiler::readFrame(FrameSlot& frame) {
+		if (mStats.timerQueries)
+		{
+			int available = 0;
+			glGetQueryObjectiv(frame.scopes.back().elapsed, GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available) return false;
+		}
+
+		std::vector<TraceEvent> events;
+		std::vector<float> totals(mScopes.size(), -1.0f); // a scope used twice in a frame counts as one sample
+		float frameMilliseconds = 0.0f;
+		for (const ScopeQuery& query : frame.scopes)
+		{
+			TraceEvent event;
+			event.scope = query.scope;
+			if (mStats.timerQueries)
+			{
+				GLuint64 elapsed = 0, timestamp = 0;
+				glGetQueryObjectui64v(query.elapsed, GL_QUERY_RESULT, &elapsed);
+				glGetQueryObjectui64v(query.timestamp, GL_QUERY_RESULT, &timestamp);
+				event.startMicroseconds = (double)timestamp / 1000.0;
+				event.durationMicroseconds = (double)elapsed / 1000.0;
+			}
+			else
+			{
+				event.startMicroseconds = query.cpuStart;
+				event.durationMicroseconds = query.cpuEnd - query.cpuStart;
+			}
+			if (mTraceOrigin < 0.0)
+				mTraceOrigin = event.startMicroseconds;
+			event.startMicroseconds -= mTraceOrigin;
+			events.push_back(event);
+
+			float milliseconds = (float)(event.durationMicroseconds / 1000.0);
+			totals[query.scope] = std::max(totals[query.scope], 0.0f) + milliseconds;
+			frameMilliseconds += milliseconds;
+		}
+		for (size_t i = 0; i < totals.size(); i++)
+		{
+			if (totals[i] >= 0.0f)
+				addSample((int)i, totals[i]);
+		}
+
+		mTrace.push_back(std::move(events));
+		while (mTrace.size() > mSettings.traceFrames)
+			mTrace.pop_front();
+		mStats.frameMilliseconds = frameMilliseconds;
+		mStats.framesRecorded++;
+		frame.pending = false;
+		return true;
+	}
+
+	void GpuProfiler::addSample(int scope, float milliseconds) {
+		std::vector<float>& window = mWindows[scope];
+		unsigned int windowSize = mSettings.windowSize > 0 ? mSettings.windowSize : 1;
+		if (window.size() < windowSize)
+			window.push_back(milliseconds);
+		else
+		{
+			window[mWindowOffsets[scope]] = milliseconds;
+			mWindowOffsets[scope] = (mWindowOffsets[scope] + 1) % windowSize;
+		}
+
+		// a couple hundred floats for a handful of scopes, sorting a copy is cheap enough to do every frame
+		std::vector<float> sorted = window;
+		std::sort(sorted.begin(), sorted.end());
+		float sum = 0.0f;
+		for (float sample : sorted)
+			sum += sample;
+
+		GpuScopeStats& stats = mScopes[scope];
+		stats.lastMilliseconds = milliseconds;
+		stats.averageMilliseconds = sum / sorted.size();
+		stats.p50Milliseconds = getPercentile(sorted, 0.50);
+		stats.p95Milliseconds = getPercentile(sorted, 0.95);
+		stats.p99Milliseconds = getPercentile(sorted, 0.99);
+		stats.maxMilliseconds = sorted.back();
+		stats.numSamples = (unsigned int)sorted.size();
+	}
+
+	bool GpuProfiler::exportChromeTrace(const std::string& path) const {
+		std::ofstream file(path, std::ios::trunc);
+		if (!file.is_open())
+		{
+			std::cout << "ERROR::GPUPROFILER:: Could not write " << path << std::endl;
+			return false;
+		}
+		// complete ("X") events on one track, timestamps in microseconds
+		file << "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"renderer\":\"" << escapeJson(mRenderer) << "\",\"timer\":\""
+			<< (mStats.timerQueries ? "GL_TIME_ELAPSED" : "cpu") << "\"},\"traceEvents\":[\n";
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"GPU\"}}";
+		char line[64];
+		for (const std::vector<TraceEvent>& frame : mTrace)
+		{
+			for (const TraceEvent& event : frame)
+			{
+				file << ",\n{\"name\":\"" << escapeJson(mScopes[event.scope].name) << "\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":1";
+				snprintf(line, sizeof(line), ",\"ts\":%.3f,\"dur\":%.3f}", event.startMicroseconds, event.durationMicroseconds);
+				file << line;
+			}
+		}
+		file << "\n]}\n";
+		return file.good();
+	}
+}
@@ -0,0 +1,134 @@
+/*
+	GpuProfiler // Brandon Salvietti
+
+	Times named scopes on the GPU with GL_TIME_ELAPSED queries. Each frame's queries go into their
+	own slot of a ring a few frames deep and are only read once the driver says they're done, so the
+	CPU never waits on the GPU to get a number. Results are kept per scope name as a rolling window
+	for averages and percentiles, and as a trace that can be saved for chrome://tracing.
+*/
+
+#pragma once
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vg3o {
+
+	struct GpuProfilerSettings {
+		unsigned int framesInFlight = 4; // ring depth, frames are skipped if the GPU falls further behind than this
+		unsigned int windowSize = 120; // samples per scope behind the averages and percentiles
+		unsigned int traceFrames = 300; // frames kept for exportChromeTrace()
+	};
+
+	struct GpuScopeStats {
+		std::string name;
+		float lastMilliseconds = 0;
+		float averageMilliseconds = 0;
+		float p50Milliseconds = 0;
+		float p95Milliseconds = 0;
+		float p99Milliseconds = 0;
+		float maxMilliseconds = 0;
+		unsigned int numSamples = 0; // in the window
+	};
+
+	struct GpuProfilerStats {
+		float frameMilliseconds = 0; // sum of every scope in the last frame read back
+		unsigned int framesRecorded = 0;
+		unsigned int framesSkipped = 0; // the ring was full of unfinished frames
+		unsigned int nestedScopes = 0; // ignored, GL_TIME_ELAPSED queries can't overlap
+		bool timerQueries = true; // false falls back to CPU time around each scope
+		bool softwareRenderer = false; // llvmpipe and friends, timings only roughly follow the work
+	};
+
+	class GpuProfiler {
+	public:
+		GpuProfiler(const GpuProfilerSettings& settings = GpuProfilerSettings());
+		~GpuProfiler();
+		GpuProfiler(const GpuProfiler&) = delete;
+		GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+		/// <summary>
+		/// Reads back every frame the GPU has finished and starts recording a new one. Call before the first scope.
+		/// </summary>
+		void beginFrame();
+		void endFrame();
+
+		/// <summary>
+		/// Scopes can follow each other but not nest, an inner scope is ignored and counted in the stats.
+		/// </summary>
+		void beginScope(const std::string& name);
+		void endScope();
+
+		/// <summary>
+		/// One entry per scope name, in the order they were first seen.
+		/// </summary>
+		const std::vector<GpuScopeStats>& getScopes() const { return mScopes; }
+		GpuProfilerStats getStats() const { return mStats; }
+		/// <summary>
+		/// GL_RENDERER, to show next to the numbers.
+		/// </summary>
+		const std::string& getRenderer() const { return mRenderer; }
+
+		/// <summary>
+		/// Writes the recorded frames as Chrome trace event JSON, open it in chrome://tracing or Perfetto.
+		/// </summary>
+		/// <returns>False if the file couldn't be written.</returns>
+		bool exportChromeTrace(const std::string& path) const;
+	private:
+		struct ScopeQuery {
+			int scope;
+			unsigned int elapsed; // GL_TIME_ELAPSED
+			unsigned int timestamp; // GL_TIMESTAMP at the start, places the scope on the trace
+			double cpuStart; // used instead of both without timer queries
+			double cpuEnd;
+		};
+		struct FrameSlot {
+			std::vector<ScopeQuery> scopes;
+			// created as needed, reused every time the slot comes around
+			std::vector<unsigned int> elapsedQueries;
+			std::vector<unsigned int> timestampQueries;
+			bool pending = false;
+		};
+		struct TraceEvent {
+			int scope;
+			double startMicroseconds;
+			double durationMicroseconds;
+		};
+
+		bool readFrame(FrameSlot& frame);
+		void addSample(int scope, float milliseconds);
+		int getScope(const std::string& name);
+		double cpuMicroseconds() const;
+
+		GpuProfilerSettings mSettings;
+		GpuProfilerStats mStats;
+		std::string mRenderer;
+		std::vector<FrameSlot> mFrames;
+		unsigned int mCurrent = 0;
+		bool mRecording = false; // this frame has a slot
+		int mOpenScope = -1; // index into the current slot's scopes
+		int mDepth = 0; // scopes begun and not yet ended, nested ones included
+
+		std::unordered_map<std::string, int> mScopeIndices;
+		std::vector<GpuScopeStats> mScopes;
+		std::vector<std::vector<float>> mWindows; // ring of samples per scope
+		std::vector<unsigned int> mWindowOffsets;
+
+		std::deque<std::vector<TraceEvent>> mTrace; // one entry per frame read back
+		double mTraceOrigin = -1.0; // first timestamp, trace times are relative to it
+	};
+
+	/// <summary>
+	/// Times the enclosing block.
+	/// </summary>
+	class GpuScope {
+	public:
+		GpuScope(GpuProfiler& profiler, const std::string& name) : mProfiler(profiler) { mProfiler.beginScope(name); }
+		~GpuScope() { mProfiler.endScope(); }
+		GpuScope(const GpuScope&) = delete;
+		GpuScope& operator=(const GpuScope&) = delete;
+	private:
+		GpuProfiler& mProfiler;
+	};
+}
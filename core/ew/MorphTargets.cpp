@@ -0,0 +1,133 @@
+#include "MorphTargets.h"
+
+#include <cmath>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VG3O_MORPH_SSE
+#include <emmintrin.h>
+#endif
+
+namespace vg3o {
+	/// <summary>
+	/// acc[indices[k]] += weight * deltas[k] for the position and normal halves of each delta.
+	/// </summary>
+	static void accumulateTarget(const MorphTarget& target, float weight, float* positions, float* normals) {
+		const unsigned int* indices = target.indices.data();
+		const float* deltas = target.deltas.data();
+		size_t count = target.indices.size();
+#ifdef VG3O_MORPH_SSE
+		__m128 w = _mm_set1_ps(weight);
+		for (size_t k = 0; k < count; k++)
+		{
+			float* position = positions + indices[k] * 4;
+			float* normal = normals + indices[k] * 4;
+			const float* delta = deltas + k * 8;
+			_mm_storeu_ps(position, _mm_add_ps(_mm_loadu_ps(position), _mm_mul_ps(w, _mm_loadu_ps(delta))));
+			_mm_storeu_ps(normal, _mm_add_ps(_mm_loadu_ps(normal), _mm_mul_ps(w, _mm_loadu_ps(delta + 4))));
+		}
+#else
+		for (size_t k = 0; k < count; k++)
+		{
+			float* position = positions + indices[k] * 4;
+			float* normal = normals + indices[k] * 4;
+			const float* delta = deltas + k * 8;
+			for (int c = 0; c < 4; c++)
+			{
+				position[c] += weight * delta[c];
+				normal[c] += weight * delta[4 + c];
+			}
+		}
+#endif
+	}
+
+	void MorphTargetSet::setBase(const ew::MeshData& base) {
+		mBase = base;
+		mTargets.clear();
+		size_t numVertices = base.vertices.size();
+		mBasePositions.assign(numVertices * 4, 0.f);
+		mBaseNormals.assign(numVertices * 4, 0.f);
+		for (size_t i = 0; i < numVertices; i++)
+		{
+			memcpy(&mBasePositions[i * 4], &base.vertices[i].pos, sizeof(float) * 3);
+			memcpy(&mBaseNormals[i * 4], &base.vertices[i].normal, sizeof(float) * 3);
+		}
+		mOutput = base;
+		mDirty = true;
+	}
+
+	int MorphTargetSet::addTarget(const std::string& name, const glm::vec3* positions, const glm::vec3* normals, float epsilon) {
+		MorphTarget target;
+		target.name = name;
+		for (size_t i = 0; i < mBase.vertices.size(); i++)
+		{
+			const ew::Vertex& base = mBase.vertices[i];
+			glm::vec3 dp = positions ? positions[i] - base.pos : glm::vec3(0);
+			glm::vec3 dn = normals ? normals[i] - base.normal : glm::vec3(0);
+			bool moved = std::fabs(dp.x) > epsilon || std::fabs(dp.y) > epsilon || std::fabs(dp.z) > epsilon
+				|| std::fabs(dn.x) > epsilon || std::fabs(dn.y) > epsilon || std::fabs(dn.z) > epsilon;
+			if (!moved) continue;
+
+			target.indices.push_back((unsigned int)i);
+			float delta[8] = { dp.x, dp.y, dp.z, 0.f, dn.x, dn.y, dn.z, 0.f };
+			target.deltas.insert(target.deltas.end(), delta, delta + 8);
+		}
+		target.indices.shrink_to_fit();
+		target.deltas.shrink_to_fit();
+		mTargets.push_back(std::move(target));
+		return (int)mTargets.size() - 1;
+	}
+
+	int MorphTargetSet::findTarget(const std::string& name) const {
+		for (size_t i = 0; i < mTargets.size(); i++)
+		{
+			if (mTargets[i].name == name) return (int)i;
+		}
+		return -1;
+	}
+
+	void MorphTargetSet::setWeight(int target, float weight) {
+		if (target < 0 || target >= (int)mTargets.size()) return;
+		if (mTargets[target].weight == weight) return;
+		mTargets[target].weight = weight;
+		mDirty = true;
+	}
+
+	void MorphTargetSet::evaluate(ew::MeshData& out) {
+		mPositions = mBasePositions;
+		mNormals = mBaseNormals;
+
+		mLastEvaluatedDeltas = 0;
+		for (const MorphTarget& target : mTargets)
+		{
+			if (target.weight == 0.f) continue;
+			accumulateTarget(target, target.weight, mPositions.data(), mNormals.data());
+			mLastEvaluatedDeltas += target.indices.size();
+		}
+
+		if (out.vertices.size() != mBase.vertices.size())
+			out = mBase;
+		for (size_t i = 0; i < out.vertices.size(); i++)
+		{
+			ew::Vertex& v = out.vertices[i];
+			v.pos = glm::vec3(mPositions[i * 4], mPositions[i * 4 + 1], mPositions[i * 4 + 2]);
+			glm::vec3 normal(mNormals[i * 4], mNormals[i * 4 + 1], mNormals[i * 4 + 2]);
+			float length = std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+			v.normal = length > 0.f ? normal / length : mBase.vertices[i].normal;
+		}
+	}
+
+	void MorphTargetSet::apply(ew::Mesh& mesh) {
+		if (!mDirty) return;
+		evaluate(mOutput);
+		mesh.load(mOutput);
+		mDirty = false;
+	}
+
+	size_t MorphTargetSet::getTargetBytes() const {
+		size_t bytes = 0;
+		for (const MorphTarget& target : mTargets)
+			bytes += target.indices.capacity() * sizeof(unsigned int) + target.deltas.capacity() * sizeof(float);
+		return bytes;
+	}
+}
@@ -0,0 +1,81 @@
+/*
+	MorphTargets // Brandon Salvietti
+
+	Blend shapes stored as sparse per-vertex deltas. Only the vertices a target actually moves are kept,
+	so a target costs memory proportional to what it touches rather than to the whole mesh.
+*/
+
+#pragma once
+#include "mesh.h"
+
+#include <string>
+#include <vector>
+
+namespace vg3o {
+
+	struct MorphTarget {
+		std::string name;
+		float weight = 0;
+
+		// vertex index for each delta, ascending
+		std::vector<unsigned int> indices;
+		// 8 floats per touched vertex: position delta xyz0 then normal delta xyz0, padded so each half is one SIMD register
+		std::vector<float> deltas;
+	};
+
+	class MorphTargetSet {
+	public:
+		/// <summary>
+		/// Sets the mesh targets are relative to. Clears existing targets.
+		/// </summary>
+		void setBase(const ew::MeshData& base);
+
+		/// <summary>
+		/// Adds a target from absolute positions/normals for every base vertex (the way Assimp stores anim meshes).
+		/// Vertices that moved less than epsilon are dropped.
+		/// </summary>
+		/// <param name="normals">May be null, the target then leaves normals alone.</param>
+		/// <returns>Index of the new target.</returns>
+		int addTarget(const std::string& name, const glm::vec3* positions, const glm::vec3* normals, float epsilon = 1e-6f);
+
+		int findTarget(const std::string& name) const;
+		void setWeight(int target, float weight);
+		float getWeight(int target) const { return mTargets[target].weight; }
+		int getNumTargets() const { return (int)mTargets.size(); }
+		const MorphTarget& getTarget(int target) const { return mTargets[target]; }
+		bool empty() const { return mTargets.empty(); }
+
+		/// <summary>
+		/// Blends every target with a non-zero weight onto the base. Normals are renormalized.
+		/// </summary>
+		void evaluate(ew::MeshData& out);
+
+		/// <summary>
+		/// Evaluates and uploads into a mesh if any weight changed since the last call. Use a DYNAMIC or STREAM mesh.
+		/// </summary>
+		void apply(ew::Mesh& mesh);
+
+		/// <summary>
+		/// Bytes held by all targets' sparse data, not counting the base.
+		/// </summary>
+		size_t getTargetBytes() const;
+
+		/// <summary>
+		/// Touched vertices processed by the last evaluate(), for throughput measurements.
+		/// </summary>
+		size_t getLastEvaluatedDeltas() const { return mLastEvaluatedDeltas; }
+	private:
+		ew::MeshData mBase;
+		std::vector<MorphTarget> mTargets;
+
+		// xyz0 per vertex so blending can load/store whole registers
+		std::vector<float> mBasePositions;
+		std::vector<float> mBaseNormals;
+		std::vector<float> mPositions;
+		std::vector<float> mNormals;
+
+		ew::MeshData mOutput;
+		size_t mLastEvaluatedDeltas = 0;
+		bool mDirty = true;
+	};
+}
@@ -0,0 +1,262 @@
+#include "RenderGraph.h"
+#include "GpuProfiler.h"
+#include "Trace.h"
+#include "external/glad.h"
+
+#include <iostream>
+#include <stdio.h>
+
+namespace vg3o {
+	static const char* getAccessName(ResourceAccess access) {
+		switch (access) {
+		case ResourceAccess::ATTACHMENT: return "attachment";
+		case ResourceAccess::SAMPLED: return "sampled";
+		default: return "image";
+		}
+	}
+
+	// what has to be made visible before an access can see image stores
+	static unsigned int getBarrierBits(ResourceAccess access) {
+		switch (access) {
+		case ResourceAccess::ATTACHMENT: return GL_FRAMEBUFFER_BARRIER_BIT;
+		case ResourceAccess::SAMPLED: return GL_TEXTURE_FETCH_BARRIER_BIT;
+		default: return GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+		}
+	}
+
+	/*
+		----
+		Declaring
+		----
+	*/
+	RenderPassBuilder& RenderPassBuilder::read(RenderResource resource, ResourceAccess access) {
+		mGraph->mPasses[mPass].reads.push_back({ resource, access });
+		return *this;
+	}
+
+	RenderPassBuilder& RenderPassBuilder::write(RenderResource resource, ResourceAccess access) {
+		mGraph->mPasses[mPass].writes.push_back({ resource, access });
+		mGraph->mResources[resource].writers.push_back(mPass);
+		return *this;
+	}
+
+	RenderPassBuilder& RenderPassBuilder::setSideEffect() {
+		mGraph->mPasses[mPass].sideEffect = true;
+		return *this;
+	}
+
+	void RenderGraph::reset() {
+		mPasses.clear();
+		mResources.clear();
+		mCompiled = false;
+	}
+
+	RenderResource RenderGraph::createTarget(const std::string& name, const RenderTargetDesc& desc) {
+		Resource resource;
+		resource.name = name;
+		resource.desc = desc;
+		mResources.push_back(resource);
+		mCompiled = false;
+		return (RenderResource)mResources.size() - 1;
+	}
+
+	RenderResource RenderGraph::importTarget(const std::string& name, const RenderTarget& target) {
+		Resource resource;
+		resource.name = name;
+		resource.target = target;
+		resource.imported = true;
+		mResources.push_back(resource);
+		mCompiled = false;
+		return (RenderResource)mResources.size() - 1;
+	}
+
+	RenderPassBuilder RenderGraph::addPass(const std::string& name, std::function<void()> execute) {
+		Pass pass;
+		pass.name = name;
+		pass.traceName = Trace::isRecording() ? Trace::intern(name) : nullptr;
+		pass.execute = execute;
+		mPasses.push_back(pass);
+		mCompiled = false;
+		return RenderPassBuilder(this, (int)mPasses.size() - 1);
+	}
+
+	/*
+		----
+		Compiling
+		----
+	*/
+	void RenderGraph::compile() {
+		mStats = RenderGraphStats();
+		mStats.numPasses = (unsigned int)mPasses.size();
+
+		// reference counts: a pass lives while something uses one of its outputs, a resource while a live pass reads it
+		std::vector<RenderResource> unused;
+		for (Resource& resource : mResources)
+			resource.refCount = 0;
+		for (Pass& pass : mPasses)
+		{
+			pass.culled = false;
+			pass.refCount = (int)pass.writes.size();
+			pass.barrierBits = 0;
+			pass.acquires.clear();
+			pass.releases.clear();
+			for (const Access& read : pass.reads)
+				mResources[read.resource].refCount++;
+		}
+		for (RenderResource i = 0; i < (RenderResource)mResources.size(); i++)
+		{
+			if (mResources[i].imported)
+				mResources[i].refCount++; // used outside the graph
+			if (mResources[i].refCount == 0)
+				unused.push_back(i);
+		}
+		auto cull = [&](Pass& pass) {
+			pass.culled = true;
+			mStats.numCulled++;
+			for (const Access& read : pass.reads)
+			{
+				if (--mResources[read.resource].refCount == 0)
+					unused.push_back(read.resource);
+			}
+		};
+		for (Pass& pass : mPasses)
+		{
+			if (pass.refCount == 0 && !pass.sideEffect)
+				cull(pass);
+		}
+		while (!unused.empty())
+		{
+			Resource& resource = mResources[unused.back()];
+			unused.pop_back();
+			for (int writer : resource.writers)
+			{
+				Pass& pass = mPasses[writer];
+				if (!pass.culled && --pass.refCount == 0 && !pass.sideEffect)
+					cull(pass);
+			}
+		}
+
+		// lifetimes over the surviving passes, and pending image stores per resource
+		std::vector<int> firstUse(mResources.size(), -1), lastUse(mResources.size(), -1);
+		std::vector<bool> written(mResources.size(), false), pendingImageStore(mResources.size(), false);
+		for (int i = 0; i < (int)mPasses.size(); i++)
+		{
+			Pass& pass = mPasses[i];
+			if (pass.culled) continue;
+			for (const Access& read : pass.reads)
+			{
+				if (!written[read.resource] && !mResources[read.resource].imported)
+					std::cout << "ERROR::RENDERGRAPH:: " << pass.name << " reads " << mResources[read.resource].name << " before anything writes it" << std::endl;
+			}
+			for (const std::vector<Access>* accesses : { &pass.reads, &pass.writes })
+			{
+				for (const Access& access : *accesses)
+				{
+					if (firstUse[access.resource] < 0) firstUse[access.resource] = i;
+					lastUse[access.resource] = i;
+					if (pendingImageStore[access.resource])
+					{
+						pass.barrierBits |= getBarrierBits(access.access);
+						pendingImageStore[access.resource] = false;
+					}
+				}
+			}
+			for (const Access& write : pass.writes)
+			{
+				written[write.resource] = true;
+				if (write.access == ResourceAccess::IMAGE)
+					pendingImageStore[write.resource] = true;
+			}
+		}
+		for (RenderResource i = 0; i < (RenderResource)mResources.size(); i++)
+		{
+			if (mResources[i].imported || firstUse[i] < 0) continue;
+			mPasses[firstUse[i]].acquires.push_back(i);
+			mPasses[lastUse[i]].releases.push_back(i);
+		}
+		mCompiled = true;
+	}
+
+	/*
+		----
+		Executing
+		----
+	*/
+	void RenderGraph::execute() {
+		if (!mCompiled)
+			compile();
+		for (Pass& pass : mPasses)
+		{
+			if (pass.culled) continue;
+			VG3O_TRACE_SCOPE(pass.traceName);
+			if (mProfiler != nullptr)
+				mProfiler->beginScope(pass.name);
+			for (RenderResource resource : pass.acquires)
+			{
+				mResources[resource].target = mPool.acquire(mResources[resource].desc);
+				mStats.numTransients++;
+			}
+			if (pass.barrierBits != 0)
+			{
+				glMemoryBarrier(pass.barrierBits);
+				mStats.numBarriers++;
+			}
+
+			RenderResource attachment = -1;
+			int numAttachments = 0;
+			for (const Access& write : pass.writes)
+			{
+				if (write.access != ResourceAccess::ATTACHMENT) continue;
+				attachment = write.resource;
+				numAttachments++;
+			}
+			if (numAttachments == 1)
+				mResources[attachment].target.use();
+			pass.execute();
+			if (mProfiler != nullptr)
+				mProfiler->endScope();
+
+			pass.bytesInUse = mPool.getStats().bytesInUse;
+			if (pass.bytesInUse > mStats.peakBytes)
+				mStats.peakBytes = pass.bytesInUse;
+			for (RenderResource resource : pass.releases)
+				mPool.release(mResources[resource].target);
+		}
+	}
+
+	std::string RenderGraph::dump() const {
+		char line[256];
+		snprintf(line, sizeof(line), "RenderGraph: %u passes, %u culled, %u barriers, peak %.2f MB\n",
+			mStats.numPasses, mStats.numCulled, mStats.numBarriers, mStats.peakBytes / (1024.0 * 1024.0));
+		std::string out = line;
+		int order = 1;
+		for (const Pass& pass : mPasses)
+		{
+			if (pass.culled)
+			{
+				out += "  -  " + pass.name + " (culled)\n";
+				continue;
+			}
+			snprintf(line, sizeof(line), "  %d. %s, %.2f MB in use\n", order++, pass.name.c_str(), pass.bytesInUse / (1024.0 * 1024.0));
+			out += line;
+			for (RenderResource resource : pass.acquires)
+			{
+				const RenderTarget& target = mResources[resource].target;
+				snprintf(line, sizeof(line), "       acquire %s %ux%u\n", mResources[resource].name.c_str(), target.width, target.height);
+				out += line;
+			}
+			if (pass.barrierBits != 0)
+			{
+				snprintf(line, sizeof(line), "       glMemoryBarrier(0x%X)\n", pass.barrierBits);
+				out += line;
+			}
+			for (const Access& read : pass.reads)
+				out += "       reads " + mResources[read.resource].name + " (" + getAccessName(read.access) + ")\n";
+			for (const Access& write : pass.writes)
+				out += "       writes " + mResources[write.resource].name + " (" + getAccessName(write.access) + ")\n";
+			for (RenderResource resource : pass.releases)
+				out += "       release " + mResources[resource].name + "\n";
+		}
+		return out;
+	}
+}
@@ -0,0 +1,145 @@
+/*
+	RenderGraph // Brandon Salvietti
+
+	The frame is declared as passes that read and write named render targets, then compiled:
+	passes nothing depends on are culled, transient targets are acquired from the pool right before
+	their first use and released right after their last, so later passes can alias their memory, and
+	glMemoryBarrier is inserted wherever a pass reads what an earlier pass wrote through image stores.
+	Rebuilt every frame: reset(), declare, compile(), execute().
+*/
+
+#pragma once
+#include "RenderTargetPool.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace vg3o {
+	class RenderGraph;
+	class GpuProfiler;
+
+	typedef int RenderResource;
+
+	enum class ResourceAccess {
+		ATTACHMENT, // rendered to, or depth tested/blended against
+		SAMPLED, // texture() in a shader
+		IMAGE // imageLoad/imageStore, needs a barrier before anything else sees it
+	};
+
+	/// <summary>
+	/// Declares what a pass touches. Returned by addPass, valid until the next addPass.
+	/// </summary>
+	class RenderPassBuilder {
+	public:
+		RenderPassBuilder& read(RenderResource resource, ResourceAccess access = ResourceAccess::SAMPLED);
+		/// <summary>
+		/// If a pass writes exactly one target as an attachment, the graph binds it (and its viewport) before the pass runs.
+		/// </summary>
+		RenderPassBuilder& write(RenderResource resource, ResourceAccess access = ResourceAccess::ATTACHMENT);
+		/// <summary>
+		/// Never culled, for passes whose effect is outside the graph (readbacks, queries).
+		/// </summary>
+		RenderPassBuilder& setSideEffect();
+	private:
+		friend class RenderGraph;
+		RenderPassBuilder(RenderGraph* graph, int pass) : mGraph(graph), mPass(pass) {}
+		RenderGraph* mGraph;
+		int mPass;
+	};
+
+	struct RenderGraphStats {
+		unsigned int numPasses = 0;
+		unsigned int numCulled = 0;
+		unsigned int numBarriers = 0;
+		unsigned int numTransients = 0; // targets acquired from the pool
+		size_t peakBytes = 0; // pool memory in use at the busiest pass
+	};
+
+	class RenderGraph {
+	public:
+		RenderGraph(RenderTargetPool& pool) : mPool(pool) {}
+
+		/// <summary>
+		/// Times every pass that runs as a scope named after it. Null turns it off.
+		/// </summary>
+		void setProfiler(GpuProfiler* profiler) { mProfiler = profiler; }
+
+		/// <summary>
+		/// Drops every pass and resource from the last frame.
+		/// </summary>
+		void reset();
+
+		/// <summary>
+		/// A target that only lives inside this frame's graph.
+		/// </summary>
+		RenderResource createTarget(const std::string& name, const RenderTargetDesc& desc);
+
+		/// <summary>
+		/// A target owned elsewhere, e.g. the default framebuffer. Writing to one keeps the pass alive.
+		/// </summary>
+		RenderResource importTarget(const std::string& name, const RenderTarget& target);
+
+		RenderPassBuilder addPass(const std::string& name, std::function<void()> execute);
+
+		/// <summary>
+		/// Culls, orders the transient lifetimes and works out barriers. Called by execute() if needed.
+		/// </summary>
+		void compile();
+
+		/// <summary>
+		/// Runs every surviving pass in declaration order.
+		/// </summary>
+		void execute();
+
+		/// <summary>
+		/// The target behind a resource, valid while the passes using it run.
+		/// </summary>
+		const RenderTarget& getTarget(RenderResource resource) const { return mResources[resource].target; }
+
+		/// <summary>
+		/// Pass order, what each pass reads and writes, the barriers and acquires/releases around it, and pool memory in use.
+		/// Memory is filled in by execute().
+		/// </summary>
+		std::string dump() const;
+
+		RenderGraphStats getStats() const { return mStats; }
+	private:
+		friend class RenderPassBuilder;
+
+		struct Access {
+			RenderResource resource;
+			ResourceAccess access;
+		};
+
+		struct Pass {
+			std::string name;
+			const char* traceName = nullptr; // interned only while a trace is recording
+			std::function<void()> execute;
+			std::vector<Access> reads;
+			std::vector<Access> writes;
+			bool sideEffect = false;
+			bool culled = false;
+			int refCount = 0;
+			unsigned int barrierBits = 0;
+			std::vector<RenderResource> acquires; // first used here
+			std::vector<RenderResource> releases; // last used here
+			size_t bytesInUse = 0;
+		};
+
+		struct Resource {
+			std::string name;
+			RenderTargetDesc desc;
+			RenderTarget target;
+			bool imported = false;
+			int refCount = 0;
+			std::vector<int> writers;
+		};
+
+		RenderTargetPool& mPool;
+		GpuProfiler* mProfiler = nullptr;
+		std::vector<Pass> mPasses;
+		std::vector<Resource> mResources;
+		bool mCompiled = false;
+		RenderGraphStats mStats;
+	};
+}
@@ -0,0 +1,224 @@
+#include "RenderQueue.h"
+#include "GLState.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string.h>
+
+namespace vg3o {
+	const int PASS_SHIFT = 56;
+	const int SHADER_SHIFT = 44;
+	const int MATERIAL_SHIFT = 24;
+	const unsigned int DEPTH_BITS = 24;
+
+	void RenderQueue::setPass(unsigned int passId, std::function<void()> begin) {
+		if (passId >= MAX_PASSES)
+		{
+			std::cout << "ERROR::RENDERQUEUE:: Pass id " << passId << " is out of range" << std::endl;
+			return;
+		}
+		if (mPasses.size() <= passId)
+			mPasses.resize(passId + 1);
+		mPasses[passId] = begin;
+	}
+
+	unsigned long long RenderQueue::makeKey(unsigned int passId, const ew::Shader& shader, const RenderMaterial& material, float depth, unsigned int& materialIndex) {
+		auto shaderIt = mShaderIndices.find(shader.getId());
+		unsigned int shaderIndex;
+		if (shaderIt != mShaderIndices.end())
+			shaderIndex = shaderIt->second;
+		else
+		{
+			shaderIndex = (unsigned int)mShaderIndices.size() % MAX_SHADERS;
+			mShaderIndices[shader.getId()] = shaderIndex;
+		}
+
+		// FNV-1a over the texture names
+		unsigned long long hash = 14695981039346656037ull;
+		for (unsigned int i = 0; i < RenderMaterial::MAX_TEXTURES; i++)
+		{
+			hash ^= material.textures[i];
+			hash *= 1099511628211ull;
+		}
+		// texture sets that collide share a bucket, so each still ends up with one index
+		std::vector<unsigned int>& bucket = mMaterialIndices[hash];
+		auto materialIt = std::find_if(bucket.begin(), bucket.end(), [&](unsigned int index) {
+			return memcmp(mMaterials[index].textures, material.textures, sizeof(material.textures)) == 0;
+		});
+		if (materialIt != bucket.end())
+			materialIndex = *materialIt;
+		else
+		{
+			materialIndex = (unsigned int)mMaterials.size();
+			mMaterials.push_back(material);
+			bucket.push_back(materialIndex);
+		}
+
+		// non-negative floats sort the same as their bit patterns, so the top bits work as a coarse depth
+		if (!(depth > 0)) depth = 0;
+		unsigned int depthBits;
+		memcpy(&depthBits, &depth, sizeof(depthBits));
+		depthBits >>= 32 - DEPTH_BITS;
+
+		return ((unsigned long long)(passId % MAX_PASSES) << PASS_SHIFT)
+			| ((unsigned long long)shaderIndex << SHADER_SHIFT)
+			| ((unsigned long long)(materialIndex % MAX_MATERIALS) << MATERIAL_SHIFT)
+			| depthBits;
+	}
+
+	void RenderQueue::addItem(unsigned int passId, const ew::Mesh* mesh, int drawCallback, const ew::Shader& shader, const RenderMaterial& material, const glm::mat4& transform, float depth) {
+		Item item;
+		item.mesh = mesh;
+		item.drawCallback = drawCallback;
+		item.shader = &shader;
+		item.transform = transform;
+		item.layer = material.layer;
+		mKeys.push_back(makeKey(passId, shader, material, depth, item.material));
+		mItems.push_back(item);
+		mSorted = false;
+	}
+
+	void RenderQueue::submit(unsigned int passId, const ew::Mesh& mesh, const ew::Shader& shader, const RenderMaterial& material, const glm::mat4& transform, float depth) {
+		addItem(passId, &mesh, -1, shader, material, transform, depth);
+	}
+
+	void RenderQueue::submit(unsigned int passId, std::function<void()> draw, const ew::Shader& shader, const RenderMaterial& material, const glm::mat4& transform, float depth) {
+		mDrawCallbacks.push_back(draw);
+		addItem(passId, nullptr, (int)mDrawCallbacks.size() - 1, shader, material, transform, depth);
+	}
+
+	void RenderQueue::sort() {
+		auto startTime = std::chrono::high_resolution_clock::now();
+		size_t count = mKeys.size();
+		mOrder.resize(count);
+		for (size_t i = 0; i < count; i++)
+			mOrder[i] = (unsigned int)i;
+		mKeyScratch.resize(count);
+		mOrderScratch.resize(count);
+
+		// LSD radix sort, one byte per pass. Bytes that are the same for every key (unused depth bits, one pass only...) are skipped
+		for (int shift = 0; shift < 64; shift += 8)
+		{
+			unsigned int histogram[256] = { 0 };
+			for (size_t i = 0; i < count; i++)
+				histogram[(mKeys[i] >> shift) & 0xFF]++;
+			if (count == 0 || histogram[(mKeys[0] >> shift) & 0xFF] == count)
+				continue;
+
+			unsigned int offset = 0;
+			for (int b = 0; b < 256; b++)
+			{
+				unsigned int n = histogram[b];
+				histogram[b] = offset;
+				offset += n;
+			}
+			for (size_t i = 0; i < count; i++)
+			{
+				unsigned int destination = histogram[(mKeys[i] >> shift) & 0xFF]++;
+				mKeyScratch[destination] = mKeys[i];
+				mOrderScratch[destination] = mOrder[i];
+			}
+			mKeys.swap(mKeyScratch);
+			mOrder.swap(mOrderScratch);
+		}
+
+		// count what execute() will have to change
+		mStats = RenderQueueStats();
+		mStats.numItems = (unsigned int)count;
+		unsigned long long previous = 0;
+		unsigned int previousProgram = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			unsigned long long key = mKeys[i];
+			const Item& item = mItems[mOrder[i]];
+			if (i == 0 || (key >> PASS_SHIFT) != (previous >> PASS_SHIFT))
+				mStats.passChanges++;
+			if (i == 0 || item.shader->getId() != previousProgram)
+				mStats.shaderChanges++;
+			if (i == 0 || (key >> MATERIAL_SHIFT) != (previous >> MATERIAL_SHIFT))
+				mStats.materialChanges++;
+			previous = key;
+			previousProgram = item.shader->getId();
+		}
+		mStats.sortMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+		mSorted = true;
+	}
+
+	void RenderQueue::execute() {
+		if (!mSorted)
+			sort();
+		// every registered pass runs, including ones with nothing submitted
+		size_t numPasses = mPasses.size();
+		if (!mKeys.empty() && (mKeys.back() >> PASS_SHIFT) + 1 > numPasses)
+			numPasses = (size_t)(mKeys.back() >> PASS_SHIFT) + 1;
+		for (size_t pass = 0; pass < numPasses; pass++)
+			executePass((unsigned int)pass);
+		clear();
+	}
+
+	void RenderQueue::executePass(unsigned int passId) {
+		if (!mSorted)
+			sort();
+		passId %= MAX_PASSES;
+		// keys are sorted by pass first, so the pass is one contiguous range
+		auto begin = std::lower_bound(mKeys.begin(), mKeys.end(), (unsigned long long)passId << PASS_SHIFT);
+		auto end = passId + 1 < MAX_PASSES ? std::lower_bound(begin, mKeys.end(), (unsigned long long)(passId + 1) << PASS_SHIFT) : mKeys.end();
+		if (passId < mPasses.size() && mPasses[passId])
+			mPasses[passId]();
+		drawRange(begin - mKeys.begin(), end - mKeys.begin());
+	}
+
+	void RenderQueue::drawRange(size_t begin, size_t end) {
+		// pass setup may have bound anything, so the first item sets everything
+		const ew::Shader* shader = nullptr;
+		ew::UniformId modelId;
+		ew::UniformId layerId;
+		int layer = 0;
+		unsigned int material = 0xFFFFFFFF;
+		for (size_t i = begin; i < end; i++)
+		{
+			const Item& item = mItems[mOrder[i]];
+			if (item.shader != shader)
+			{
+				shader = item.shader;
+				shader->use();
+				modelId = shader->getUniformId("_Model");
+				layerId = shader->getUniformId("_TextureLayer");
+				layer = -1;
+			}
+			if (item.material != material)
+			{
+				material = item.material;
+				const RenderMaterial& textures = mMaterials[material];
+				for (unsigned int t = 0; t < RenderMaterial::MAX_TEXTURES; t++)
+				{
+					if (textures.textures[t] != 0)
+						GLState::bindTexture(t, textures.textures[t]);
+				}
+			}
+			if (layerId.location >= 0 && item.layer != layer)
+			{
+				layer = item.layer;
+				shader->setInt(layerId, layer);
+				mStats.layerChanges++;
+			}
+			shader->setMat4(modelId, item.transform);
+			if (item.mesh != nullptr)
+				item.mesh->draw();
+			else
+				mDrawCallbacks[item.drawCallback]();
+		}
+	}
+
+	void RenderQueue::clear() {
+		mItems.clear();
+		mKeys.clear();
+		mOrder.clear();
+		mDrawCallbacks.clear();
+		mMaterials.clear();
+		mShaderIndices.clear();
+		mMaterialIndices.clear();
+		mSorted = false;
+	}
+}
@@ -0,0 +1,118 @@
+/*
+	RenderQueue // Brandon Salvietti
+
+	Passes submit draw items instead of drawing directly. Each item gets a 64 bit key ordered by
+	pass, shader, material and depth, the queue radix sorts the keys and then walks the items,
+	only switching program/textures/pass state when the key says it changed.
+
+	Key layout, most significant first:
+		pass     8 bits
+		shader  12 bits (order of first submission this frame)
+		material 20 bits (order of first submission this frame)
+		depth   24 bits (top bits of the float, front to back)
+*/
+
+#pragma once
+#include "mesh.h"
+#include "shader.h"
+#include <glm/glm.hpp>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+namespace vg3o {
+
+	struct RenderMaterial {
+		static const unsigned int MAX_TEXTURES = 4;
+		// bound to units 0..MAX_TEXTURES-1, 0 leaves the unit alone
+		unsigned int textures[MAX_TEXTURES] = { 0, 0, 0, 0 };
+		// array layer for shaders with an int _TextureLayer uniform. Not part of the sort key,
+		// so materials packed into the same arrays share binds and only change this uniform
+		int layer = 0;
+	};
+
+	struct RenderQueueStats {
+		unsigned int numItems = 0;
+		unsigned int passChanges = 0;
+		unsigned int shaderChanges = 0;
+		unsigned int materialChanges = 0;
+		unsigned int layerChanges = 0; // _TextureLayer sets, counted while executing
+		double sortMilliseconds = 0;
+	};
+
+	class RenderQueue {
+	public:
+		static const unsigned int MAX_PASSES = 1 << 8;
+		static const unsigned int MAX_SHADERS = 1 << 12;
+		static const unsigned int MAX_MATERIALS = 1 << 20;
+
+		/// <summary>
+		/// Called before the first item of the pass, e.g. to bind its framebuffer and pass uniforms.
+		/// Registered passes run every frame even when nothing was submitted to them.
+		/// </summary>
+		void setPass(unsigned int passId, std::function<void()> begin);
+
+		/// <param name="depth">Distance from the camera, nearer items draw first within the same shader and material.</param>
+		void submit(unsigned int passId, const ew::Mesh& mesh, const ew::Shader& shader, const RenderMaterial& material, const glm::mat4& transform, float depth = 0);
+
+		/// <summary>
+		/// For things that draw themselves (terrain, batches). The callback runs with the shader, material and _Model already set.
+		/// </summary>
+		void submit(unsigned int passId, std::function<void()> draw, const ew::Shader& shader, const RenderMaterial& material, const glm::mat4& transform, float depth = 0);
+
+		/// <summary>
+		/// Sorts the submitted items and counts the state changes executing them will take. Called by execute() if needed.
+		/// </summary>
+		void sort();
+
+		/// <summary>
+		/// Draws everything in key order, then clears the queue. Pass ids without a begin callback just draw.
+		/// </summary>
+		void execute();
+
+		/// <summary>
+		/// Runs one pass's begin callback and draws its items, leaving the queue as it is. For callers that schedule
+		/// passes themselves (RenderGraph), who then call clear() once every pass ran.
+		/// </summary>
+		void executePass(unsigned int passId);
+
+		/// <summary>
+		/// Drops submitted items without drawing. Registered passes are kept.
+		/// </summary>
+		void clear();
+
+		size_t getNumItems() const { return mItems.size(); }
+		/// <summary>
+		/// Stats of the last sort.
+		/// </summary>
+		RenderQueueStats getStats() const { return mStats; }
+	private:
+		struct Item {
+			const ew::Mesh* mesh;
+			int drawCallback; // index into mDrawCallbacks, -1 for meshes
+			const ew::Shader* shader;
+			unsigned int material; // index into mMaterials
+			int layer;
+			glm::mat4 transform;
+		};
+		unsigned long long makeKey(unsigned int passId, const ew::Shader& shader, const RenderMaterial& material, float depth, unsigned int& materialIndex);
+		void drawRange(size_t begin, size_t end);
+		void addItem(unsigned int passId, const ew::Mesh* mesh, int drawCallback, const ew::Shader& shader, const RenderMaterial& material, const glm::mat4& transform, float depth);
+
+		std::vector<Item> mItems;
+		std::vector<unsigned long long> mKeys;
+		std::vector<unsigned int> mOrder;
+		// radix sort scratch, kept between frames so sorting doesn't allocate
+		std::vector<unsigned long long> mKeyScratch;
+		std::vector<unsigned int> mOrderScratch;
+		bool mSorted = false;
+
+		std::vector<std::function<void()>> mDrawCallbacks;
+		std::vector<RenderMaterial> mMaterials;
+		std::unordered_map<unsigned int, unsigned int> mShaderIndices; // program -> key bits
+		std::unordered_map<unsigned long long, std::vector<unsigned int>> mMaterialIndices; // texture hash -> indices into mMaterials
+		std::vector<std::function<void()>> mPasses;
+
+		RenderQueueStats mStats;
+	};
+}
@@ -0,0 +1,240 @@
+#include "RenderTargetPool.h"
+#include "GLState.h"
+#include "external/glad.h"
+
+#include <iostream>
+#include <string.h>
+
+namespace vg3o {
+	// what the driver most likely stores, 3 component formats are padded to 4
+	static size_t getBytesPerPixel(unsigned int format) {
+		switch (format) {
+		case GL_RGBA32F:
+			return 16;
+		case GL_RGB16F:
+		case GL_RGBA16F:
+		case GL_RG32F:
+			return 8;
+		case GL_RG16F:
+		case GL_R32F:
+		case GL_RGBA8:
+		case GL_RGB8:
+		case GL_R11F_G11F_B10F:
+		case GL_RGB10_A2:
+		case GL_DEPTH24_STENCIL8:
+		case GL_DEPTH_COMPONENT24:
+		case GL_DEPTH_COMPONENT32F:
+			return 4;
+		case GL_DEPTH32F_STENCIL8:
+			return 8;
+		case GL_R16F:
+		case GL_RG8:
+		case GL_DEPTH_COMPONENT16:
+			return 2;
+		case GL_R8:
+			return 1;
+		default:
+			return 4;
+		}
+	}
+
+	static bool isDepthFormat(unsigned int format) {
+		return format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8 || format == GL_DEPTH_COMPONENT16
+			|| format == GL_DEPTH_COMPONENT24 || format == GL_DEPTH_COMPONENT32F;
+	}
+
+	void RenderTarget::use() const {
+		GLState::bindFramebuffer(framebuffer);
+		glViewport(0, 0, width, height);
+	}
+
+	RenderTargetPool::RenderTargetPool(unsigned int maxIdleFrames) {
+		mMaxIdleFrames = maxIdleFrames;
+	}
+
+	RenderTargetPool::~RenderTargetPool() {
+		while (!mTextures.empty())
+			deleteTexture(mTextures.size() - 1);
+	}
+
+	void RenderTargetPool::deleteTexture(size_t index) {
+		unsigned int texture = mTextures[index].texture;
+		// framebuffers built on it are useless now
+		for (size_t i = 0; i < mFramebuffers.size();)
+		{
+			CachedFramebuffer& framebuffer = mFramebuffers[i];
+			bool uses = false;
+			for (unsigned int attachment : framebuffer.attachments)
+				uses |= attachment == texture;
+			if (uses)
+			{
+				glDeleteFramebuffers(1, &framebuffer.framebuffer);
+				GLState::framebufferDeleted(framebuffer.framebuffer);
+				mFramebuffers[i] = mFramebuffers.back();
+				mFramebuffers.pop_back();
+			}
+			else
+				i++;
+		}
+		glDeleteTextures(1, &texture);
+		GLState::textureDeleted(texture);
+		mTextures[index] = mTextures.back();
+		mTextures.pop_back();
+	}
+
+	void RenderTargetPool::beginFrame(unsigned int screenWidth, unsigned int screenHeight) {
+		mFrame++;
+		bool resized = screenWidth != mScreenWidth || screenHeight != mScreenHeight;
+		mScreenWidth = screenWidth;
+		mScreenHeight = screenHeight;
+		for (size_t i = 0; i < mTextures.size();)
+		{
+			const PooledTexture& texture = mTextures[i];
+			bool stale = (resized && texture.screenSized) || texture.lastUsedFrame + mMaxIdleFrames < mFrame;
+			if (!texture.inUse && stale)
+				deleteTexture(i);
+			else
+				i++;
+		}
+	}
+
+	unsigned int RenderTargetPool::acquireTexture(unsigned int format, unsigned int width, unsigned int height, bool screenSized) {
+		for (PooledTexture& texture : mTextures)
+		{
+			if (texture.inUse || texture.format != format || texture.width != width || texture.height != height)
+				continue;
+			texture.inUse = true;
+			texture.lastUsedFrame = mFrame;
+			mNumReuses++;
+			return texture.texture;
+		}
+
+		PooledTexture texture;
+		glCreateTextures(GL_TEXTURE_2D, 1, &texture.texture);
+		glTextureStorage2D(texture.texture, 1, format, width, height);
+		if (isDepthFormat(format))
+		{
+			// white border so shadow lookups outside the map are lit
+			float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+			glTextureParameteri(texture.texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTextureParameteri(texture.texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glTextureParameteri(texture.texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+			glTextureParameteri(texture.texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+			glTextureParameterfv(texture.texture, GL_TEXTURE_BORDER_COLOR, borderColor);
+		}
+		else
+		{
+			glTextureParameteri(texture.texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTextureParameteri(texture.texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTextureParameteri(texture.texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTextureParameteri(texture.texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		}
+		texture.format = format;
+		texture.width = width;
+		texture.height = height;
+		texture.bytes = (size_t)width * height * getBytesPerPixel(format);
+		texture.screenSized = screenSized;
+		texture.inUse = true;
+		texture.lastUsedFrame = mFrame;
+		mTextures.push_back(texture);
+		mNumAllocations++;
+		return texture.texture;
+	}
+
+	unsigned int RenderTargetPool::getFramebuffer(const unsigned int attachments[RenderTargetDesc::MAX_COLOR_ATTACHMENTS + 1]) {
+		for (CachedFramebuffer& framebuffer : mFramebuffers)
+		{
+			if (memcmp(framebuffer.attachments, attachments, sizeof(framebuffer.attachments)) == 0)
+			{
+				framebuffer.lastUsedFrame = mFrame;
+				return framebuffer.framebuffer;
+			}
+		}
+
+		CachedFramebuffer framebuffer;
+		memcpy(framebuffer.attachments, attachments, sizeof(framebuffer.attachments));
+		framebuffer.lastUsedFrame = mFrame;
+		glCreateFramebuffers(1, &framebuffer.framebuffer);
+		unsigned int drawBuffers[RenderTargetDesc::MAX_COLOR_ATTACHMENTS];
+		int numDrawBuffers = 0;
+		for (unsigned int i = 0; i < RenderTargetDesc::MAX_COLOR_ATTACHMENTS; i++)
+		{
+			if (attachments[i] == 0) continue;
+			glNamedFramebufferTexture(framebuffer.framebuffer, GL_COLOR_ATTACHMENT0 + i, attachments[i], 0);
+			drawBuffers[numDrawBuffers++] = GL_COLOR_ATTACHMENT0 + i;
+		}
+		unsigned int depth = attachments[RenderTargetDesc::MAX_COLOR_ATTACHMENTS];
+		if (depth != 0)
+		{
+			unsigned int format = 0;
+			for (const PooledTexture& texture : mTextures)
+			{
+				if (texture.texture == depth) format = texture.format;
+			}
+			bool stencil = format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+			glNamedFramebufferTexture(framebuffer.framebuffer, stencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT, depth, 0);
+		}
+		if (numDrawBuffers > 0)
+			glNamedFramebufferDrawBuffers(framebuffer.framebuffer, numDrawBuffers, drawBuffers);
+		else
+		{
+			glNamedFramebufferDrawBuffer(framebuffer.framebuffer, GL_NONE);
+			glNamedFramebufferReadBuffer(framebuffer.framebuffer, GL_NONE);
+		}
+		if (glCheckNamedFramebufferStatus(framebuffer.framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			std::cout << "ERROR::RENDERTARGETPOOL:: Framebuffer is not complete!" << std::endl;
+		mFramebuffers.push_back(framebuffer);
+		return framebuffer.framebuffer;
+	}
+
+	RenderTarget RenderTargetPool::acquire(const RenderTargetDesc& desc) {
+		RenderTarget target;
+		bool screenSized = desc.width == 0 && desc.height == 0;
+		target.width = screenSized ? (unsigned int)(mScreenWidth * desc.scale + 0.5f) : desc.width;
+		target.height = screenSized ? (unsigned int)(mScreenHeight * desc.scale + 0.5f) : desc.height;
+		target.width = target.width > 0 ? target.width : 1;
+		target.height = target.height > 0 ? target.height : 1;
+
+		unsigned int attachments[RenderTargetDesc::MAX_COLOR_ATTACHMENTS + 1] = {};
+		for (unsigned int i = 0; i < RenderTargetDesc::MAX_COLOR_ATTACHMENTS; i++)
+		{
+			if (desc.colorFormats[i] != 0)
+				attachments[i] = target.colorTextures[i] = acquireTexture(desc.colorFormats[i], target.width, target.height, screenSized);
+		}
+		if (desc.depthFormat != 0)
+			attachments[RenderTargetDesc::MAX_COLOR_ATTACHMENTS] = target.depthTexture = acquireTexture(desc.depthFormat, target.width, target.height, screenSized);
+		target.framebuffer = getFramebuffer(attachments);
+		return target;
+	}
+
+	void RenderTargetPool::release(const RenderTarget& target) {
+		for (PooledTexture& texture : mTextures)
+		{
+			if (texture.texture == target.depthTexture)
+				texture.inUse = false;
+			for (unsigned int color : target.colorTextures)
+			{
+				if (texture.texture == color)
+					texture.inUse = false;
+			}
+		}
+	}
+
+	RenderTargetPoolStats RenderTargetPool::getStats() const {
+		RenderTargetPoolStats stats;
+		stats.numTextures = (unsigned int)mTextures.size();
+		stats.numFramebuffers = (unsigned int)mFramebuffers.size();
+		stats.numAllocations = mNumAllocations;
+		stats.numReuses = mNumReuses;
+		for (const PooledTexture& texture : mTextures)
+		{
+			stats.bytesAllocated += texture.bytes;
+			if (texture.inUse)
+			{
+				stats.numInUse++;
+				stats.bytesInUse += texture.bytes;
+			}
+		}
+		return stats;
+	}
+}
@@ -0,0 +1,105 @@
+/*
+	RenderTargetPool // Brandon Salvietti
+
+	Hands out framebuffers for a pass instead of each pass owning one. Attachments are pooled
+	per format and size, so a texture released by one pass is reused by the next pass that asks
+	for the same kind, whichever attachment set it is part of. Screen sized targets follow the
+	window and are reallocated the first time they are asked for after a resize.
+*/
+
+#pragma once
+#include <stddef.h>
+#include <vector>
+
+namespace vg3o {
+
+	struct RenderTargetDesc {
+		static const unsigned int MAX_COLOR_ATTACHMENTS = 4;
+		unsigned int width = 0; // 0 for both follows the screen size times scale
+		unsigned int height = 0;
+		float scale = 1.0f;
+		unsigned int colorFormats[MAX_COLOR_ATTACHMENTS] = { 0x881B, 0, 0, 0 }; // GL_RGB16F, 0 leaves the attachment out
+		unsigned int depthFormat = 0x88F0; // GL_DEPTH24_STENCIL8, 0 for no depth
+	};
+
+	/// <summary>
+	/// Valid until it is released. Depth is always a texture so later passes can sample it.
+	/// </summary>
+	struct RenderTarget {
+		unsigned int framebuffer = 0;
+		unsigned int colorTextures[RenderTargetDesc::MAX_COLOR_ATTACHMENTS] = { 0, 0, 0, 0 };
+		unsigned int depthTexture = 0;
+		unsigned int width = 0;
+		unsigned int height = 0;
+
+		/// <summary>
+		/// Binds the framebuffer and sets the viewport to cover it.
+		/// </summary>
+		void use() const;
+	};
+
+	struct RenderTargetPoolStats {
+		unsigned int numTextures = 0; // alive, in use or free
+		unsigned int numInUse = 0;
+		unsigned int numFramebuffers = 0;
+		unsigned int numAllocations = 0; // textures created since startup
+		unsigned int numReuses = 0; // acquires answered by a pooled texture
+		size_t bytesAllocated = 0;
+		size_t bytesInUse = 0;
+	};
+
+	class RenderTargetPool {
+	public:
+		/// <param name="maxIdleFrames">Free textures untouched for this many frames are deleted.</param>
+		RenderTargetPool(unsigned int maxIdleFrames = 3);
+		~RenderTargetPool();
+		RenderTargetPool(const RenderTargetPool&) = delete;
+		RenderTargetPool& operator=(const RenderTargetPool&) = delete;
+
+		/// <summary>
+		/// Call once per frame before acquiring. A new size drops free screen sized textures right away,
+		/// ones still in use go when they are released and age out.
+		/// </summary>
+		void beginFrame(unsigned int screenWidth, unsigned int screenHeight);
+
+		/// <summary>
+		/// A target matching the description, made of pooled attachments where possible.
+		/// </summary>
+		RenderTarget acquire(const RenderTargetDesc& desc);
+
+		/// <summary>
+		/// Ends the target's lifetime, its attachments can be handed to any later acquire, even in the same frame.
+		/// </summary>
+		void release(const RenderTarget& target);
+
+		RenderTargetPoolStats getStats() const;
+	private:
+		struct PooledTexture {
+			unsigned int texture;
+			unsigned int format;
+			unsigned int width, height;
+			size_t bytes;
+			bool screenSized;
+			bool inUse;
+			unsigned long long lastUsedFrame;
+		};
+		struct CachedFramebuffer {
+			unsigned int framebuffer;
+			unsigned int attachments[RenderTargetDesc::MAX_COLOR_ATTACHMENTS + 1]; // colors, then depth
+			unsigned long long lastUsedFrame;
+		};
+
+		unsigned int acquireTexture(unsigned int format, unsigned int width, unsigned int height, bool screenSized);
+		unsigned int getFramebuffer(const unsigned int attachments[RenderTargetDesc::MAX_COLOR_ATTACHMENTS + 1]);
+		void deleteTexture(size_t index);
+
+		std::vector<PooledTexture> mTextures;
+		std::vector<CachedFramebuffer> mFramebuffers;
+		unsigned int mScreenWidth = 0;
+		unsigned int mScreenHeight = 0;
+		unsigned long long mFrame = 0;
+		unsigned int mMaxIdleFrames;
+		unsigned int mNumAllocations = 0;
+		unsigned int mNumReuses = 0;
+	};
+}
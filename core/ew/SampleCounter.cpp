@@ -0,0 +1,52 @@
+#include "SampleCounter.h"
+#include "external/glad.h"
+
+namespace vg3o {
+	SampleCounter::SampleCounter(unsigned int framesInFlight) {
+		mSlots.resize(framesInFlight > 0 ? framesInFlight : 1);
+		for (Slot& slot : mSlots)
+			glCreateQueries(GL_SAMPLES_PASSED, 1, &slot.query);
+	}
+
+	SampleCounter::~SampleCounter() {
+		for (Slot& slot : mSlots)
+			glDeleteQueries(1, &slot.query);
+	}
+
+	void SampleCounter::begin(unsigned long long frame) {
+		Slot& slot = mSlots[mNext];
+		if (slot.pending)
+			return;
+		slot.frame = frame;
+		glBeginQuery(GL_SAMPLES_PASSED, slot.query);
+		mActive = (int)mNext;
+	}
+
+	void SampleCounter::end() {
+		if (mActive < 0)
+			return;
+		glEndQuery(GL_SAMPLES_PASSED);
+		mSlots[mActive].pending = true;
+		mNext = (mNext + 1) % mSlots.size();
+		mActive = -1;
+	}
+
+	void SampleCounter::update() {
+		for (Slot& slot : mSlots)
+		{
+			if (!slot.pending) continue;
+			int available = 0;
+			glGetQueryObjectiv(slot.query, GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available) continue;
+			GLuint64 samples = 0;
+			glGetQueryObjectui64v(slot.query, GL_QUERY_RESULT, &samples);
+			slot.pending = false;
+			if (!mHasResult || slot.frame >= mFrame)
+			{
+				mSamples = samples;
+				mFrame = slot.frame;
+				mHasResult = true;
+			}
+		}
+	}
+}
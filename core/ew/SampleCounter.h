@@ -0,0 +1,52 @@
+/*
+	SampleCounter // Brandon Salvietti
+
+	Counts the samples that pass the depth test between begin() and end() with GL_SAMPLES_PASSED
+	queries. Results are read back a few frames later from a ring of queries, so counting never waits
+	on the GPU. A frame whose query is still in flight is skipped rather than stalled on.
+*/
+
+#pragma once
+#include <vector>
+
+namespace vg3o {
+
+	class SampleCounter {
+	public:
+		SampleCounter(unsigned int framesInFlight = 4);
+		~SampleCounter();
+		SampleCounter(const SampleCounter&) = delete;
+		SampleCounter& operator=(const SampleCounter&) = delete;
+
+		/// <summary>
+		/// Starts counting for a frame. Only one counter can be counting at a time.
+		/// </summary>
+		/// <param name="frame">Tags the result, so counts from different counters can be matched up.</param>
+		void begin(unsigned long long frame);
+		void end();
+
+		/// <summary>
+		/// Reads back every query that has finished. Call once per frame, outside begin()/end().
+		/// </summary>
+		void update();
+
+		/// <summary>
+		/// Samples counted in the newest frame read back, and that frame. No result yet leaves both 0.
+		/// </summary>
+		unsigned long long getSamples() const { return mSamples; }
+		unsigned long long getFrame() const { return mFrame; }
+		bool hasResult() const { return mHasResult; }
+	private:
+		struct Slot {
+			unsigned int query = 0;
+			unsigned long long frame = 0;
+			bool pending = false;
+		};
+		std::vector<Slot> mSlots;
+		unsigned int mNext = 0;
+		int mActive = -1; // slot counting right now
+		unsigned long long mSamples = 0;
+		unsigned long long mFrame = 0;
+		bool mHasResult = false;
+	};
+}
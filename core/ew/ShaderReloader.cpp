@@ -0,0 +1,117 @@
+#include "ShaderReloader.h"
+#include "external/glad.h"
+
+#include <iostream>
+
+namespace vg3o {
+	void ShaderReloader::add(ew::Shader* shader, const std::string& vertexShader, const std::string& fragmentShader, const std::vector<std::string>& defines) {
+		Entry entry;
+		entry.shader = shader;
+		entry.vertexShader = vertexShader;
+		entry.fragmentShader = fragmentShader;
+		entry.defines = defines;
+		mEntries.push_back(entry);
+		mWatcher.watch(vertexShader);
+		mWatcher.watch(fragmentShader);
+	}
+
+	void ShaderReloader::remove(ew::Shader* shader) {
+		for (size_t i = 0; i < mEntries.size(); i++)
+		{
+			if (mEntries[i].shader != shader) continue;
+			if (mEntries[i].compiling)
+			{
+				unsigned int program = ew::finishShaderProgram(mEntries[i].pending);
+				if (program != 0) glDeleteProgram(program);
+			}
+			mEntries.erase(mEntries.begin() + i);
+			return;
+		}
+	}
+
+	void ShaderReloader::reloadAll() {
+		for (Entry& entry : mEntries)
+			entry.dirty = true;
+	}
+
+	void ShaderReloader::startCompile(Entry& entry) {
+		std::string defineBlock;
+		for (const std::string& define : entry.defines)
+			defineBlock += "#define " + define + "\n";
+		std::string vertexSource = ew::loadShaderSourceFromFile(entry.vertexShader);
+		std::string fragmentSource = ew::loadShaderSourceFromFile(entry.fragmentShader);
+		entry.pending = ew::beginShaderProgram(vertexSource.c_str(), fragmentSource.c_str(), defineBlock.c_str());
+		entry.compiling = true;
+		entry.dirty = false;
+		entry.issuedFrame = mFrame;
+	}
+
+	void ShaderReloader::update() {
+		mFrame++;
+
+		std::vector<std::string> changed = mWatcher.poll();
+		for (const std::string& path : changed)
+		{
+			std::cout << "Shader source changed: " << path << std::endl;
+			mSourceChanges++;
+			for (Entry& entry : mEntries)
+			{
+				if (entry.vertexShader == path || entry.fragmentShader == path)
+					entry.dirty = true;
+			}
+		}
+
+		bool parallel = ew::hasParallelShaderCompile();
+		bool stalled = false;
+		for (Entry& entry : mEntries)
+		{
+			if (entry.compiling)
+			{
+				if (parallel)
+				{
+					if (!ew::isShaderProgramReady(entry.pending))
+						continue;
+				}
+				else
+				{
+					// no way to ask, so give the driver a frame before finishing and counting the wait as a stall
+					if (entry.issuedFrame == mFrame)
+						continue;
+					if (entry.pending.vertexShader != 0)
+						stalled = true;
+				}
+
+				unsigned int program = ew::finishShaderProgram(entry.pending);
+				entry.compiling = false;
+				if (program == 0)
+				{
+					mFailures++;
+					std::cout << "Reload failed, keeping the previous program for " << entry.fragmentShader << std::endl;
+				}
+				else
+				{
+					entry.shader->setProgram(program);
+					mReloads++;
+				}
+			}
+			// an edit made while compiling starts over once the old compile is finished
+			if (entry.dirty && !entry.compiling)
+				startCompile(entry);
+		}
+		if (stalled)
+			mStalledFrames++;
+	}
+
+	ShaderReloadStats ShaderReloader::getStats() const {
+		ShaderReloadStats stats;
+		stats.reloads = mReloads;
+		stats.failures = mFailures;
+		stats.stalledFrames = mStalledFrames;
+		stats.sourceChanges = mSourceChanges;
+		for (const Entry& entry : mEntries)
+		{
+			if (entry.compiling) stats.pending++;
+		}
+		return stats;
+	}
+}
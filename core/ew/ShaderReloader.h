@@ -0,0 +1,66 @@
+/*
+	ShaderReloader // Brandon Salvietti
+
+	Hot reload for shader sources. Watches the files behind registered shaders, recompiles them
+	without blocking the frame (GL_KHR_parallel_shader_compile when the driver has it) and swaps
+	the new program in once it has linked. A failed compile keeps the old program running.
+*/
+
+#pragma once
+#include "shader.h"
+#include "FileWatcher.h"
+#include <string>
+#include <vector>
+
+namespace vg3o {
+
+	struct ShaderReloadStats {
+		unsigned int reloads = 0;
+		unsigned int failures = 0;
+		unsigned int pending = 0;
+		unsigned int sourceChanges = 0; // times a watched file was seen changing, so others can tell a retry may help
+		// frames where update() had to wait on the driver because completion couldn't be polled
+		unsigned int stalledFrames = 0;
+	};
+
+	class ShaderReloader {
+	public:
+		/// <summary>
+		/// Starts watching the shader's sources. The shader must stay at the same address until removed.
+		/// </summary>
+		void add(ew::Shader* shader, const std::string& vertexShader, const std::string& fragmentShader, const std::vector<std::string>& defines = {});
+		void remove(ew::Shader* shader);
+
+		/// <summary>
+		/// Recompiles every registered shader, as if all their files changed.
+		/// </summary>
+		void reloadAll();
+
+		/// <summary>
+		/// Polls for changed files, starts recompiles and swaps in programs that finished. Call once per frame.
+		/// </summary>
+		void update();
+
+		ShaderReloadStats getStats() const;
+	private:
+		struct Entry {
+			ew::Shader* shader;
+			std::string vertexShader;
+			std::string fragmentShader;
+			std::vector<std::string> defines;
+			bool compiling = false;
+			bool dirty = false; // changed again while compiling
+			ew::PendingProgram pending;
+			unsigned int issuedFrame = 0;
+		};
+		void startCompile(Entry& entry);
+
+		FileWatcher mWatcher;
+		std::vector<Entry> mEntries;
+		unsigned int mFrame = 0;
+		unsigned int mReloads = 0;
+		unsigned int mFailures = 0;
+		unsigned int mSourceChanges = 0;
+		unsigned int mStalledFrames = 0;
+	};
+}
@@ -0,0 +1,180 @@
+#include "ShaderVariants.h"
+
+#include <iostream>
+
+namespace vg3o {
+	ShaderVariants::ShaderVariants(const std::string& vertexShader, const std::string& fragmentShader) {
+		mVertexShader = vertexShader;
+		mFragmentShader = fragmentShader;
+	}
+
+	unsigned int ShaderVariants::addFeature(const std::string& name, unsigned int numValues) {
+		if (numValues < 2) numValues = 2;
+		unsigned int bits = 0;
+		while ((1u << bits) < numValues) bits++;
+		if (mNumBits + bits > 32)
+		{
+			std::cout << "ERROR::SHADERVARIANTS:: Feature " << name << " doesn't fit in the 32 bit key" << std::endl;
+			return INVALID_SHADER_FEATURE;
+		}
+
+		Feature feature;
+		feature.name = name;
+		feature.numValues = numValues;
+		feature.shift = mNumBits;
+		feature.mask = ((1u << bits) - 1) << mNumBits;
+		mFeatures.push_back(feature);
+		mNumBits += bits;
+		return (unsigned int)mFeatures.size() - 1;
+	}
+
+	unsigned int ShaderVariants::setFeature(unsigned int key, unsigned int feature, unsigned int value) const {
+		if (feature >= mFeatures.size()) return key;
+		const Feature& f = mFeatures[feature];
+		if (value >= f.numValues) value = f.numValues - 1;
+		return (key & ~f.mask) | (value << f.shift);
+	}
+
+	unsigned int ShaderVariants::getFeature(unsigned int key, unsigned int feature) const {
+		if (feature >= mFeatures.size()) return 0;
+		const Feature& f = mFeatures[feature];
+		return (key & f.mask) >> f.shift;
+	}
+
+	std::vector<std::string> ShaderVariants::getDefines(unsigned int key) const {
+		// every feature is always defined so shaders can use #if NAME / #if NAME == 2 without #ifdef
+		std::vector<std::string> defines;
+		for (unsigned int i = 0; i < mFeatures.size(); i++)
+		{
+			defines.push_back(mFeatures[i].name + " " + std::to_string(getFeature(key, i)));
+		}
+		return defines;
+	}
+
+	bool ShaderVariants::setFallback(unsigned int key) {
+		mHasFallback = isReady(key) || compile(key);
+		mFallbackKey = key;
+		if (!mHasFallback)
+			std::cout << "ERROR::SHADERVARIANTS:: Fallback " << key << " of " << mFragmentShader << " failed, variants are compiled on demand" << std::endl;
+		return mHasFallback;
+	}
+
+	const ew::Shader& ShaderVariants::get(unsigned int key) {
+		auto it = mVariants.find(key);
+		if (it != mVariants.end())
+			return it->second;
+
+		if (!mHasFallback)
+		{
+			// nothing to fall back on, so this one has to be built now
+			if (mFailed.count(key) == 0 && compile(key))
+				return mVariants.at(key);
+			return mFailedShader;
+		}
+		request(key);
+		mFallbackUses++;
+		return mVariants.at(mFallbackKey);
+	}
+
+	void ShaderVariants::request(unsigned int key) {
+		if (isReady(key) || mQueued.count(key) != 0 || mCompiling.count(key) != 0 || mFailed.count(key) != 0)
+			return;
+		mPending.push_back(key);
+		mQueued.insert(key);
+	}
+
+	void ShaderVariants::update(unsigned int maxCompiles) {
+		// an edit may have fixed what failed, so those get one more try
+		if (mReloader != nullptr && mReloader->getStats().sourceChanges != mSeenSourceChanges)
+		{
+			mSeenSourceChanges = mReloader->getStats().sourceChanges;
+			mFailed.clear();
+		}
+
+		for (auto it = mCompiling.begin(); it != mCompiling.end(); )
+		{
+			if (!ew::isShaderProgramReady(it->second))
+			{
+				++it;
+				continue;
+			}
+			unsigned int program = ew::finishShaderProgram(it->second);
+			if (program != 0)
+				addVariant(it->first, program);
+			else
+				addFailed(it->first);
+			it = mCompiling.erase(it);
+		}
+
+		for (unsigned int i = 0; i < maxCompiles && !mPending.empty(); i++)
+		{
+			unsigned int key = mPending.front();
+			mPending.pop_front();
+			mQueued.erase(key);
+			if (isReady(key))
+				continue;
+
+			std::string defineBlock;
+			for (const std::string& define : getDefines(key))
+				defineBlock += "#define " + define + "\n";
+			std::string vertexSource = ew::loadShaderSourceFromFile(mVertexShader);
+			std::string fragmentSource = ew::loadShaderSourceFromFile(mFragmentShader);
+			mCompiling[key] = ew::beginShaderProgram(vertexSource.c_str(), fragmentSource.c_str(), defineBlock.c_str());
+		}
+	}
+
+	void ShaderVariants::watch(ShaderReloader& reloader) {
+		mReloader = &reloader;
+		for (auto& it : mVariants)
+			reloader.add(&it.second, mVertexShader, mFragmentShader, getDefines(it.first));
+	}
+
+	ShaderVariantStats ShaderVariants::getStats() const {
+		ShaderVariantStats stats;
+		stats.numCompiled = (unsigned int)mVariants.size();
+		stats.numPending = (unsigned int)(mPending.size() + mCompiling.size());
+		stats.fallbackUses = mFallbackUses;
+		stats.numFailed = (unsigned int)mFailed.size();
+		return stats;
+	}
+
+	bool ShaderVariants::compile(unsigned int key) {
+		unsigned int program;
+		auto compiling = mCompiling.find(key);
+		if (compiling != mCompiling.end())
+		{
+			// already in flight, wait for it instead of building it twice
+			program = ew::finishShaderProgram(compiling->second);
+			mCompiling.erase(compiling);
+		}
+		else
+		{
+			std::string defineBlock;
+			for (const std::string& define : getDefines(key))
+				defineBlock += "#define " + define + "\n";
+			std::string vertexSource = ew::loadShaderSourceFromFile(mVertexShader);
+			std::string fragmentSource = ew::loadShaderSourceFromFile(mFragmentShader);
+			program = ew::createShaderProgram(vertexSource.c_str(), fragmentSource.c_str(), defineBlock.c_str());
+		}
+		if (program == 0)
+		{
+			addFailed(key);
+			return false;
+		}
+		addVariant(key, program);
+		return true;
+	}
+
+	void ShaderVariants::addVariant(unsigned int key, unsigned int program) {
+		// unordered_map nodes don't move, so the reloader can hold on to this address
+		ew::Shader& shader = mVariants.emplace(key, ew::Shader(program)).first->second;
+		if (mReloader != nullptr)
+			mReloader->add(&shader, mVertexShader, mFragmentShader, getDefines(key));
+	}
+
+	void ShaderVariants::addFailed(unsigned int key) {
+		// logged once, request() won't queue it again until a source file changes
+		std::cout << "ERROR::SHADERVARIANTS:: Variant " << key << " of " << mFragmentShader << " failed, " << (mHasFallback ? "the fallback stays in use" : "nothing is drawn with it") << std::endl;
+		mFailed.insert(key);
+	}
+}
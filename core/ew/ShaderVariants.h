@@ -0,0 +1,105 @@
+/*
+	ShaderVariants // Brandon Salvietti
+
+	Compile-time permutations of one vertex/fragment pair. Each feature is a #define with a small
+	range of values packed into a bitmask key, so turning a feature off removes its code from the
+	shader instead of branching on a uniform every pixel. Variants compile asynchronously and the
+	fallback variant is handed out until the requested one is ready.
+*/
+
+#pragma once
+#include "shader.h"
+#include "ShaderReloader.h"
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace vg3o {
+
+	// returned by addFeature() when the feature doesn't fit, setFeature()/getFeature() ignore it
+	const unsigned int INVALID_SHADER_FEATURE = 0xFFFFFFFF;
+
+	struct ShaderVariantStats {
+		unsigned int numCompiled = 0;
+		unsigned int numPending = 0; // queued or compiling
+		unsigned int fallbackUses = 0; // get() calls answered with the fallback because the variant wasn't ready
+		unsigned int numFailed = 0; // not retried until the reloader sees a source change
+	};
+
+	class ShaderVariants {
+	public:
+		ShaderVariants(const std::string& vertexShader, const std::string& fragmentShader);
+
+		/// <summary>
+		/// Adds a feature compiled in as "#define name value". Must be called before any variant is requested.
+		/// </summary>
+		/// <param name="numValues">How many values the feature can take, 2 for on/off.</param>
+		/// <returns>Index used with setFeature/getFeature, or INVALID_SHADER_FEATURE if the key has no bits left for it.</returns>
+		unsigned int addFeature(const std::string& name, unsigned int numValues = 2);
+
+		/// <returns>The key with one feature changed, or unchanged if the feature is invalid.</returns>
+		unsigned int setFeature(unsigned int key, unsigned int feature, unsigned int value) const;
+		unsigned int getFeature(unsigned int key, unsigned int feature) const;
+		std::vector<std::string> getDefines(unsigned int key) const;
+
+		/// <summary>
+		/// Compiles a variant right away and uses it whenever a requested one isn't ready or failed to compile.
+		/// </summary>
+		/// <returns>False if it failed to compile, variants are then built on demand as if there was no fallback.</returns>
+		bool setFallback(unsigned int key);
+
+		/// <summary>
+		/// The variant for this key if compiled, otherwise queues it and returns the fallback.
+		/// Without a fallback a failed variant comes back with program 0, which draws nothing.
+		/// </summary>
+		const ew::Shader& get(unsigned int key);
+		bool isReady(unsigned int key) const { return mVariants.count(key) != 0; }
+
+		/// <summary>
+		/// Queues a variant so it is ready before it is first needed.
+		/// </summary>
+		void request(unsigned int key);
+
+		/// <summary>
+		/// Picks up variants that finished compiling and starts queued ones. Call once per frame, outside of any pass.
+		/// </summary>
+		/// <param name="maxCompiles">How many new compiles may be started this call.</param>
+		void update(unsigned int maxCompiles = 1);
+
+		/// <summary>
+		/// Registers every variant, including ones compiled later, for hot reload.
+		/// </summary>
+		void watch(ShaderReloader& reloader);
+
+		ShaderVariantStats getStats() const;
+	private:
+		struct Feature {
+			std::string name;
+			unsigned int numValues;
+			unsigned int shift;
+			unsigned int mask;
+		};
+		bool compile(unsigned int key);
+		void addVariant(unsigned int key, unsigned int program);
+		void addFailed(unsigned int key);
+
+		std::string mVertexShader;
+		std::string mFragmentShader;
+		std::vector<Feature> mFeatures;
+		unsigned int mNumBits = 0;
+
+		std::unordered_map<unsigned int, ew::Shader> mVariants;
+		std::unordered_map<unsigned int, ew::PendingProgram> mCompiling;
+		std::deque<unsigned int> mPending;
+		std::unordered_set<unsigned int> mQueued;
+		std::unordered_set<unsigned int> mFailed; // request() skips these, cleared when a source file changes
+		ew::Shader mFailedShader = ew::Shader(0u); // handed out for failed variants when there is no fallback
+		unsigned int mSeenSourceChanges = 0;
+		unsigned int mFallbackKey = 0;
+		bool mHasFallback = false;
+		unsigned int mFallbackUses = 0;
+		ShaderReloader* mReloader = nullptr;
+	};
+}
@@ -0,0 +1,107 @@
+#include "TemporalUpscaler.h"
+#include "Framebuffer.h"
+#include "GLState.h"
+#include "external/glad.h"
+
+#include <iostream>
+
+namespace vg3o {
+	// radical inverse, index 1 onwards so the first sample isn't the corner
+	static float halton(unsigned int index, unsigned int base) {
+		float result = 0.0f;
+		float fraction = 1.0f / base;
+		while (index > 0)
+		{
+			result += (index % base) * fraction;
+			index /= base;
+			fraction /= base;
+		}
+		return result;
+	}
+
+	TemporalUpscaler::TemporalUpscaler(const TemporalUpscalerSettings& settings) {
+		mSettings = settings;
+	}
+
+	TemporalUpscaler::~TemporalUpscaler() {
+		release();
+	}
+
+	void TemporalUpscaler::release() {
+		for (RenderTarget& target : mTargets)
+		{
+			if (target.framebuffer != 0)
+			{
+				glDeleteFramebuffers(1, &target.framebuffer);
+				GLState::framebufferDeleted(target.framebuffer);
+			}
+			if (target.colorTextures[0] != 0)
+			{
+				glDeleteTextures(1, &target.colorTextures[0]);
+				GLState::textureDeleted(target.colorTextures[0]);
+			}
+			target = RenderTarget();
+		}
+		mHistoryValid = false;
+	}
+
+	void TemporalUpscaler::beginFrame(unsigned int outputWidth, unsigned int outputHeight, unsigned int renderWidth, unsigned int renderHeight) {
+		// last frame's output becomes the history, and the old history is written over
+		mCurrent = 1 - mCurrent;
+
+		// a minimized window reports 0x0, which GL won't allocate
+		outputWidth = outputWidth > 0 ? outputWidth : 1;
+		outputHeight = outputHeight > 0 ? outputHeight : 1;
+		if (outputWidth != mTargets[0].width || outputHeight != mTargets[0].height)
+		{
+			release();
+			for (RenderTarget& target : mTargets)
+			{
+				target.width = outputWidth;
+				target.height = outputHeight;
+				glCreateTextures(GL_TEXTURE_2D, 1, &target.colorTextures[0]);
+				glTextureStorage2D(target.colorTextures[0], 1, mSettings.historyFormat, outputWidth, outputHeight);
+				glTextureParameteri(target.colorTextures[0], GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+				glTextureParameteri(target.colorTextures[0], GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+				glTextureParameteri(target.colorTextures[0], GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+				glTextureParameteri(target.colorTextures[0], GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+				glCreateFramebuffers(1, &target.framebuffer);
+				glNamedFramebufferTexture(target.framebuffer, GL_COLOR_ATTACHMENT0, target.colorTextures[0], 0);
+				if (glCheckNamedFramebufferStatus(target.framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+					std::cout << "ERROR::TEMPORALUPSCALER:: History framebuffer is not complete!" << std::endl;
+			}
+		}
+
+		unsigned int phases = mSettings.jitterPhases > 0 ? mSettings.jitterPhases : 1;
+		mFrame++;
+		unsigned int index = (mFrame % phases) + 1;
+		mJitter = glm::vec2(halton(index, 2) - 0.5f, halton(index, 3) - 0.5f);
+		if (phases == 1)
+			mJitter = glm::vec2(0.0f);
+		// a pixel is 2 / size wide in NDC
+		mJitterNdc = glm::vec2(mJitter.x * 2.0f / (renderWidth > 0 ? renderWidth : 1), mJitter.y * 2.0f / (renderHeight > 0 ? renderHeight : 1));
+	}
+
+	glm::mat4 TemporalUpscaler::jitterProjection(const glm::mat4& projection) const {
+		// clip x and y gain offset * w, which comes out of the perspective divide as a constant offset in NDC
+		glm::mat4 jittered = projection;
+		for (int column = 0; column < 4; column++)
+		{
+			jittered[column][0] += mJitterNdc.x * projection[column][3];
+			jittered[column][1] += mJitterNdc.y * projection[column][3];
+		}
+		return jittered;
+	}
+
+	void TemporalUpscaler::resolve(const ew::Shader& shader, unsigned int color, unsigned int motion, const glm::vec2& renderScale) {
+		shader.use();
+		shader.setVec2("_RenderScale", renderScale);
+		shader.setVec2("_Jitter", mJitter);
+		shader.setFloat("_HistoryWeight", mHistoryValid ? mSettings.historyWeight : 0.0f);
+		GLState::bindTexture(0, color);
+		GLState::bindTexture(1, motion);
+		GLState::bindTexture(2, getHistory().colorTextures[0]);
+		ScreenBuffer::draw();
+		mHistoryValid = true;
+	}
+}
@@ -0,0 +1,82 @@
+/*
+	TemporalUpscaler // Brandon Salvietti
+
+	Rebuilds a full resolution image from scene frames rendered at a lower resolution. Each frame the
+	projection is shifted by a different subpixel offset, and the resolve blends the new samples into
+	last frame's output, fetched through the motion vectors and clamped to the new frame's neighborhood
+	so disoccluded pixels don't ghost. The history lives here, outside the pool, since it has to survive
+	from one frame to the next.
+*/
+
+#pragma once
+#include "RenderTargetPool.h"
+#include "shader.h"
+#include <glm/glm.hpp>
+
+namespace vg3o {
+
+	struct TemporalUpscalerSettings {
+		float historyWeight = 0.9f; // share of the resolved pixel that comes from history, 0 is a plain bilinear upscale
+		unsigned int jitterPhases = 8; // length of the Halton sequence the jitter cycles through
+		unsigned int historyFormat = 0x881A; // GL_RGBA16F
+	};
+
+	class TemporalUpscaler {
+	public:
+		TemporalUpscaler(const TemporalUpscalerSettings& settings = TemporalUpscalerSettings());
+		~TemporalUpscaler();
+		TemporalUpscaler(const TemporalUpscaler&) = delete;
+		TemporalUpscaler& operator=(const TemporalUpscaler&) = delete;
+
+		/// <summary>
+		/// Makes last frame's output the history, advances the jitter and resizes the history to the output size,
+		/// which drops it like reset() does.
+		/// </summary>
+		/// <param name="renderWidth">Pixels actually rendered this frame, the jitter is a fraction of one of these.</param>
+		void beginFrame(unsigned int outputWidth, unsigned int outputHeight, unsigned int renderWidth, unsigned int renderHeight);
+
+		/// <summary>
+		/// Forgets the history, e.g. after a camera cut. The next resolve only uses the current frame.
+		/// </summary>
+		void reset() { mHistoryValid = false; }
+
+		/// <summary>
+		/// This frame's subpixel offset in render pixels, each component in [-0.5, 0.5].
+		/// </summary>
+		glm::vec2 getJitter() const { return mJitter; }
+		/// <summary>
+		/// The projection shifted by the jitter. Motion vectors should be computed without it.
+		/// </summary>
+		glm::mat4 jitterProjection(const glm::mat4& projection) const;
+
+		/// <summary>
+		/// Last frame's output, sampled by resolve(). Import into the graph as a read.
+		/// </summary>
+		const RenderTarget& getHistory() const { return mTargets[1 - mCurrent]; }
+		/// <summary>
+		/// Where resolve() writes. Import into the graph as the upscale pass's write.
+		/// </summary>
+		const RenderTarget& getOutput() const { return mTargets[mCurrent]; }
+
+		/// <summary>
+		/// Draws the full screen resolve into getOutput(), which must be bound.
+		/// </summary>
+		/// <param name="shader">Screen shader with the upscale uniforms, see assets/upscale.frag.</param>
+		/// <param name="color">Scene color, rendered into the bottom left renderScale of the texture.</param>
+		/// <param name="motion">Screen space motion in UV units, current minus previous position.</param>
+		/// <param name="renderScale">Rendered part of the color and motion textures.</param>
+		void resolve(const ew::Shader& shader, unsigned int color, unsigned int motion, const glm::vec2& renderScale);
+
+		TemporalUpscalerSettings& getSettings() { return mSettings; }
+	private:
+		void release();
+
+		TemporalUpscalerSettings mSettings;
+		RenderTarget mTargets[2];
+		unsigned int mCurrent = 0;
+		bool mHistoryValid = false;
+		unsigned int mFrame = 0;
+		glm::vec2 mJitter = glm::vec2(0.0f);
+		glm::vec2 mJitterNdc = glm::vec2(0.0f);
+	};
+}
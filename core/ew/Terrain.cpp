@@ -0,0 +1,316 @@
+#include "Terrain.h"
+#include "external/stb_image.h"
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <stdio.h>
+
+namespace vg3o {
+	/*
+	----
+	Height sources
+	----
+	*/
+
+	static float hashLattice(int x, int z, unsigned int seed) {
+		unsigned int h = (unsigned int)x * 374761393u + (unsigned int)z * 668265263u + seed * 2246822519u;
+		h = (h ^ (h >> 13)) * 1274126177u;
+		h ^= h >> 16;
+		return (h & 0xffffff) / (float)0xffffff * 2.f - 1.f;
+	}
+
+	static float valueNoise(float x, float z, unsigned int seed) {
+		int x0 = (int)std::floor(x), z0 = (int)std::floor(z);
+		float tx = x - x0, tz = z - z0;
+		// smoothstep so the gradient is continuous across cells
+		tx = tx * tx * (3.f - 2.f * tx);
+		tz = tz * tz * (3.f - 2.f * tz);
+		float a = hashLattice(x0, z0, seed), b = hashLattice(x0 + 1, z0, seed);
+		float c = hashLattice(x0, z0 + 1, seed), d = hashLattice(x0 + 1, z0 + 1, seed);
+		float top = a + (b - a) * tx;
+		float bottom = c + (d - c) * tx;
+		return top + (bottom - top) * tz;
+	}
+
+	HeightFunction createNoiseHeight(unsigned int seed, float frequency, int octaves) {
+		return [=](float x, float z) {
+			float sum = 0, amplitude = 1, totalAmplitude = 0, f = frequency;
+			for (int i = 0; i < octaves; i++)
+			{
+				sum += valueNoise(x * f, z * f, seed + i) * amplitude;
+				totalAmplitude += amplitude;
+				amplitude *= 0.5f;
+				f *= 2.f;
+			}
+			return sum / totalAmplitude;
+		};
+	}
+
+	HeightFunction createHeightmapHeight(const char* filePath, float worldSize) {
+		int width, height, numComponents;
+		unsigned char* data = stbi_load(filePath, &width, &height, &numComponents, 1);
+		if (data == NULL) {
+			printf("Failed to load heightmap %s", filePath);
+			return [](float, float) { return 0.f; };
+		}
+		// shared so copies of the function do not copy the image
+		auto pixels = std::make_shared<std::vector<float>>(width * height);
+		for (int i = 0; i < width * height; i++)
+			(*pixels)[i] = data[i] / 255.f;
+		stbi_image_free(data);
+
+		return [=](float x, float z) {
+			float u = std::min(std::max(x / worldSize + 0.5f, 0.f), 1.f) * (width - 1);
+			float v = std::min(std::max(z / worldSize + 0.5f, 0.f), 1.f) * (height - 1);
+			int x0 = (int)u, y0 = (int)v;
+			int x1 = std::min(x0 + 1, width - 1), y1 = std::min(y0 + 1, height - 1);
+			float tx = u - x0, ty = v - y0;
+			const std::vector<float>& p = *pixels;
+			float top = p[y0 * width + x0] + (p[y0 * width + x1] - p[y0 * width + x0]) * tx;
+			float bottom = p[y1 * width + x0] + (p[y1 * width + x1] - p[y1 * width + x0]) * tx;
+			return top + (bottom - top) * ty;
+		};
+	}
+
+	/*
+	----
+	Terrain
+	----
+	*/
+
+	Terrain::Terrain(const TerrainSettings& settings, HeightFunction height, unsigned int numWorkers) {
+		mSettings = settings;
+		mSettings.numLods = std::max(1, std::min(mSettings.numLods, (int)std::log2(std::max(mSettings.chunkResolution, 1)) + 1));
+		mHeight = height;
+		mWorkers.reset(new ThreadPool(numWorkers));
+	}
+
+	Terrain::~Terrain() {
+		mWorkers.reset();
+		for (auto& pair : mChunks)
+			releaseChunk(pair.second);
+	}
+
+	ew::MeshData Terrain::generateChunkMesh(int chunkX, int chunkZ, int lod) const {
+		ew::MeshData mesh;
+		int resolution = std::max(mSettings.chunkResolution >> lod, 1);
+		int columns = resolution + 1;
+		float cellSize = mSettings.chunkSize / resolution;
+		float originX = chunkX * mSettings.chunkSize;
+		float originZ = chunkZ * mSettings.chunkSize;
+		// normals always use the LOD 0 spacing so neighbouring chunks and LODs shade the same along shared edges
+		float e = mSettings.chunkSize / mSettings.chunkResolution;
+
+		int numSkirtVertices = resolution * 4;
+		mesh.vertices.resize(columns * columns + numSkirtVertices);
+		mesh.indices.reserve(resolution * resolution * 6 + numSkirtVertices * 6);
+
+		//VERTICES
+		for (int row = 0; row <= resolution; row++)
+		{
+			for (int col = 0; col <= resolution; col++)
+			{
+				float x = originX + col * cellSize;
+				float z = originZ + row * cellSize;
+				ew::Vertex& v = mesh.vertices[row * columns + col];
+				v.pos = glm::vec3(x, mHeight(x, z) * mSettings.heightScale, z);
+				float dx = (mHeight(x - e, z) - mHeight(x + e, z)) * mSettings.heightScale;
+				float dz = (mHeight(x, z - e) - mHeight(x, z + e)) * mSettings.heightScale;
+				v.normal = glm::normalize(glm::vec3(dx, 2.f * e, dz));
+				v.uv = glm::vec2(x, z) / mSettings.chunkSize;
+			}
+		}
+
+		//INDICES
+		for (int row = 0; row < resolution; row++)
+		{
+			for (int col = 0; col < resolution; col++)
+			{
+				unsigned int start = row * columns + col;
+				mesh.indices.push_back(start);
+				mesh.indices.push_back(start + columns);
+				mesh.indices.push_back(start + 1);
+				mesh.indices.push_back(start + 1);
+				mesh.indices.push_back(start + columns);
+				mesh.indices.push_back(start + columns + 1);
+			}
+		}
+
+		//SKIRTS
+		// walk the border counter clockwise from above, so every segment's outward side is on the same side
+		std::vector<unsigned int> border;
+		border.reserve(numSkirtVertices + 1);
+		for (int col = 0; col < resolution; col++) border.push_back(col); // south, +x
+		for (int row = 0; row < resolution; row++) border.push_back(row * columns + resolution); // east, +z
+		for (int col = resolution; col > 0; col--) border.push_back(resolution * columns + col); // north, -x
+		for (int row = resolution; row > 0; row--) border.push_back(row * columns); // west, -z
+		border.push_back(border[0]);
+
+		unsigned int skirtStart = columns * columns;
+		for (int i = 0; i < numSkirtVertices; i++)
+		{
+			ew::Vertex& v = mesh.vertices[skirtStart + i];
+			v = mesh.vertices[border[i]];
+			v.pos.y -= mSettings.skirtDepth;
+		}
+		for (int i = 0; i < numSkirtVertices; i++)
+		{
+			unsigned int top0 = border[i], top1 = border[i + 1];
+			unsigned int bottom0 = skirtStart + i, bottom1 = skirtStart + (i + 1) % numSkirtVertices;
+			mesh.indices.push_back(top0);
+			mesh.indices.push_back(top1);
+			mesh.indices.push_back(bottom0);
+			mesh.indices.push_back(top1);
+			mesh.indices.push_back(bottom1);
+			mesh.indices.push_back(bottom0);
+		}
+		return mesh;
+	}
+
+	int Terrain::lodForDistance(float distance) const {
+		return std::min((int)(distance / mSettings.lodDistance), mSettings.numLods - 1);
+	}
+
+	void Terrain::releaseChunk(Chunk& chunk) {
+		for (ew::Mesh& mesh : chunk.lods)
+			mesh.release();
+		chunk.lods.clear();
+		mResidentBytes -= chunk.bytes;
+		chunk.bytes = 0;
+	}
+
+	void Terrain::update(const ew::Camera& camera) {
+		// upload whatever the workers finished, a few per frame
+		std::vector<GeneratedChunk> finished;
+		{
+			std::lock_guard<std::mutex> lock(mFinishedMutex);
+			int count = std::min((int)mFinished.size(), mSettings.maxUploadsPerFrame);
+			finished.assign(std::make_move_iterator(mFinished.begin()), std::make_move_iterator(mFinished.begin() + count));
+			mFinished.erase(mFinished.begin(), mFinished.begin() + count);
+		}
+		for (GeneratedChunk& generated : finished)
+		{
+			auto it = mChunks.find(chunkKey(generated.x, generated.z));
+			if (it == mChunks.end() || it->second.ready) continue; // evicted or regenerated while in flight
+
+			Chunk& chunk = it->second;
+			for (ew::MeshData& data : generated.lods)
+			{
+				chunk.bytes += data.vertices.size() * sizeof(ew::Vertex) + data.indices.size() * sizeof(unsigned int);
+				chunk.lods.push_back(ew::Mesh(data, ew::MeshUsage::ARENA));
+			}
+			mResidentBytes += chunk.bytes;
+			chunk.ready = true;
+		}
+
+		// every chunk is the same size, so the budget is a chunk count
+		size_t bytesPerChunk = 0;
+		for (int lod = 0; lod < mSettings.numLods; lod++)
+		{
+			size_t resolution = std::max(mSettings.chunkResolution >> lod, 1);
+			bytesPerChunk += ((resolution + 1) * (resolution + 1) + resolution * 4) * sizeof(ew::Vertex);
+			bytesPerChunk += (resolution * resolution * 6 + resolution * 24) * sizeof(unsigned int);
+		}
+		size_t maxChunks = std::max(mSettings.memoryBudget / bytesPerChunk, (size_t)1);
+
+		int centerX = (int)std::floor(camera.position.x / mSettings.chunkSize);
+		int centerZ = (int)std::floor(camera.position.z / mSettings.chunkSize);
+		struct Candidate { int x, z; float distance; };
+		std::vector<Candidate> candidates;
+		for (int z = centerZ - mSettings.loadRadius; z <= centerZ + mSettings.loadRadius; z++)
+		{
+			for (int x = centerX - mSettings.loadRadius; x <= centerX + mSettings.loadRadius; x++)
+			{
+				float dx = (x + 0.5f) * mSettings.chunkSize - camera.position.x;
+				float dz = (z + 0.5f) * mSettings.chunkSize - camera.position.z;
+				candidates.push_back({ x, z, std::sqrt(dx * dx + dz * dz) });
+			}
+		}
+		std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) { return a.distance < b.distance; });
+		if (candidates.size() > maxChunks)
+			candidates.resize(maxChunks);
+
+		// evict anything that is no longer wanted
+		std::unordered_map<unsigned long long, float> wanted;
+		for (const Candidate& candidate : candidates)
+			wanted[chunkKey(candidate.x, candidate.z)] = candidate.distance;
+		for (auto it = mChunks.begin(); it != mChunks.end();)
+		{
+			if (wanted.count(it->first) == 0)
+			{
+				releaseChunk(it->second);
+				it = mChunks.erase(it);
+				mChunksEvicted++;
+			}
+			else ++it;
+		}
+
+		// queue new chunks nearest first and pick LODs for the rest
+		for (const Candidate& candidate : candidates)
+		{
+			unsigned long long key = chunkKey(candidate.x, candidate.z);
+			auto it = mChunks.find(key);
+			if (it != mChunks.end())
+			{
+				it->second.lod = lodForDistance(candidate.distance);
+				continue;
+			}
+
+			Chunk& chunk = mChunks[key];
+			chunk.x = candidate.x;
+			chunk.z = candidate.z;
+			chunk.lod = lodForDistance(candidate.distance);
+
+			int x = candidate.x, z = candidate.z;
+			mWorkers->submit([this, x, z] {
+				auto start = std::chrono::high_resolution_clock::now();
+				GeneratedChunk generated;
+				generated.x = x;
+				generated.z = z;
+				size_t vertices = 0;
+				for (int lod = 0; lod < mSettings.numLods; lod++)
+				{
+					generated.lods.push_back(generateChunkMesh(x, z, lod));
+					vertices += generated.lods.back().vertices.size();
+				}
+				std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+				std::lock_guard<std::mutex> lock(mFinishedMutex);
+				mFinished.push_back(std::move(generated));
+				mGenerationSeconds += elapsed.count();
+				mVerticesGenerated += vertices;
+				mChunksGenerated++;
+			});
+		}
+	}
+
+	void Terrain::draw() {
+		mBatch.clear();
+		for (auto& pair : mChunks)
+		{
+			if (pair.second.ready)
+				mBatch.add(pair.second.lods[pair.second.lod]);
+		}
+		mBatch.submit();
+	}
+
+	TerrainStats Terrain::getStats() {
+		TerrainStats stats;
+		for (auto& pair : mChunks)
+		{
+			if (pair.second.ready) stats.chunksResident++;
+			else stats.chunksPending++;
+		}
+		stats.chunksEvicted = mChunksEvicted;
+		stats.residentBytes = mResidentBytes;
+
+		std::lock_guard<std::mutex> lock(mFinishedMutex);
+		stats.chunksGenerated = mChunksGenerated;
+		stats.generationSeconds = mGenerationSeconds;
+		stats.verticesGenerated = mVerticesGenerated;
+		return stats;
+	}
+}
@@ -0,0 +1,121 @@
+/*
+	Terrain // Brandon Salvietti
+
+	Heightfield terrain split into square chunks. Chunks are generated on worker threads at every LOD,
+	streamed in and out around the camera, and kept under a memory budget.
+*/
+
+#pragma once
+#include "mesh.h"
+#include "camera.h"
+#include "GeometryArena.h"
+#include "ThreadPool.h"
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace vg3o {
+	/// <summary>
+	/// Height in world units at a world-space xz position. Called from worker threads, so it must not touch shared state.
+	/// </summary>
+	typedef std::function<float(float x, float z)> HeightFunction;
+
+	/// <summary>
+	/// Fractal value noise in roughly [-1, 1].
+	/// </summary>
+	HeightFunction createNoiseHeight(unsigned int seed, float frequency = 0.01f, int octaves = 5);
+
+	/// <summary>
+	/// Samples a grayscale image (bilinear) stretched over a square centered on the origin. Black is 0 and white is 1.
+	/// </summary>
+	/// <param name="worldSize">Width of the square the image covers. Positions outside it clamp to the edge.</param>
+	HeightFunction createHeightmapHeight(const char* filePath, float worldSize);
+
+	struct TerrainSettings {
+		float chunkSize = 32.0f; // world units per chunk side
+		int chunkResolution = 64; // quads per chunk side at LOD 0, halved for every LOD after
+		int numLods = 4;
+		float lodDistance = 64.0f; // each LOD covers this much more distance from the camera
+		int loadRadius = 6; // chunks in each direction around the camera
+		float heightScale = 8.0f;
+		float skirtDepth = 2.0f; // how far skirts hang below the edge to hide cracks between LODs
+		size_t memoryBudget = 64 * 1024 * 1024; // GPU bytes across all LODs of all chunks
+		int maxUploadsPerFrame = 4;
+	};
+
+	struct TerrainStats {
+		unsigned int chunksResident = 0;
+		unsigned int chunksPending = 0;
+		unsigned int chunksGenerated = 0;
+		unsigned int chunksEvicted = 0;
+		size_t residentBytes = 0;
+		double generationSeconds = 0; // summed over all workers
+		unsigned long long verticesGenerated = 0;
+
+		double chunksPerSecond() const { return generationSeconds > 0 ? chunksGenerated / generationSeconds : 0; }
+		double verticesPerSecond() const { return generationSeconds > 0 ? verticesGenerated / generationSeconds : 0; }
+	};
+
+	class Terrain {
+	public:
+		Terrain(const TerrainSettings& settings, HeightFunction height, unsigned int numWorkers = 0);
+		~Terrain();
+
+		/// <summary>
+		/// Queues chunks that came into range, uploads finished ones and evicts chunks that left range or do not fit the budget.
+		/// </summary>
+		void update(const ew::Camera& camera);
+
+		/// <summary>
+		/// Draws every resident chunk at its current LOD in one multi-draw. Vertices are already in world space.
+		/// </summary>
+		void draw();
+
+		/// <summary>
+		/// Builds the mesh for one chunk at one LOD, skirts included. Thread safe.
+		/// </summary>
+		ew::MeshData generateChunkMesh(int chunkX, int chunkZ, int lod) const;
+
+		TerrainStats getStats();
+		const TerrainSettings& getSettings() const { return mSettings; }
+	private:
+		struct Chunk {
+			int x, z;
+			int lod = 0;
+			bool ready = false;
+			std::vector<ew::Mesh> lods;
+			size_t bytes = 0;
+		};
+
+		struct GeneratedChunk {
+			int x, z;
+			std::vector<ew::MeshData> lods;
+		};
+
+		// x in the high half, z in the low half, both as raw 32 bit patterns so negative coordinates shift safely
+		static unsigned long long chunkKey(int x, int z) { return ((unsigned long long)(unsigned int)x << 32) | (unsigned int)z; }
+		void releaseChunk(Chunk& chunk);
+		int lodForDistance(float distance) const;
+
+		TerrainSettings mSettings;
+		HeightFunction mHeight;
+
+		std::unordered_map<unsigned long long, Chunk> mChunks;
+		IndirectBatch mBatch;
+
+		std::mutex mFinishedMutex; // guards everything below that workers write to
+		std::vector<GeneratedChunk> mFinished;
+		double mGenerationSeconds = 0;
+		unsigned long long mVerticesGenerated = 0;
+		unsigned int mChunksGenerated = 0;
+
+		unsigned int mChunksEvicted = 0;
+		size_t mResidentBytes = 0;
+
+		// declared last so workers are joined before anything they write to is destroyed
+		std::unique_ptr<ThreadPool> mWorkers;
+	};
+}
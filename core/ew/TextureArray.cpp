@@ -0,0 +1,181 @@
+#include "TextureArray.h"
+#include "TextureFile.h"
+#include "ThreadPool.h"
+#include "GLState.h"
+#include "texture.h"
+#include "external/glad.h"
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <math.h>
+#include <tuple>
+
+namespace vg3o {
+	namespace {
+		struct PackedImage {
+			bool failed = false;
+			unsigned int compressedFormat = 0; // 0 for RGBA8
+			unsigned int width = 0, height = 0;
+			std::shared_ptr<const DecodedTexture> source; // shared with the registry, never modified
+			std::vector<unsigned char> resized; // only when the source isn't layerSize
+			const std::vector<unsigned char>& getPixels() const { return resized.empty() ? source->pixels : resized; }
+		};
+	}
+
+	// bilinear, good enough for bringing textures of similar size to a common one
+	static void resizeImage(const std::vector<unsigned char>& source, unsigned int width, unsigned int height, unsigned int newWidth, unsigned int newHeight, std::vector<unsigned char>& out) {
+		out.resize((size_t)newWidth * newHeight * 4);
+		for (unsigned int y = 0; y < newHeight; y++)
+		{
+			float sy = ((float)y + 0.5f) * height / newHeight - 0.5f;
+			sy = sy < 0 ? 0 : sy;
+			unsigned int y0 = (unsigned int)sy, y1 = y0 + 1 < height ? y0 + 1 : height - 1;
+			float fy = sy - y0;
+			for (unsigned int x = 0; x < newWidth; x++)
+			{
+				float sx = ((float)x + 0.5f) * width / newWidth - 0.5f;
+				sx = sx < 0 ? 0 : sx;
+				unsigned int x0 = (unsigned int)sx, x1 = x0 + 1 < width ? x0 + 1 : width - 1;
+				float fx = sx - x0;
+				for (int c = 0; c < 4; c++)
+				{
+					float top = source[((size_t)y0 * width + x0) * 4 + c] * (1 - fx) + source[((size_t)y0 * width + x1) * 4 + c] * fx;
+					float bottom = source[((size_t)y1 * width + x0) * 4 + c] * (1 - fx) + source[((size_t)y1 * width + x1) * 4 + c] * fx;
+					out[((size_t)y * newWidth + x) * 4 + c] = (unsigned char)(top * (1 - fy) + bottom * fy + 0.5f);
+				}
+			}
+		}
+	}
+
+	static void decodeTexture(TextureRegistry& registry, const std::string& path, unsigned int layerSize, PackedImage& packed) {
+		packed.source = registry.getDecoded(path);
+		const DecodedTexture& source = *packed.source;
+		packed.failed = source.failed;
+		packed.width = source.width;
+		packed.height = source.height;
+		if (source.failed)
+			return;
+		if (source.compressed)
+		{
+			packed.compressedFormat = getGLFormat(source.compressedImage.format);
+			return;
+		}
+		if (layerSize != 0 && (source.width != layerSize || source.height != layerSize))
+		{
+			resizeImage(source.pixels, source.width, source.height, layerSize, layerSize, packed.resized);
+			packed.width = packed.height = layerSize;
+		}
+	}
+
+	TextureArrayPacker::TextureArrayPacker(TextureRegistry& registry, const TextureArraySettings& settings) : mRegistry(registry) {
+		mSettings = settings;
+		queryTextureFormats(); // workers pick cooked files by format, the lookup needs this thread's context
+	}
+
+	TextureArrayPacker::~TextureArrayPacker() {
+		releaseArrays();
+	}
+
+	int TextureArrayPacker::add(const std::string& path) {
+		mPaths.push_back(path);
+		mSlots.push_back(TextureSlot());
+		return (int)mPaths.size() - 1;
+	}
+
+	void TextureArrayPacker::releaseArrays() {
+		for (unsigned int array : mArrays)
+		{
+			glDeleteTextures(1, &array);
+			GLState::textureDeleted(array);
+		}
+		mArrays.clear();
+	}
+
+	void TextureArrayPacker::build() {
+		auto startTime = std::chrono::high_resolution_clock::now();
+		releaseArrays();
+		mStats = TextureArrayStats();
+		mStats.numTextures = (unsigned int)mPaths.size();
+
+		std::vector<PackedImage> decoded(mPaths.size());
+		{
+			ThreadPool pool(mSettings.numThreads);
+			pool.parallelFor(mPaths.size(), [&](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; i++)
+					decodeTexture(mRegistry, mPaths[i], mSettings.layerSize, decoded[i]);
+			});
+		}
+
+		// format, width, height, levels -> textures that can share an array
+		const TextureSettings& sampling = mSettings.sampling;
+		std::map<std::tuple<unsigned int, unsigned int, unsigned int, unsigned int>, std::vector<int>> groups;
+		for (int i = 0; i < (int)decoded.size(); i++)
+		{
+			PackedImage& texture = decoded[i];
+			mSlots[i] = TextureSlot();
+			if (texture.failed)
+			{
+				std::cout << "ERROR::TEXTUREARRAY:: Failed to load " << mPaths[i] << std::endl;
+				mStats.numFailed++;
+				continue;
+			}
+			unsigned int numLevels = 1;
+			if (texture.compressedFormat != 0)
+				numLevels = sampling.mipmap ? (unsigned int)texture.source->compressedImage.levels.size() : 1;
+			else if (sampling.mipmap)
+				numLevels = (unsigned int)floor(log2(texture.width > texture.height ? texture.width : texture.height)) + 1;
+			groups[std::make_tuple(texture.compressedFormat, texture.width, texture.height, numLevels)].push_back(i);
+		}
+
+		int maxLayers = 0;
+		glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+		if (maxLayers < 1)
+			maxLayers = 256; // the GL 3.0 minimum
+		for (auto& group : groups)
+		{
+			unsigned int compressedFormat, width, height, numLevels;
+			std::tie(compressedFormat, width, height, numLevels) = group.first;
+			const std::vector<int>& members = group.second;
+			for (size_t first = 0; first < members.size(); first += maxLayers)
+			{
+				size_t numLayers = members.size() - first < (size_t)maxLayers ? members.size() - first : (size_t)maxLayers;
+				unsigned int array;
+				glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &array);
+				glTextureStorage3D(array, numLevels, compressedFormat != 0 ? compressedFormat : GL_RGBA8, width, height, (int)numLayers);
+				for (size_t layer = 0; layer < numLayers; layer++)
+				{
+					int index = members[first + layer];
+					PackedImage& texture = decoded[index];
+					if (compressedFormat != 0)
+					{
+						for (unsigned int level = 0; level < numLevels; level++)
+						{
+							const CompressedLevel& data = texture.source->compressedImage.levels[level];
+							glCompressedTextureSubImage3D(array, level, 0, 0, (int)layer, data.width, data.height, 1, compressedFormat, (int)data.size, texture.source->compressedImage.data.data() + data.offset);
+							mStats.gpuBytes += data.size;
+						}
+					}
+					else
+					{
+						glTextureSubImage3D(array, 0, 0, 0, (int)layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, texture.getPixels().data());
+						mStats.gpuBytes += numLevels > 1 ? texture.getPixels().size() * 4 / 3 : texture.getPixels().size();
+					}
+					mSlots[index].texture = array;
+					mSlots[index].layer = (int)layer;
+				}
+				if (compressedFormat == 0 && numLevels > 1)
+					glGenerateTextureMipmap(array);
+				glTextureParameteri(array, GL_TEXTURE_WRAP_S, sampling.wrapMode);
+				glTextureParameteri(array, GL_TEXTURE_WRAP_T, sampling.wrapMode);
+				glTextureParameteri(array, GL_TEXTURE_MIN_FILTER, sampling.minFilter);
+				glTextureParameteri(array, GL_TEXTURE_MAG_FILTER, sampling.magFilter);
+				float borderColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+				glTextureParameterfv(array, GL_TEXTURE_BORDER_COLOR, borderColor);
+				mArrays.push_back(array);
+			}
+		}
+		mStats.numArrays = (unsigned int)mArrays.size();
+		mStats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+	}
+}
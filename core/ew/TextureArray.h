@@ -0,0 +1,72 @@
+/*
+	TextureArray // Brandon Salvietti
+
+	Load-time packer that puts textures of the same format and size into layers of shared
+	GL_TEXTURE_2D_ARRAYs. Materials then differ only by a layer index instead of a texture,
+	so they stop splitting draws by texture binds.
+*/
+
+#pragma once
+#include "TextureRegistry.h"
+#include <string>
+#include <vector>
+
+namespace vg3o {
+
+	struct TextureArraySettings {
+		unsigned int layerSize = 0; // decoded images are resized to this square size so they share an array, 0 keeps them as they are
+		TextureSettings sampling; // applies to every array
+		unsigned int numThreads = 0; // decode threads, 0 for one less than the number of cores
+	};
+
+	/// <summary>
+	/// Where a packed texture ended up. Sample the array with vec3(uv, layer).
+	/// </summary>
+	struct TextureSlot {
+		unsigned int texture = 0; // GL_TEXTURE_2D_ARRAY, 0 if the file failed to load
+		int layer = 0;
+	};
+
+	struct TextureArrayStats {
+		unsigned int numTextures = 0;
+		unsigned int numArrays = 0;
+		unsigned int numFailed = 0;
+		size_t gpuBytes = 0;
+		double milliseconds = 0; // decode and upload of the last build()
+	};
+
+	class TextureArrayPacker {
+	public:
+		/// <param name="registry">Decodes the files, shared with other loaders reading them. Must outlive the packer.</param>
+		TextureArrayPacker(TextureRegistry& registry, const TextureArraySettings& settings = TextureArraySettings());
+		~TextureArrayPacker();
+		TextureArrayPacker(const TextureArrayPacker&) = delete;
+		TextureArrayPacker& operator=(const TextureArrayPacker&) = delete;
+
+		/// <summary>
+		/// Queues a file for the next build(). Cooked .dds siblings are picked up like ew::loadTexture does,
+		/// those keep their size since block compressed data can't be resized here.
+		/// </summary>
+		/// <returns>Index for getSlot().</returns>
+		int add(const std::string& path);
+
+		/// <summary>
+		/// Decodes everything added so far across threads, groups the images by format, size and mip count,
+		/// and uploads one array per group (split if it goes over GL_MAX_ARRAY_TEXTURE_LAYERS). Arrays from a previous build are freed.
+		/// </summary>
+		void build();
+
+		TextureSlot getSlot(int index) const { return mSlots[index]; }
+		const std::vector<unsigned int>& getArrays() const { return mArrays; }
+		TextureArrayStats getStats() const { return mStats; }
+	private:
+		void releaseArrays();
+
+		TextureRegistry& mRegistry;
+		TextureArraySettings mSettings;
+		std::vector<std::string> mPaths;
+		std::vector<TextureSlot> mSlots;
+		std::vector<unsigned int> mArrays;
+		TextureArrayStats mStats;
+	};
+}
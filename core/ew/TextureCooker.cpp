@@ -0,0 +1,403 @@
+#include "TextureCooker.h"
+#include "ThreadPool.h"
+#include "external/stb_image.h"
+
+#include <chrono>
+#include <iostream>
+#include <math.h>
+#include <string.h>
+
+namespace vg3o {
+	/*
+		----
+		Shared helpers
+		----
+	*/
+
+	/// <summary>
+	/// Mean and main direction of 16 points, by power iteration on their covariance.
+	/// </summary>
+	static void principalAxis(const float* points, int channels, float* mean, float* axis) {
+		for (int c = 0; c < channels; c++)
+		{
+			mean[c] = 0;
+			for (int i = 0; i < 16; i++) mean[c] += points[i * channels + c];
+			mean[c] /= 16.0f;
+		}
+		float covariance[4][4] = {};
+		for (int i = 0; i < 16; i++)
+		{
+			for (int a = 0; a < channels; a++)
+			{
+				for (int b = 0; b < channels; b++)
+					covariance[a][b] += (points[i * channels + a] - mean[a]) * (points[i * channels + b] - mean[b]);
+			}
+		}
+		for (int c = 0; c < channels; c++) axis[c] = 1.0f;
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			float next[4] = {};
+			float length = 0;
+			for (int a = 0; a < channels; a++)
+			{
+				for (int b = 0; b < channels; b++) next[a] += covariance[a][b] * axis[b];
+				length += next[a] * next[a];
+			}
+			// flat block, any axis works
+			if (length < 1e-8f) break;
+			length = sqrtf(length);
+			for (int c = 0; c < channels; c++) axis[c] = next[c] / length;
+		}
+	}
+
+	/// <summary>
+	/// Endpoints at the extremes of the points projected on the axis.
+	/// </summary>
+	static void fitEndpoints(const float* points, int channels, float* low, float* high) {
+		float mean[4], axis[4];
+		principalAxis(points, channels, mean, axis);
+		float minProjection = 0, maxProjection = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			float projection = 0;
+			for (int c = 0; c < channels; c++) projection += (points[i * channels + c] - mean[c]) * axis[c];
+			if (projection < minProjection) minProjection = projection;
+			if (projection > maxProjection) maxProjection = projection;
+		}
+		for (int c = 0; c < channels; c++)
+		{
+			low[c] = fminf(fmaxf(mean[c] + axis[c] * minProjection, 0.0f), 255.0f);
+			high[c] = fminf(fmaxf(mean[c] + axis[c] * maxProjection, 0.0f), 255.0f);
+		}
+	}
+
+	static int nearest(const unsigned char* pixel, const int palette[][4], int numColors, int channels) {
+		int best = 0, bestError = 0x7FFFFFFF;
+		for (int i = 0; i < numColors; i++)
+		{
+			int error = 0;
+			for (int c = 0; c < channels; c++)
+			{
+				int d = (int)pixel[c] - palette[i][c];
+				error += d * d;
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				best = i;
+			}
+		}
+		return best;
+	}
+
+	struct BitWriter {
+		unsigned char* out;
+		unsigned int position = 0;
+		void write(unsigned int value, int bits) {
+			for (int b = 0; b < bits; b++, position++)
+			{
+				if ((value >> b) & 1)
+					out[position >> 3] |= (unsigned char)(1 << (position & 7));
+			}
+		}
+	};
+
+	/*
+		----
+		BC1 / BC3
+		----
+	*/
+	static unsigned short to565(const float* color) {
+		unsigned int r = (unsigned int)(color[0] * 31.0f / 255.0f + 0.5f);
+		unsigned int g = (unsigned int)(color[1] * 63.0f / 255.0f + 0.5f);
+		unsigned int b = (unsigned int)(color[2] * 31.0f / 255.0f + 0.5f);
+		return (unsigned short)((r << 11) | (g << 5) | b);
+	}
+
+	static void expand565(unsigned short color, int* out) {
+		int r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+		out[0] = (r << 3) | (r >> 2);
+		out[1] = (g << 2) | (g >> 4);
+		out[2] = (b << 3) | (b >> 2);
+		out[3] = 255;
+	}
+
+	static void encodeColorBlock(const unsigned char pixels[64], unsigned char out[8]) {
+		float points[48];
+		for (int i = 0; i < 16; i++)
+		{
+			for (int c = 0; c < 3; c++) points[i * 3 + c] = pixels[i * 4 + c];
+		}
+		float low[3], high[3];
+		fitEndpoints(points, 3, low, high);
+		unsigned short color0 = to565(high), color1 = to565(low);
+		// color0 > color1 selects the 4 color mode, which is the only mode BC3 has
+		if (color0 < color1)
+		{
+			unsigned short temp = color0;
+			color0 = color1;
+			color1 = temp;
+		}
+
+		int palette[4][4];
+		expand565(color0, palette[0]);
+		expand565(color1, palette[1]);
+		for (int c = 0; c < 3; c++)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+
+		unsigned int indices = 0;
+		if (color0 != color1)
+		{
+			for (int i = 0; i < 16; i++)
+				indices |= (unsigned int)nearest(&pixels[i * 4], palette, 4, 3) << (i * 2);
+		}
+		out[0] = color0 & 0xFF; out[1] = color0 >> 8;
+		out[2] = color1 & 0xFF; out[3] = color1 >> 8;
+		for (int i = 0; i < 4; i++) out[4 + i] = (indices >> (i * 8)) & 0xFF;
+	}
+
+	static void encodeAlphaBlock(const unsigned char pixels[64], unsigned char out[8]) {
+		int alpha0 = 0, alpha1 = 255;
+		for (int i = 0; i < 16; i++)
+		{
+			int a = pixels[i * 4 + 3];
+			if (a > alpha0) alpha0 = a;
+			if (a < alpha1) alpha1 = a;
+		}
+		memset(out, 0, 8);
+		out[0] = (unsigned char)alpha0;
+		out[1] = (unsigned char)alpha1;
+		if (alpha0 == alpha1)
+			return;
+
+		// alpha0 > alpha1 selects 8 interpolated values
+		int palette[8][4] = {};
+		palette[0][0] = alpha0;
+		palette[1][0] = alpha1;
+		for (int i = 1; i < 7; i++)
+			palette[i + 1][0] = ((7 - i) * alpha0 + i * alpha1) / 7;
+
+		BitWriter writer{ out + 2 };
+		for (int i = 0; i < 16; i++)
+		{
+			unsigned char a = pixels[i * 4 + 3];
+			writer.write((unsigned int)nearest(&a, palette, 8, 1), 3);
+		}
+	}
+
+	void encodeBC1Block(const unsigned char pixels[64], unsigned char out[8]) {
+		encodeColorBlock(pixels, out);
+	}
+
+	void encodeBC3Block(const unsigned char pixels[64], unsigned char out[16]) {
+		encodeAlphaBlock(pixels, out);
+		encodeColorBlock(pixels, out + 8);
+	}
+
+	/*
+		----
+		BC7 mode 6
+		----
+	*/
+	static const int BC7_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	/// <summary>
+	/// 7 bits per channel plus a p-bit shared by the 4 channels, picking whichever p-bit lands closer.
+	/// </summary>
+	static void quantizeEndpoint(const float* color, unsigned int* quantized, unsigned int& pBit) {
+		float bestError = 1e30f;
+		for (unsigned int p = 0; p < 2; p++)
+		{
+			unsigned int candidate[4];
+			float error = 0;
+			for (int c = 0; c < 4; c++)
+			{
+				int value = (int)floorf((color[c] - (float)p) / 2.0f + 0.5f);
+				value = value < 0 ? 0 : (value > 127 ? 127 : value);
+				candidate[c] = (unsigned int)value;
+				float d = (float)(value * 2 + (int)p) - color[c];
+				error += d * d;
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				pBit = p;
+				memcpy(quantized, candidate, sizeof(candidate));
+			}
+		}
+	}
+
+	void encodeBC7Block(const unsigned char pixels[64], unsigned char out[16]) {
+		float points[64];
+		for (int i = 0; i < 64; i++) points[i] = pixels[i];
+		float low[4], high[4];
+		fitEndpoints(points, 4, low, high);
+
+		unsigned int endpoint[2][4], pBit[2];
+		quantizeEndpoint(low, endpoint[0], pBit[0]);
+		quantizeEndpoint(high, endpoint[1], pBit[1]);
+
+		int palette[16][4];
+		for (int i = 0; i < 16; i++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				int e0 = (int)(endpoint[0][c] * 2 + pBit[0]);
+				int e1 = (int)(endpoint[1][c] * 2 + pBit[1]);
+				palette[i][c] = ((64 - BC7_WEIGHTS4[i]) * e0 + BC7_WEIGHTS4[i] * e1 + 32) >> 6;
+			}
+		}
+		int indices[16];
+		for (int i = 0; i < 16; i++)
+			indices[i] = nearest(&pixels[i * 4], palette, 16, 4);
+
+		// the first index is stored with 3 bits, so its top bit has to be 0. Swapping the endpoints flips every index
+		if (indices[0] & 8)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				unsigned int temp = endpoint[0][c];
+				endpoint[0][c] = endpoint[1][c];
+				endpoint[1][c] = temp;
+			}
+			unsigned int temp = pBit[0];
+			pBit[0] = pBit[1];
+			pBit[1] = temp;
+			for (int i = 0; i < 16; i++) indices[i] = 15 - indices[i];
+		}
+
+		memset(out, 0, 16);
+		BitWriter writer{ out };
+		writer.write(1 << 6, 7); // mode 6
+		for (int c = 0; c < 4; c++)
+		{
+			writer.write(endpoint[0][c], 7);
+			writer.write(endpoint[1][c], 7);
+		}
+		writer.write(pBit[0], 1);
+		writer.write(pBit[1], 1);
+		writer.write((unsigned int)indices[0], 3);
+		for (int i = 1; i < 16; i++)
+			writer.write((unsigned int)indices[i], 4);
+	}
+
+	/*
+		----
+		Images
+		----
+	*/
+	void compressImage(const unsigned char* rgba, unsigned int width, unsigned int height, TextureFormat format, unsigned char* out, ThreadPool* pool) {
+		unsigned int blocksX = (width + 3) / 4;
+		unsigned int blocksY = (height + 3) / 4;
+		unsigned int blockBytes = getBlockBytes(format);
+
+		auto encodeRows = [&](size_t begin, size_t end) {
+			unsigned char block[64];
+			for (size_t by = begin; by < end; by++)
+			{
+				for (unsigned int bx = 0; bx < blocksX; bx++)
+				{
+					// partial blocks repeat the last row/column
+					for (unsigned int y = 0; y < 4; y++)
+					{
+						unsigned int py = (unsigned int)by * 4 + y;
+						if (py >= height) py = height - 1;
+						for (unsigned int x = 0; x < 4; x++)
+						{
+							unsigned int px = bx * 4 + x;
+							if (px >= width) px = width - 1;
+							memcpy(&block[(y * 4 + x) * 4], &rgba[((size_t)py * width + px) * 4], 4);
+						}
+					}
+					unsigned char* destination = out + ((size_t)by * blocksX + bx) * blockBytes;
+					switch (format) {
+					case TextureFormat::BC1: encodeBC1Block(block, destination); break;
+					case TextureFormat::BC3: encodeBC3Block(block, destination); break;
+					case TextureFormat::BC7: encodeBC7Block(block, destination); break;
+					}
+				}
+			}
+		};
+		if (pool != nullptr)
+			pool->parallelFor(blocksY, encodeRows);
+		else
+			encodeRows(0, blocksY);
+	}
+
+	void downsampleImage(const unsigned char* rgba, unsigned int width, unsigned int height, std::vector<unsigned char>& out) {
+		// 2x2 box filter, odd edges reuse the last texel
+		unsigned int nextWidth = width > 1 ? width / 2 : 1;
+		unsigned int nextHeight = height > 1 ? height / 2 : 1;
+		out.resize((size_t)nextWidth * nextHeight * 4);
+		for (unsigned int y = 0; y < nextHeight; y++)
+		{
+			unsigned int y0 = y * 2, y1 = y * 2 + 1 < height ? y * 2 + 1 : height - 1;
+			for (unsigned int x = 0; x < nextWidth; x++)
+			{
+				unsigned int x0 = x * 2, x1 = x * 2 + 1 < width ? x * 2 + 1 : width - 1;
+				for (int c = 0; c < 4; c++)
+				{
+					unsigned int sum = rgba[((size_t)y0 * width + x0) * 4 + c] + rgba[((size_t)y0 * width + x1) * 4 + c]
+						+ rgba[((size_t)y1 * width + x0) * 4 + c] + rgba[((size_t)y1 * width + x1) * 4 + c];
+					out[((size_t)y * nextWidth + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+				}
+			}
+		}
+	}
+
+	void compressMipChain(const unsigned char* rgba, unsigned int width, unsigned int height, TextureFormat format, bool mipmaps, CompressedImage& image, ThreadPool* pool) {
+		image.format = format;
+		image.levels.clear();
+		image.data.clear();
+
+		std::vector<unsigned char> level(rgba, rgba + (size_t)width * height * 4);
+		std::vector<unsigned char> next;
+		while (true)
+		{
+			CompressedLevel compressed;
+			compressed.width = width;
+			compressed.height = height;
+			compressed.offset = image.data.size();
+			compressed.size = getCompressedSize(format, width, height);
+			image.data.resize(compressed.offset + compressed.size);
+			compressImage(level.data(), width, height, format, image.data.data() + compressed.offset, pool);
+			image.levels.push_back(compressed);
+
+			if (!mipmaps || (width == 1 && height == 1))
+				break;
+
+			downsampleImage(level.data(), width, height, next);
+			level.swap(next);
+			width = width > 1 ? width / 2 : 1;
+			height = height > 1 ? height / 2 : 1;
+		}
+	}
+
+	bool cookTexture(const std::string& inputPath, const std::string& outputPath, const CookSettings& settings) {
+		auto startTime = std::chrono::high_resolution_clock::now();
+		int width, height, numComponents;
+		unsigned char* pixels = stbi_load(inputPath.c_str(), &width, &height, &numComponents, 4);
+		if (pixels == NULL)
+		{
+			std::cout << "ERROR::TEXTURECOOKER:: Failed to load " << inputPath << std::endl;
+			return false;
+		}
+
+		ThreadPool pool(settings.numThreads);
+		CompressedImage image;
+		compressMipChain(pixels, (unsigned int)width, (unsigned int)height, settings.format, settings.mipmaps, image, &pool);
+		stbi_image_free(pixels);
+
+		bool written = writeDDS(outputPath, image);
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+		if (written)
+		{
+			std::cout << "Cooked " << inputPath << " -> " << outputPath << " (" << width << "x" << height << ", "
+				<< image.levels.size() << " levels, " << image.data.size() / 1024 << " KB) in " << milliseconds << "ms" << std::endl;
+		}
+		return written;
+	}
+}
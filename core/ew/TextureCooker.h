@@ -0,0 +1,51 @@
+/*
+	TextureCooker // Brandon Salvietti
+
+	Offline texture compression. Decodes an image once, builds its mip chain and encodes every level
+	to BC1, BC3 or BC7 across worker threads, so the runtime only has to copy blocks to the GPU.
+*/
+
+#pragma once
+#include "TextureFile.h"
+#include <string>
+#include <vector>
+
+namespace vg3o {
+	class ThreadPool;
+
+	struct CookSettings {
+		TextureFormat format = TextureFormat::BC7;
+		bool mipmaps = true;
+		unsigned int numThreads = 0; // 0 uses every core but one
+	};
+
+	/// <summary>
+	/// Encodes one 4x4 block. Pixels are RGBA8, row by row.
+	/// </summary>
+	void encodeBC1Block(const unsigned char pixels[64], unsigned char out[8]);
+	void encodeBC3Block(const unsigned char pixels[64], unsigned char out[16]);
+	/// <summary>
+	/// Mode 6 only: one subset, RGBA endpoints with p-bits and 4 bit indices. Good on smooth and noisy textures, weaker on hard two-color edges.
+	/// </summary>
+	void encodeBC7Block(const unsigned char pixels[64], unsigned char out[16]);
+
+	/// <summary>
+	/// Encodes a whole RGBA8 image into out, which must hold getCompressedSize() bytes. Edges of partial blocks are clamped.
+	/// </summary>
+	void compressImage(const unsigned char* rgba, unsigned int width, unsigned int height, TextureFormat format, unsigned char* out, ThreadPool* pool);
+
+	/// <summary>
+	/// Halves an RGBA8 image with a 2x2 box filter. Odd edges reuse the last texel, 1 pixel sides stay 1.
+	/// </summary>
+	void downsampleImage(const unsigned char* rgba, unsigned int width, unsigned int height, std::vector<unsigned char>& out);
+
+	/// <summary>
+	/// Builds a compressed mip chain from RGBA8 pixels. Each level is a 2x2 box filter of the one above.
+	/// </summary>
+	void compressMipChain(const unsigned char* rgba, unsigned int width, unsigned int height, TextureFormat format, bool mipmaps, CompressedImage& image, ThreadPool* pool);
+
+	/// <summary>
+	/// Loads any format stb_image reads and writes a DDS.
+	/// </summary>
+	bool cookTexture(const std::string& inputPath, const std::string& outputPath, const CookSettings& settings = CookSettings());
+}
@@ -0,0 +1,272 @@
+#include "TextureFile.h"
+#include "external/glad.h"
+
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <string.h>
+
+// S3TC isn't core GL so the bundled glad doesn't define it, values from EXT_texture_compression_s3tc
+#define VG3O_GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define VG3O_GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+
+namespace vg3o {
+	/*
+		----
+		DDS layout
+		----
+	*/
+	const unsigned int DDS_MAGIC = 0x20534444; // "DDS "
+	const unsigned int DDSD_CAPS = 0x1, DDSD_HEIGHT = 0x2, DDSD_WIDTH = 0x4, DDSD_PIXELFORMAT = 0x1000, DDSD_MIPMAPCOUNT = 0x20000, DDSD_LINEARSIZE = 0x80000;
+	const unsigned int DDPF_FOURCC = 0x4;
+	const unsigned int DDSCAPS_COMPLEX = 0x8, DDSCAPS_TEXTURE = 0x1000, DDSCAPS_MIPMAP = 0x400000;
+	const unsigned int DXGI_FORMAT_BC1_UNORM = 71, DXGI_FORMAT_BC3_UNORM = 77, DXGI_FORMAT_BC7_UNORM = 98;
+	const unsigned int D3D10_RESOURCE_DIMENSION_TEXTURE2D = 3;
+
+	static unsigned int makeFourCC(const char* code) {
+		return (unsigned int)code[0] | ((unsigned int)code[1] << 8) | ((unsigned int)code[2] << 16) | ((unsigned int)code[3] << 24);
+	}
+
+	struct DDSPixelFormat {
+		unsigned int size;
+		unsigned int flags;
+		unsigned int fourCC;
+		unsigned int rgbBitCount;
+		unsigned int rBitMask, gBitMask, bBitMask, aBitMask;
+	};
+
+	struct DDSHeader {
+		unsigned int size;
+		unsigned int flags;
+		unsigned int height;
+		unsigned int width;
+		unsigned int pitchOrLinearSize;
+		unsigned int depth;
+		unsigned int mipMapCount;
+		unsigned int reserved1[11];
+		DDSPixelFormat pixelFormat;
+		unsigned int caps, caps2, caps3, caps4;
+		unsigned int reserved2;
+	};
+
+	struct DDSHeaderDX10 {
+		unsigned int dxgiFormat;
+		unsigned int resourceDimension;
+		unsigned int miscFlag;
+		unsigned int arraySize;
+		unsigned int miscFlags2;
+	};
+
+	static_assert(sizeof(DDSHeader) == 124, "DDS header must be 124 bytes");
+
+	/*
+		----
+		Formats
+		----
+	*/
+	unsigned int getBlockBytes(TextureFormat format) {
+		return format == TextureFormat::BC1 ? 8 : 16;
+	}
+
+	size_t getCompressedSize(TextureFormat format, unsigned int width, unsigned int height) {
+		size_t blocksX = (width + 3) / 4;
+		size_t blocksY = (height + 3) / 4;
+		return blocksX * blocksY * getBlockBytes(format);
+	}
+
+	static std::atomic<int> sHasS3TC(-1); // -1 until queried
+
+	void queryTextureFormats() {
+		if (sHasS3TC >= 0)
+			return;
+		int numExtensions = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+		bool found = false;
+		for (int i = 0; i < numExtensions && !found; i++)
+		{
+			const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+			found = extension != nullptr && strcmp(extension, "GL_EXT_texture_compression_s3tc") == 0;
+		}
+		if (!found)
+			std::cout << "TEXTUREFILE:: No EXT_texture_compression_s3tc, BC1/BC3 files are skipped for their source images" << std::endl;
+		sHasS3TC = found ? 1 : 0;
+	}
+
+	bool isTextureFormatSupported(TextureFormat format) {
+		if (format == TextureFormat::BC7)
+			return true;
+		queryTextureFormats();
+		return sHasS3TC == 1;
+	}
+
+	unsigned int getGLFormat(TextureFormat format) {
+		switch (format) {
+		case TextureFormat::BC1: return VG3O_GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		case TextureFormat::BC3: return VG3O_GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		default: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+		}
+	}
+
+	/*
+		----
+		Reading
+		----
+	*/
+	bool readDDSHeader(const std::string& path, CompressedImage& image, size_t& dataOffset) {
+		std::ifstream file(path, std::ios::binary);
+		if (!file.is_open())
+			return false;
+
+		unsigned int magic = 0;
+		DDSHeader header;
+		file.read((char*)&magic, sizeof(magic));
+		file.read((char*)&header, sizeof(header));
+		if (!file || magic != DDS_MAGIC || header.size != sizeof(DDSHeader))
+		{
+			std::cout << "ERROR::TEXTUREFILE:: " << path << " is not a DDS file" << std::endl;
+			return false;
+		}
+		dataOffset = sizeof(magic) + sizeof(header);
+
+		if (!(header.pixelFormat.flags & DDPF_FOURCC))
+		{
+			std::cout << "ERROR::TEXTUREFILE:: " << path << " is not block compressed" << std::endl;
+			return false;
+		}
+		unsigned int fourCC = header.pixelFormat.fourCC;
+		if (fourCC == makeFourCC("DXT1"))
+			image.format = TextureFormat::BC1;
+		else if (fourCC == makeFourCC("DXT5"))
+			image.format = TextureFormat::BC3;
+		else if (fourCC == makeFourCC("DX10"))
+		{
+			DDSHeaderDX10 dx10;
+			file.read((char*)&dx10, sizeof(dx10));
+			dataOffset += sizeof(dx10);
+			if (!file) return false;
+			if (dx10.dxgiFormat == DXGI_FORMAT_BC1_UNORM) image.format = TextureFormat::BC1;
+			else if (dx10.dxgiFormat == DXGI_FORMAT_BC3_UNORM) image.format = TextureFormat::BC3;
+			else if (dx10.dxgiFormat == DXGI_FORMAT_BC7_UNORM) image.format = TextureFormat::BC7;
+			else
+			{
+				std::cout << "ERROR::TEXTUREFILE:: " << path << " uses unsupported DXGI format " << dx10.dxgiFormat << std::endl;
+				return false;
+			}
+		}
+		else
+		{
+			std::cout << "ERROR::TEXTUREFILE:: " << path << " uses an unsupported FourCC" << std::endl;
+			return false;
+		}
+
+		if (header.width == 0 || header.height == 0)
+		{
+			std::cout << "ERROR::TEXTUREFILE:: " << path << " has no pixels" << std::endl;
+			return false;
+		}
+		// never more levels than a full chain down to 1x1, a corrupt count would otherwise allocate for billions
+		unsigned int maxLevels = 1;
+		for (unsigned int size = header.width > header.height ? header.width : header.height; size > 1; size /= 2)
+			maxLevels++;
+		unsigned int numLevels = (header.flags & DDSD_MIPMAPCOUNT) && header.mipMapCount > 0 ? header.mipMapCount : 1;
+		if (numLevels > maxLevels)
+			numLevels = maxLevels;
+		image.levels.clear();
+		size_t offset = 0;
+		unsigned int width = header.width, height = header.height;
+		for (unsigned int i = 0; i < numLevels; i++)
+		{
+			CompressedLevel level;
+			level.width = width;
+			level.height = height;
+			level.offset = offset;
+			level.size = getCompressedSize(image.format, width, height);
+			image.levels.push_back(level);
+			offset += level.size;
+			width = width > 1 ? width / 2 : 1;
+			height = height > 1 ? height / 2 : 1;
+		}
+		return true;
+	}
+
+	bool readDDS(const std::string& path, CompressedImage& image) {
+		size_t dataOffset = 0;
+		if (!readDDSHeader(path, image, dataOffset))
+			return false;
+		const CompressedLevel& last = image.levels.back();
+		size_t dataSize = last.offset + last.size;
+
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		// checked before allocating, the header alone can claim gigabytes
+		std::streamoff fileSize = file.tellg();
+		if (!file || fileSize < 0 || (size_t)fileSize < dataOffset || (size_t)fileSize - dataOffset < dataSize)
+		{
+			std::cout << "ERROR::TEXTUREFILE:: " << path << " is truncated" << std::endl;
+			return false;
+		}
+		file.seekg(dataOffset);
+		image.data.resize(dataSize);
+		file.read((char*)image.data.data(), dataSize);
+		if (!file)
+		{
+			std::cout << "ERROR::TEXTUREFILE:: " << path << " is truncated" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	/*
+		----
+		Writing
+		----
+	*/
+	bool writeDDS(const std::string& path, const CompressedImage& image) {
+		if (image.levels.empty())
+			return false;
+		DDSHeader header;
+		memset(&header, 0, sizeof(header));
+		header.size = sizeof(DDSHeader);
+		header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_LINEARSIZE;
+		header.width = image.getWidth();
+		header.height = image.getHeight();
+		header.pitchOrLinearSize = (unsigned int)image.levels[0].size;
+		header.mipMapCount = (unsigned int)image.levels.size();
+		header.pixelFormat.size = sizeof(DDSPixelFormat);
+		header.pixelFormat.flags = DDPF_FOURCC;
+		header.caps = DDSCAPS_TEXTURE;
+		if (image.levels.size() > 1)
+		{
+			header.flags |= DDSD_MIPMAPCOUNT;
+			header.caps |= DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+		}
+
+		// BC1/BC3 use the old FourCC codes every tool understands, BC7 needs the DX10 extension header
+		DDSHeaderDX10 dx10;
+		memset(&dx10, 0, sizeof(dx10));
+		bool writeDX10 = false;
+		switch (image.format) {
+		case TextureFormat::BC1: header.pixelFormat.fourCC = makeFourCC("DXT1"); break;
+		case TextureFormat::BC3: header.pixelFormat.fourCC = makeFourCC("DXT5"); break;
+		case TextureFormat::BC7:
+			header.pixelFormat.fourCC = makeFourCC("DX10");
+			dx10.dxgiFormat = DXGI_FORMAT_BC7_UNORM;
+			dx10.resourceDimension = D3D10_RESOURCE_DIMENSION_TEXTURE2D;
+			dx10.arraySize = 1;
+			writeDX10 = true;
+			break;
+		}
+
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			std::cout << "ERROR::TEXTUREFILE:: Can't write " << path << std::endl;
+			return false;
+		}
+		file.write((const char*)&DDS_MAGIC, sizeof(DDS_MAGIC));
+		file.write((const char*)&header, sizeof(header));
+		if (writeDX10)
+			file.write((const char*)&dx10, sizeof(dx10));
+		file.write((const char*)image.data.data(), image.data.size());
+		return (bool)file;
+	}
+}
@@ -0,0 +1,65 @@
+/*
+	TextureFile // Brandon Salvietti
+
+	Block compressed images with their whole mip chain, read from and written to DDS.
+	The data is laid out exactly as glCompressedTexImage2D wants it, one level after another.
+*/
+
+#pragma once
+#include <string>
+#include <vector>
+
+namespace vg3o {
+
+	enum class TextureFormat {
+		BC1, // RGB, 4 bits per pixel
+		BC3, // RGBA with separate alpha block, 8 bits per pixel
+		BC7  // RGBA high quality, 8 bits per pixel
+	};
+
+	struct CompressedLevel {
+		unsigned int width = 0;
+		unsigned int height = 0;
+		size_t offset = 0; // into CompressedImage::data
+		size_t size = 0;
+	};
+
+	struct CompressedImage {
+		TextureFormat format = TextureFormat::BC1;
+		std::vector<CompressedLevel> levels; // level 0 is the largest
+		std::vector<unsigned char> data;
+
+		unsigned int getWidth() const { return levels.empty() ? 0 : levels[0].width; }
+		unsigned int getHeight() const { return levels.empty() ? 0 : levels[0].height; }
+	};
+
+	/// <returns>8 for BC1, 16 for the others.</returns>
+	unsigned int getBlockBytes(TextureFormat format);
+	/// <summary>
+	/// Bytes of one level, rounded up to whole 4x4 blocks.
+	/// </summary>
+	size_t getCompressedSize(TextureFormat format, unsigned int width, unsigned int height);
+	/// <summary>
+	/// The GL internal format for glCompressedTexImage2D.
+	/// </summary>
+	unsigned int getGLFormat(TextureFormat format);
+
+	/// <summary>
+	/// BC7 is core GL, BC1/BC3 need EXT_texture_compression_s3tc. The extension is looked up once, which has to
+	/// happen on the GL thread, so the texture loaders call queryTextureFormats() before handing paths to workers.
+	/// </summary>
+	bool isTextureFormatSupported(TextureFormat format);
+	void queryTextureFormats();
+
+	/// <summary>
+	/// Reads BC1/BC3 (DXT1/DXT5 FourCC) and BC1/BC3/BC7 (DX10 header) files. Other formats are rejected.
+	/// </summary>
+	bool readDDS(const std::string& path, CompressedImage& image);
+
+	/// <summary>
+	/// Reads only the header and level table, without the pixel data. Level offsets are relative to dataOffset, the start of the pixel data in the file.
+	/// </summary>
+	bool readDDSHeader(const std::string& path, CompressedImage& image, size_t& dataOffset);
+
+	bool writeDDS(const std::string& path, const CompressedImage& image);
+}
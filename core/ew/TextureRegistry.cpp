@@ -0,0 +1,453 @@
+#include "TextureRegistry.h"
+#include "GLState.h"
+#include "texture.h"
+#include "external/glad.h"
+#include "external/stb_image.h"
+
+#include <filesystem>
+#include <iostream>
+#include <string.h>
+#include <thread>
+
+namespace vg3o {
+	/*
+		----
+		TextureHandle
+		----
+	*/
+	TextureHandle::TextureHandle(TextureRegistry* registry, int entry) {
+		mRegistry = registry;
+		mEntry = entry;
+		mRegistry->addRef(mEntry);
+	}
+
+	TextureHandle::TextureHandle(const TextureHandle& other) {
+		mRegistry = other.mRegistry;
+		mEntry = other.mEntry;
+		if (mRegistry != nullptr)
+			mRegistry->addRef(mEntry);
+	}
+
+	TextureHandle::TextureHandle(TextureHandle&& other) noexcept {
+		mRegistry = other.mRegistry;
+		mEntry = other.mEntry;
+		other.mRegistry = nullptr;
+		other.mEntry = -1;
+	}
+
+	TextureHandle& TextureHandle::operator=(TextureHandle other) {
+		std::swap(mRegistry, other.mRegistry);
+		std::swap(mEntry, other.mEntry);
+		return *this;
+	}
+
+	TextureHandle::~TextureHandle() {
+		if (mRegistry != nullptr)
+			mRegistry->release(mEntry);
+	}
+
+	unsigned int TextureHandle::getId() const {
+		if (mRegistry == nullptr)
+			return 0;
+		const TextureRegistry::Entry& entry = mRegistry->mEntries[mEntry];
+		return entry.state == TextureRegistry::State::READY ? entry.texture : mRegistry->mPlaceholder;
+	}
+
+	bool TextureHandle::isReady() const {
+		return mRegistry != nullptr && mRegistry->mEntries[mEntry].state == TextureRegistry::State::READY;
+	}
+
+	/*
+		----
+		TextureRegistry
+		----
+	*/
+	TextureRegistry::TextureRegistry(unsigned int numWorkers, size_t uploadBudget, size_t decodeCacheBudget) : mWorkers(numWorkers) {
+		mUploadBudget = uploadBudget;
+		mDecodeCacheBudget = decodeCacheBudget;
+		queryTextureFormats(); // workers pick cooked files by format, the lookup needs this thread's context
+
+		// grey/magenta checker, obvious on screen if something never finishes loading
+		const unsigned char checker[16] = { 128, 128, 128, 255, 255, 0, 255, 255, 255, 0, 255, 255, 128, 128, 128, 255 };
+		glCreateTextures(GL_TEXTURE_2D, 1, &mPlaceholder);
+		glTextureStorage2D(mPlaceholder, 1, GL_RGBA8, 2, 2);
+		glTextureSubImage2D(mPlaceholder, 0, 0, 0, 2, 2, GL_RGBA, GL_UNSIGNED_BYTE, checker);
+		glTextureParameteri(mPlaceholder, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTextureParameteri(mPlaceholder, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glCreateBuffers(1, &mUploadBuffer);
+		glNamedBufferStorage(mUploadBuffer, mUploadBudget * UPLOAD_REGIONS, NULL, flags);
+		mUploadMapping = (unsigned char*)glMapNamedBufferRange(mUploadBuffer, 0, mUploadBudget * UPLOAD_REGIONS, flags);
+	}
+
+	TextureRegistry::~TextureRegistry() {
+		// decode jobs hold on to this, let the running ones finish before members go away
+		mShuttingDown = true;
+		mWorkers.wait();
+
+		for (int i = 0; i < UPLOAD_REGIONS; i++)
+		{
+			if (mUploadFences[i] != nullptr)
+				glDeleteSync((GLsync)mUploadFences[i]);
+		}
+		glUnmapNamedBuffer(mUploadBuffer);
+		glDeleteBuffers(1, &mUploadBuffer);
+
+		for (Upload& upload : mUploads)
+		{
+			if (upload.texture != 0) mTexturesToDelete.push_back(upload.texture);
+		}
+		for (Entry& entry : mEntries)
+		{
+			if (entry.texture != 0) mTexturesToDelete.push_back(entry.texture);
+		}
+		mTexturesToDelete.push_back(mPlaceholder);
+		for (unsigned int texture : mTexturesToDelete)
+		{
+			glDeleteTextures(1, &texture);
+			GLState::textureDeleted(texture);
+		}
+	}
+
+	TextureHandle TextureRegistry::load(const std::string& path, const TextureSettings& settings) {
+		std::string key = std::filesystem::path(path).lexically_normal().generic_string();
+		auto it = mEntryByKey.find(key);
+		if (it != mEntryByKey.end())
+		{
+			mStats.dedupHits++;
+			return TextureHandle(this, it->second);
+		}
+
+		int index;
+		if (!mFreeEntries.empty())
+		{
+			index = mFreeEntries.back();
+			mFreeEntries.pop_back();
+		}
+		else
+		{
+			index = (int)mEntries.size();
+			mEntries.push_back(Entry());
+		}
+		Entry& entry = mEntries[index];
+		entry.key = key;
+		entry.settings = settings;
+		entry.texture = 0;
+		entry.refCount = 0;
+		entry.state = State::DECODING;
+		mEntryByKey[key] = index;
+
+		if (!mBatchRunning)
+		{
+			mBatchRunning = true;
+			mBatchStart = std::chrono::high_resolution_clock::now();
+		}
+		mNumDecoding++;
+		unsigned int generation = entry.generation;
+		mWorkers.submit([this, index, generation, path]() { decode(index, generation, path); });
+		return TextureHandle(this, index);
+	}
+
+	void TextureRegistry::addRef(int entry) {
+		mEntries[entry].refCount++;
+	}
+
+	void TextureRegistry::release(int index) {
+		Entry& entry = mEntries[index];
+		if (--entry.refCount > 0)
+			return;
+		// GL calls are left to update(), handles can die anywhere on the GL thread
+		if (entry.texture != 0)
+			mTexturesToDelete.push_back(entry.texture);
+		mEntryByKey.erase(entry.key);
+		entry.key.clear();
+		entry.texture = 0;
+		entry.generation++; // decodes and uploads still in flight for this slot get dropped
+		mFreeEntries.push_back(index);
+	}
+
+	void TextureRegistry::decode(int entry, unsigned int generation, std::string path) {
+		if (mShuttingDown)
+			return;
+		auto startTime = std::chrono::high_resolution_clock::now();
+		std::unique_ptr<DecodedImage> image(new DecodedImage());
+		image->entry = entry;
+		image->generation = generation;
+		image->data = getDecoded(path);
+		image->milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+		if (image->data->failed)
+			std::cout << "ERROR::TEXTUREREGISTRY:: Failed to load " << path << std::endl;
+
+		std::lock_guard<std::mutex> lock(mDecodedMutex);
+		mDecoded.push_back(std::move(image));
+	}
+
+	std::shared_ptr<const DecodedTexture> TextureRegistry::getDecoded(const std::string& path) {
+		std::string resolved = ew::resolveTexturePath(path);
+		std::string key = std::filesystem::path(resolved).lexically_normal().generic_string();
+
+		std::promise<std::shared_ptr<const DecodedTexture>> promise;
+		std::shared_future<std::shared_ptr<const DecodedTexture>> shared;
+		{
+			std::lock_guard<std::mutex> lock(mDecodeCacheMutex);
+			auto it = mDecodeCache.find(key);
+			if (it != mDecodeCache.end())
+			{
+				it->second.lastUsed = ++mDecodeCacheClock;
+				mDecodeShares++;
+				shared = it->second.result;
+			}
+			else
+			{
+				CachedDecode& cached = mDecodeCache[key];
+				cached.result = promise.get_future().share();
+				cached.lastUsed = ++mDecodeCacheClock;
+			}
+		}
+		// waited on outside the lock, the decode may still be running on another thread
+		if (shared.valid())
+			return shared.get();
+
+		std::shared_ptr<DecodedTexture> decoded = std::make_shared<DecodedTexture>();
+		if (ew::isCompressedTexturePath(resolved))
+		{
+			decoded->compressed = true;
+			decoded->failed = !readDDS(resolved, decoded->compressedImage);
+			decoded->width = decoded->compressedImage.getWidth();
+			decoded->height = decoded->compressedImage.getHeight();
+		}
+		else
+		{
+			int width, height, numComponents;
+			unsigned char* data = stbi_load(resolved.c_str(), &width, &height, &numComponents, 4);
+			if (data == NULL)
+				decoded->failed = true;
+			else
+			{
+				decoded->width = (unsigned int)width;
+				decoded->height = (unsigned int)height;
+				decoded->pixels.assign(data, data + (size_t)width * height * 4);
+				stbi_image_free(data);
+			}
+		}
+		promise.set_value(decoded);
+
+		std::lock_guard<std::mutex> lock(mDecodeCacheMutex);
+		auto it = mDecodeCache.find(key);
+		if (decoded->failed)
+		{
+			// not kept, a file that shows up or gets fixed later loads on the next request
+			mDecodeCache.erase(it);
+			return decoded;
+		}
+		it->second.bytes = decoded->pixels.size() + decoded->compressedImage.data.size();
+		mDecodeCacheBytes += it->second.bytes;
+		trimDecodeCache();
+		return decoded;
+	}
+
+	void TextureRegistry::trimDecodeCache() {
+		// anyone still holding an evicted image keeps it alive, it just won't be handed out again
+		while (mDecodeCacheBytes > mDecodeCacheBudget)
+		{
+			auto oldest = mDecodeCache.end();
+			for (auto it = mDecodeCache.begin(); it != mDecodeCache.end(); it++)
+			{
+				// in flight decodes have no size yet and are never evicted
+				if (it->second.bytes > 0 && (oldest == mDecodeCache.end() || it->second.lastUsed < oldest->second.lastUsed))
+					oldest = it;
+			}
+			if (oldest == mDecodeCache.end())
+				return;
+			mDecodeCacheBytes -= oldest->second.bytes;
+			mDecodeCache.erase(oldest);
+		}
+	}
+
+	void TextureRegistry::beginFrame() {
+		mUploadRegion = (mUploadRegion + 1) % UPLOAD_REGIONS;
+		mRegionUsed = 0;
+		GLsync fence = (GLsync)mUploadFences[mUploadRegion];
+		if (fence == nullptr)
+			return;
+		// normally signalled long ago, the region was last written 3 frames back
+		while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {}
+		glDeleteSync(fence);
+		mUploadFences[mUploadRegion] = nullptr;
+	}
+
+	void TextureRegistry::uploadLevel(unsigned int texture, unsigned int level, unsigned int width, unsigned int height, unsigned int compressedFormat, const unsigned char* data, size_t size) {
+		const void* source = data;
+		size_t alignedUsed = (mRegionUsed + 15) & ~(size_t)15;
+		bool staged = alignedUsed + size <= mUploadBudget;
+		if (staged)
+		{
+			size_t offset = mUploadBudget * mUploadRegion + alignedUsed;
+			memcpy(mUploadMapping + offset, data, size);
+			mRegionUsed = alignedUsed + size;
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mUploadBuffer);
+			source = (const void*)offset;
+		}
+		// a level that doesn't fit the staging region is copied straight from memory instead
+		if (compressedFormat != 0)
+			glCompressedTextureSubImage2D(texture, level, 0, 0, width, height, compressedFormat, (int)size, source);
+		else
+			glTextureSubImage2D(texture, level, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, source);
+		if (staged)
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		mStats.bytesUploadedLastUpdate += size;
+	}
+
+	bool TextureRegistry::continueUpload(Upload& upload, size_t& budgetLeft) {
+		const DecodedTexture& image = *upload.image->data;
+		const TextureSettings& settings = mEntries[upload.image->entry].settings;
+		unsigned int compressedFormat = image.compressed ? getGLFormat(image.compressedImage.format) : 0;
+		unsigned int numLevels = 1;
+		if (image.compressed)
+			numLevels = settings.mipmap ? (unsigned int)image.compressedImage.levels.size() : 1;
+		else if (settings.mipmap)
+		{
+			unsigned int size = image.width > image.height ? image.width : image.height;
+			while (size > 1) { size /= 2; numLevels++; }
+		}
+
+		if (upload.texture == 0)
+		{
+			glCreateTextures(GL_TEXTURE_2D, 1, &upload.texture);
+			glTextureStorage2D(upload.texture, numLevels, image.compressed ? compressedFormat : GL_RGBA8, image.width, image.height);
+			glTextureParameteri(upload.texture, GL_TEXTURE_WRAP_S, settings.wrapMode);
+			glTextureParameteri(upload.texture, GL_TEXTURE_WRAP_T, settings.wrapMode);
+			glTextureParameteri(upload.texture, GL_TEXTURE_MIN_FILTER, settings.minFilter);
+			glTextureParameteri(upload.texture, GL_TEXTURE_MAG_FILTER, settings.magFilter);
+			float borderColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+			glTextureParameterfv(upload.texture, GL_TEXTURE_BORDER_COLOR, borderColor);
+		}
+
+		// uncompressed images only carry level 0, the rest is generated on the GPU
+		unsigned int levelsToUpload = image.compressed ? numLevels : 1;
+		while (upload.nextLevel < levelsToUpload)
+		{
+			size_t size;
+			unsigned int width, height;
+			const unsigned char* data;
+			if (image.compressed)
+			{
+				const CompressedLevel& level = image.compressedImage.levels[upload.nextLevel];
+				size = level.size;
+				width = level.width;
+				height = level.height;
+				data = image.compressedImage.data.data() + level.offset;
+			}
+			else
+			{
+				size = image.pixels.size();
+				width = image.width;
+				height = image.height;
+				data = image.pixels.data();
+			}
+			// always make progress on the first upload of a frame, even if it alone is over budget
+			if (size > budgetLeft && budgetLeft < mUploadBudget)
+				return false;
+			uploadLevel(upload.texture, upload.nextLevel, width, height, compressedFormat, data, size);
+			budgetLeft -= size < budgetLeft ? size : budgetLeft;
+			upload.nextLevel++;
+		}
+		if (!image.compressed && numLevels > 1)
+			glGenerateTextureMipmap(upload.texture);
+		return true;
+	}
+
+	void TextureRegistry::update() {
+		beginFrame();
+		mStats.bytesUploadedLastUpdate = 0;
+
+		for (unsigned int texture : mTexturesToDelete)
+		{
+			glDeleteTextures(1, &texture);
+			GLState::textureDeleted(texture);
+		}
+		mTexturesToDelete.clear();
+
+		std::vector<std::unique_ptr<DecodedImage>> decoded;
+		{
+			std::lock_guard<std::mutex> lock(mDecodedMutex);
+			decoded.swap(mDecoded);
+		}
+		for (std::unique_ptr<DecodedImage>& image : decoded)
+		{
+			mNumDecoding--;
+			mStats.decodeMilliseconds += image->milliseconds;
+			Entry& entry = mEntries[image->entry];
+			if (entry.generation != image->generation)
+				continue; // every handle was dropped while it decoded
+			if (image->data->failed)
+			{
+				entry.state = State::FAILED;
+				continue;
+			}
+			entry.state = State::UPLOADING;
+			Upload upload;
+			upload.image = std::move(image);
+			mUploads.push_back(std::move(upload));
+		}
+
+		size_t budgetLeft = mUploadBudget;
+		while (!mUploads.empty() && budgetLeft > 0)
+		{
+			Upload& upload = mUploads.front();
+			Entry& entry = mEntries[upload.image->entry];
+			if (entry.generation != upload.image->generation)
+			{
+				if (upload.texture != 0)
+					glDeleteTextures(1, &upload.texture);
+				mUploads.pop_front();
+				continue;
+			}
+			if (!continueUpload(upload, budgetLeft))
+				break;
+			entry.texture = upload.texture;
+			entry.state = State::READY;
+			mUploads.pop_front();
+		}
+		if (mRegionUsed > 0)
+			mUploadFences[mUploadRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+		if (mBatchRunning && isIdle())
+		{
+			mStats.lastBatchMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - mBatchStart).count();
+			mBatchRunning = false;
+		}
+	}
+
+	void TextureRegistry::finish() {
+		while (!isIdle())
+		{
+			update();
+			if (mUploads.empty() && mNumDecoding > 0)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+
+	bool TextureRegistry::isIdle() {
+		return mNumDecoding == 0 && mUploads.empty();
+	}
+
+	TextureRegistryStats TextureRegistry::getStats() {
+		TextureRegistryStats stats = mStats;
+		stats.numTextures = (unsigned int)(mEntries.size() - mFreeEntries.size());
+		stats.numDecoding = mNumDecoding;
+		stats.numUploading = (unsigned int)mUploads.size();
+		{
+			std::lock_guard<std::mutex> lock(mDecodeCacheMutex);
+			stats.decodeShares = mDecodeShares;
+			stats.decodeCacheBytes = mDecodeCacheBytes;
+		}
+		stats.numFailed = 0;
+		for (const Entry& entry : mEntries)
+		{
+			if (entry.state == State::FAILED && !entry.key.empty()) stats.numFailed++;
+		}
+		return stats;
+	}
+}
@@ -0,0 +1,196 @@
+/*
+	TextureRegistry // Brandon Salvietti
+
+	Loads each texture path once and hands out reference counted handles to it. Files are decoded on
+	worker threads, the GL thread uploads them through a pixel buffer under a per-frame byte budget,
+	and handles return a placeholder texture until their data has arrived.
+
+	Decoding goes through getDecoded(), which other loaders (TextureStreamer, TextureArrayPacker) use
+	too. A file being decoded or decoded recently is shared instead of decoded again, so loaders that
+	read the same images at startup only pay for them once.
+*/
+
+#pragma once
+#include "ThreadPool.h"
+#include "TextureFile.h"
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vg3o {
+	class TextureRegistry;
+
+	struct TextureSettings {
+		int wrapMode = 0x2901; // GL_REPEAT
+		int magFilter = 0x2601; // GL_LINEAR
+		int minFilter = 0x2703; // GL_LINEAR_MIPMAP_LINEAR
+		bool mipmap = true;
+	};
+
+	/// <summary>
+	/// A file as it was read, before any GL work: RGBA8 level 0, or every level of a cooked .dds.
+	/// </summary>
+	struct DecodedTexture {
+		bool failed = false;
+		bool compressed = false;
+		unsigned int width = 0, height = 0;
+		std::vector<unsigned char> pixels;
+		CompressedImage compressedImage;
+	};
+
+	/// <summary>
+	/// Shared reference to a registry texture. The texture is freed when the last handle goes away.
+	/// Handles are only for the GL thread, and the registry has to outlive them.
+	/// </summary>
+	class TextureHandle {
+	public:
+		TextureHandle() {};
+		TextureHandle(const TextureHandle& other);
+		TextureHandle(TextureHandle&& other) noexcept;
+		TextureHandle& operator=(TextureHandle other);
+		~TextureHandle();
+
+		/// <summary>
+		/// The GL texture, or the registry's placeholder while it is still loading (or failed to).
+		/// </summary>
+		unsigned int getId() const;
+		bool isReady() const;
+		bool isValid() const { return mRegistry != nullptr; }
+	private:
+		friend class TextureRegistry;
+		TextureHandle(TextureRegistry* registry, int entry);
+		TextureRegistry* mRegistry = nullptr;
+		int mEntry = -1;
+	};
+
+	struct TextureRegistryStats {
+		unsigned int numTextures = 0; // live entries
+		unsigned int numDecoding = 0;
+		unsigned int numUploading = 0;
+		unsigned int numFailed = 0;
+		unsigned int dedupHits = 0; // load() calls answered by an existing entry
+		size_t bytesUploadedLastUpdate = 0;
+		double decodeMilliseconds = 0; // summed over workers
+		double lastBatchMilliseconds = 0; // from the first request while idle until everything was resident
+		unsigned int decodeShares = 0; // getDecoded() calls answered by a decode already done or in flight
+		size_t decodeCacheBytes = 0; // decoded images kept for later getDecoded() calls
+	};
+
+	class TextureRegistry {
+	public:
+		/// <param name="numWorkers">Decode threads, 0 for one less than the number of cores.</param>
+		/// <param name="uploadBudget">Bytes uploaded per update(). A level bigger than this still goes through, alone.</param>
+		/// <param name="decodeCacheBudget">Bytes of decoded images kept after their last user is done, least recently used go first. 0 only shares decodes in flight.</param>
+		TextureRegistry(unsigned int numWorkers = 0, size_t uploadBudget = 8 << 20, size_t decodeCacheBudget = 64 << 20);
+		~TextureRegistry();
+		TextureRegistry(const TextureRegistry&) = delete;
+		TextureRegistry& operator=(const TextureRegistry&) = delete;
+
+		/// <summary>
+		/// Returns the existing entry for this path, or starts decoding it. Settings only apply to the first load of a path.
+		/// </summary>
+		TextureHandle load(const std::string& path, const TextureSettings& settings = TextureSettings());
+
+		/// <summary>
+		/// Decodes a file on the calling thread, or waits for and shares a decode of the same file that is in flight or cached.
+		/// Safe from any thread, for loaders that do their own uploads. Cooked .dds siblings are picked up like ew::loadTexture does.
+		/// </summary>
+		std::shared_ptr<const DecodedTexture> getDecoded(const std::string& path);
+
+		/// <summary>
+		/// Uploads decoded textures within the byte budget and frees unreferenced ones. Call once per frame on the GL thread.
+		/// </summary>
+		void update();
+
+		/// <summary>
+		/// Runs update() until nothing is decoding or uploading. For loading screens and startup.
+		/// </summary>
+		void finish();
+
+		bool isIdle();
+		unsigned int getPlaceholder() const { return mPlaceholder; }
+		TextureRegistryStats getStats();
+	private:
+		friend class TextureHandle;
+
+		enum class State { DECODING, UPLOADING, READY, FAILED };
+
+		struct Entry {
+			std::string key;
+			TextureSettings settings;
+			unsigned int texture = 0;
+			int refCount = 0;
+			unsigned int generation = 0;
+			State state = State::DECODING;
+		};
+
+		// worker output for an entry
+		struct DecodedImage {
+			int entry;
+			unsigned int generation;
+			std::shared_ptr<const DecodedTexture> data;
+			double milliseconds = 0;
+		};
+
+		struct CachedDecode {
+			std::shared_future<std::shared_ptr<const DecodedTexture>> result;
+			size_t bytes = 0; // 0 while in flight
+			unsigned long long lastUsed = 0;
+		};
+
+		struct Upload {
+			std::unique_ptr<DecodedImage> image;
+			unsigned int texture = 0;
+			unsigned int nextLevel = 0;
+		};
+
+		void addRef(int entry);
+		void release(int entry);
+		void decode(int entry, unsigned int generation, std::string path);
+		// returns false when the budget ran out before the upload finished
+		bool continueUpload(Upload& upload, size_t& budgetLeft);
+		void uploadLevel(unsigned int texture, unsigned int level, unsigned int width, unsigned int height, unsigned int compressedFormat, const unsigned char* data, size_t size);
+		void beginFrame();
+		void trimDecodeCache();
+
+		std::vector<Entry> mEntries;
+		std::vector<int> mFreeEntries;
+		std::unordered_map<std::string, int> mEntryByKey;
+
+		ThreadPool mWorkers;
+		std::mutex mDecodedMutex;
+		std::vector<std::unique_ptr<DecodedImage>> mDecoded;
+		std::deque<Upload> mUploads;
+		std::vector<unsigned int> mTexturesToDelete;
+		unsigned int mNumDecoding = 0;
+		std::atomic<bool> mShuttingDown{ false };
+
+		// ring of PBO regions, each guarded by a fence so a region isn't rewritten while the GPU still reads it
+		static const int UPLOAD_REGIONS = 3;
+		size_t mUploadBudget;
+		unsigned int mUploadBuffer = 0;
+		unsigned char* mUploadMapping = nullptr;
+		void* mUploadFences[UPLOAD_REGIONS] = {};
+		int mUploadRegion = 0;
+		size_t mRegionUsed = 0;
+
+		// by resolved path, guarded by the mutex since loaders call getDecoded() from their own workers
+		std::mutex mDecodeCacheMutex;
+		std::unordered_map<std::string, CachedDecode> mDecodeCache;
+		size_t mDecodeCacheBudget;
+		size_t mDecodeCacheBytes = 0;
+		unsigned long long mDecodeCacheClock = 0;
+		unsigned int mDecodeShares = 0;
+
+		unsigned int mPlaceholder = 0;
+		TextureRegistryStats mStats;
+		bool mBatchRunning = false;
+		std::chrono::high_resolution_clock::time_point mBatchStart;
+	};
+}
@@ -0,0 +1,370 @@
+#include "TextureStreamer.h"
+#include "TextureCooker.h"
+#include "GLState.h"
+#include "texture.h"
+#include "external/glad.h"
+
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <math.h>
+#include <string.h>
+
+namespace vg3o {
+	static const int NO_REQUEST = std::numeric_limits<int>::max();
+
+	static bool readRange(const std::string& file, size_t offset, size_t size, std::vector<unsigned char>& out) {
+		std::ifstream stream(file, std::ios::binary);
+		if (!stream.is_open())
+			return false;
+		stream.seekg(offset);
+		out.resize(size);
+		stream.read((char*)out.data(), size);
+		return (bool)stream;
+	}
+
+	TextureStreamer::TextureStreamer(TextureRegistry& registry, const TextureStreamerSettings& settings, unsigned int numWorkers) : mRegistry(registry) {
+		mSettings = settings;
+		queryTextureFormats(); // workers pick cooked files by format, the lookup needs this thread's context
+		const unsigned char grey[4] = { 128, 128, 128, 255 };
+		glCreateTextures(GL_TEXTURE_2D, 1, &mPlaceholder);
+		glTextureStorage2D(mPlaceholder, 1, GL_RGBA8, 1, 1);
+		glTextureSubImage2D(mPlaceholder, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+		mWorkers.reset(new ThreadPool(numWorkers));
+	}
+
+	TextureStreamer::~TextureStreamer() {
+		for (StreamedTexture& texture : mTextures)
+		{
+			if (texture.texture == 0) continue;
+			glDeleteTextures(1, &texture.texture);
+			GLState::textureDeleted(texture.texture);
+		}
+		glDeleteTextures(1, &mPlaceholder);
+		GLState::textureDeleted(mPlaceholder);
+	}
+
+	int TextureStreamer::add(const std::string& path, const TextureSettings& settings) {
+		int index = (int)mTextures.size();
+		mTextures.push_back(StreamedTexture());
+		StreamedTexture& texture = mTextures.back();
+		texture.path = path;
+		texture.settings = settings;
+		texture.wantedLevel = NO_REQUEST;
+		mNumLoading++;
+		bool mipmap = settings.mipmap;
+		mWorkers->submit([this, index, path, mipmap]() { loadTail(index, path, mipmap); });
+		return index;
+	}
+
+	/*
+		----
+		Worker side
+		----
+	*/
+	void TextureStreamer::loadTail(int texture, std::string path, bool mipmap) {
+		LoadedLevels loaded;
+		loaded.texture = texture;
+		loaded.isTail = true;
+
+		std::string resolved = ew::resolveTexturePath(path);
+		if (ew::isCompressedTexturePath(resolved))
+		{
+			CompressedImage header;
+			loaded.failed = !readDDSHeader(resolved, header, loaded.dataOffset);
+			loaded.levels = header.levels;
+			loaded.compressedFormat = getGLFormat(header.format);
+			loaded.file = resolved;
+		}
+		else
+		{
+			std::shared_ptr<const DecodedTexture> decoded = mRegistry.getDecoded(path);
+			if (decoded->failed)
+				loaded.failed = true;
+			else
+			{
+				// the whole chain stays in system memory, only what is on the GPU is streamed
+				std::shared_ptr<std::vector<unsigned char>> memory(new std::vector<unsigned char>(decoded->pixels));
+				std::vector<unsigned char> level = *memory, next;
+				unsigned int w = decoded->width, h = decoded->height;
+				while (true)
+				{
+					CompressedLevel entry;
+					entry.width = w;
+					entry.height = h;
+					entry.offset = loaded.levels.empty() ? 0 : memory->size();
+					entry.size = (size_t)w * h * 4;
+					if (!loaded.levels.empty())
+						memory->insert(memory->end(), level.begin(), level.end());
+					loaded.levels.push_back(entry);
+					if (!mipmap || (w == 1 && h == 1))
+						break;
+					downsampleImage(level.data(), w, h, next);
+					level.swap(next);
+					w = w > 1 ? w / 2 : 1;
+					h = h > 1 ? h / 2 : 1;
+				}
+				loaded.memory = memory;
+			}
+		}
+
+		if (!loaded.failed)
+		{
+			if (!mipmap)
+				loaded.levels.resize(1);
+			loaded.tailLevel = (int)loaded.levels.size() - 1;
+			for (int i = 0; i < (int)loaded.levels.size(); i++)
+			{
+				const CompressedLevel& level = loaded.levels[i];
+				if (level.width <= mSettings.tailSize && level.height <= mSettings.tailSize)
+				{
+					loaded.tailLevel = i;
+					break;
+				}
+			}
+			loaded.firstLevel = loaded.tailLevel;
+			loaded.numLevels = (int)loaded.levels.size() - loaded.tailLevel;
+			const CompressedLevel& first = loaded.levels[loaded.tailLevel];
+			const CompressedLevel& last = loaded.levels.back();
+			size_t size = last.offset + last.size - first.offset;
+			if (loaded.memory)
+				loaded.data.assign(loaded.memory->begin() + first.offset, loaded.memory->begin() + first.offset + size);
+			else
+				loaded.failed = !readRange(loaded.file, loaded.dataOffset + first.offset, size, loaded.data);
+		}
+		if (loaded.failed)
+			std::cout << "ERROR::TEXTURESTREAMER:: Failed to load " << path << std::endl;
+
+		std::lock_guard<std::mutex> lock(mLoadedMutex);
+		mLoaded.push_back(std::move(loaded));
+	}
+
+	void TextureStreamer::loadLevel(int texture, int level, std::string file, size_t offset, size_t size, std::shared_ptr<const std::vector<unsigned char>> memory) {
+		LoadedLevels loaded;
+		loaded.texture = texture;
+		loaded.firstLevel = level;
+		loaded.numLevels = 1;
+		if (memory)
+			loaded.data.assign(memory->begin() + offset, memory->begin() + offset + size);
+		else
+			loaded.failed = !readRange(file, offset, size, loaded.data);
+
+		std::lock_guard<std::mutex> lock(mLoadedMutex);
+		mLoaded.push_back(std::move(loaded));
+	}
+
+	/*
+		----
+		GL side
+		----
+	*/
+	void TextureStreamer::requestFootprint(int index, const ew::Camera& camera, const glm::vec3& center, float radius, float screenHeight, float uvScale) {
+		StreamedTexture& texture = mTextures[index];
+		if (texture.lastUsedFrame != mFrame)
+		{
+			texture.lastUsedFrame = mFrame;
+			texture.wantedLevel = NO_REQUEST;
+		}
+		if (texture.levels.empty())
+			return;
+
+		// pixels covered by the bounding sphere's diameter
+		float pixels;
+		float distance = glm::length(center - camera.position);
+		if (camera.orthographic)
+			pixels = 2.0f * radius / camera.orthoHeight * screenHeight;
+		else if (distance <= radius)
+			pixels = screenHeight * 1000.0f; // inside it, wants the finest level
+		else
+			pixels = radius * screenHeight / (distance * tanf(glm::radians(camera.fov) * 0.5f));
+
+		const CompressedLevel& top = texture.levels[0];
+		float texels = (float)(top.width > top.height ? top.width : top.height) * uvScale;
+		float ratio = pixels > 0.0f ? texels / pixels : texels;
+		int level = (int)floorf(log2f(ratio > 1.0f ? ratio : 1.0f) + mSettings.lodBias);
+		int maxLevel = (int)texture.levels.size() - 1;
+		level = level < 0 ? 0 : (level > maxLevel ? maxLevel : level);
+		if (level < texture.wantedLevel)
+			texture.wantedLevel = level;
+	}
+
+	void TextureStreamer::reallocate(StreamedTexture& texture, int baseLevel, int firstUploaded, int numUploaded, const unsigned char* data) {
+		int numLevels = (int)texture.levels.size() - baseLevel;
+		const CompressedLevel& base = texture.levels[baseLevel];
+		unsigned int id;
+		glCreateTextures(GL_TEXTURE_2D, 1, &id);
+		glTextureStorage2D(id, numLevels, texture.compressedFormat != 0 ? texture.compressedFormat : GL_RGBA8, base.width, base.height);
+		glTextureParameteri(id, GL_TEXTURE_WRAP_S, texture.settings.wrapMode);
+		glTextureParameteri(id, GL_TEXTURE_WRAP_T, texture.settings.wrapMode);
+		glTextureParameteri(id, GL_TEXTURE_MIN_FILTER, texture.settings.minFilter);
+		glTextureParameteri(id, GL_TEXTURE_MAG_FILTER, texture.settings.magFilter);
+		float borderColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+		glTextureParameterfv(id, GL_TEXTURE_BORDER_COLOR, borderColor);
+
+		// immutable storage can't gain or lose levels, so levels already on the GPU are copied over instead of read again
+		size_t dataStart = numUploaded > 0 ? texture.levels[firstUploaded].offset : 0;
+		size_t residentBytes = 0;
+		for (int i = baseLevel; i < (int)texture.levels.size(); i++)
+		{
+			const CompressedLevel& level = texture.levels[i];
+			if (i >= firstUploaded && i < firstUploaded + numUploaded)
+			{
+				const unsigned char* levelData = data + (level.offset - dataStart);
+				if (texture.compressedFormat != 0)
+					glCompressedTextureSubImage2D(id, i - baseLevel, 0, 0, level.width, level.height, texture.compressedFormat, (int)level.size, levelData);
+				else
+					glTextureSubImage2D(id, i - baseLevel, 0, 0, level.width, level.height, GL_RGBA, GL_UNSIGNED_BYTE, levelData);
+			}
+			else
+			{
+				glCopyImageSubData(texture.texture, GL_TEXTURE_2D, i - texture.baseLevel, 0, 0, 0,
+					id, GL_TEXTURE_2D, i - baseLevel, 0, 0, 0, level.width, level.height, 1);
+			}
+			residentBytes += level.size;
+		}
+
+		if (texture.texture != 0)
+		{
+			glDeleteTextures(1, &texture.texture);
+			GLState::textureDeleted(texture.texture);
+		}
+		mResidentBytes = mResidentBytes - texture.residentBytes + residentBytes;
+		texture.residentBytes = residentBytes;
+		texture.texture = id;
+		texture.baseLevel = baseLevel;
+	}
+
+	bool TextureStreamer::applyLoaded(LoadedLevels& loaded) {
+		StreamedTexture& texture = mTextures[loaded.texture];
+		if (loaded.isTail)
+		{
+			if (loaded.failed)
+			{
+				texture.failed = true;
+				return false;
+			}
+			texture.compressedFormat = loaded.compressedFormat;
+			texture.levels = std::move(loaded.levels);
+			texture.file = std::move(loaded.file);
+			texture.dataOffset = loaded.dataOffset;
+			texture.memory = std::move(loaded.memory);
+			texture.tailLevel = loaded.tailLevel;
+			texture.baseLevel = (int)texture.levels.size();
+		}
+		else
+		{
+			texture.requestPending = false;
+			mPendingBytes -= levelBytes(texture, loaded.firstLevel);
+			// evicted while it was being read, the level above it is gone
+			if (loaded.failed || loaded.firstLevel != texture.baseLevel - 1)
+				return false;
+		}
+		reallocate(texture, loaded.firstLevel, loaded.firstLevel, loaded.numLevels, loaded.data.data());
+		mLevelsLoaded += loaded.numLevels;
+		return true;
+	}
+
+	bool TextureStreamer::makeRoom(size_t bytes, int exclude) {
+		while (mResidentBytes + mPendingBytes + bytes > mSettings.memoryBudget)
+		{
+			// only levels that weren't drawn this frame or are finer than what was asked for
+			int victim = -1;
+			for (int i = 0; i < (int)mTextures.size(); i++)
+			{
+				const StreamedTexture& texture = mTextures[i];
+				if (i == exclude || texture.texture == 0 || texture.baseLevel >= texture.tailLevel)
+					continue;
+				bool needed = texture.lastUsedFrame == mFrame && texture.baseLevel >= texture.wantedLevel;
+				if (needed)
+					continue;
+				if (victim < 0 || texture.lastUsedFrame < mTextures[victim].lastUsedFrame
+					|| (texture.lastUsedFrame == mTextures[victim].lastUsedFrame && texture.baseLevel < mTextures[victim].baseLevel))
+					victim = i;
+			}
+			if (victim < 0)
+				return false;
+			StreamedTexture& texture = mTextures[victim];
+			reallocate(texture, texture.baseLevel + 1, 0, 0, nullptr);
+			mLevelsEvicted++;
+		}
+		return true;
+	}
+
+	void TextureStreamer::update() {
+		{
+			std::lock_guard<std::mutex> lock(mLoadedMutex);
+			for (LoadedLevels& loaded : mLoaded)
+				mReady.push_back(std::move(loaded));
+			mNumLoading -= (unsigned int)mLoaded.size();
+			mLoaded.clear();
+		}
+
+		mBytesStreamedLastUpdate = 0;
+		size_t budgetLeft = mSettings.uploadBudget;
+		while (!mReady.empty())
+		{
+			size_t size = mReady.front().data.size();
+			if (size > budgetLeft && budgetLeft < mSettings.uploadBudget)
+				break;
+			if (applyLoaded(mReady.front()))
+			{
+				mBytesStreamedLastUpdate += size;
+				mBytesStreamedTotal += size;
+			}
+			budgetLeft -= size < budgetLeft ? size : budgetLeft;
+			mReady.pop_front();
+		}
+
+		// one level at a time per texture, so coarse levels of everything arrive before fine levels of anything
+		for (int i = 0; i < (int)mTextures.size(); i++)
+		{
+			StreamedTexture& texture = mTextures[i];
+			if (texture.texture == 0 || texture.requestPending || texture.lastUsedFrame != mFrame || texture.wantedLevel >= texture.baseLevel)
+				continue;
+			int level = texture.baseLevel - 1;
+			size_t bytes = levelBytes(texture, level);
+			if (!makeRoom(bytes, i))
+				continue;
+			texture.requestPending = true;
+			mPendingBytes += bytes;
+			mNumLoading++;
+			size_t offset = texture.memory ? texture.levels[level].offset : texture.dataOffset + texture.levels[level].offset;
+			std::string file = texture.file;
+			std::shared_ptr<const std::vector<unsigned char>> memory = texture.memory;
+			mWorkers->submit([this, i, level, file, offset, bytes, memory]() { loadLevel(i, level, file, offset, bytes, memory); });
+		}
+		mFrame++;
+	}
+
+	unsigned int TextureStreamer::getId(int texture) const {
+		return mTextures[texture].texture != 0 ? mTextures[texture].texture : mPlaceholder;
+	}
+
+	int TextureStreamer::getResidentLevel(int texture) const {
+		return mTextures[texture].texture != 0 ? mTextures[texture].baseLevel : (int)mTextures[texture].levels.size();
+	}
+
+	int TextureStreamer::getWantedLevel(int texture) const {
+		const StreamedTexture& streamed = mTextures[texture];
+		return streamed.wantedLevel == NO_REQUEST ? streamed.tailLevel : streamed.wantedLevel;
+	}
+
+	TextureStreamerStats TextureStreamer::getStats() const {
+		TextureStreamerStats stats;
+		stats.numTextures = (unsigned int)mTextures.size();
+		for (const StreamedTexture& texture : mTextures)
+		{
+			// requests are from the frame before the last update()
+			if (texture.texture != 0 && texture.lastUsedFrame + 1 == mFrame && texture.wantedLevel < texture.baseLevel)
+				stats.numStreaming++;
+		}
+		stats.pendingRequests = mNumLoading + (unsigned int)mReady.size();
+		stats.residentBytes = mResidentBytes;
+		stats.memoryBudget = mSettings.memoryBudget;
+		stats.bytesStreamedLastUpdate = mBytesStreamedLastUpdate;
+		stats.bytesStreamedTotal = mBytesStreamedTotal;
+		stats.levelsLoaded = mLevelsLoaded;
+		stats.levelsEvicted = mLevelsEvicted;
+		return stats;
+	}
+}
@@ -0,0 +1,151 @@
+/*
+	TextureStreamer // Brandon Salvietti
+
+	Streams texture mip levels by how large each texture appears on screen. The small tail of every
+	mip chain is loaded up front, finer levels are read on worker threads one at a time as objects get
+	closer, and the least recently used levels are dropped again when the memory budget runs out.
+	Source images are decoded through a TextureRegistry so other loaders reading them share the work.
+*/
+
+#pragma once
+#include "TextureRegistry.h"
+#include "TextureFile.h"
+#include "ThreadPool.h"
+#include "camera.h"
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace vg3o {
+
+	struct TextureStreamerSettings {
+		size_t memoryBudget = 64 * 1024 * 1024; // GPU bytes across every resident level
+		size_t uploadBudget = 4 * 1024 * 1024; // bytes uploaded per update(), one level always goes through
+		unsigned int tailSize = 64; // levels this size or smaller are loaded with the texture and never evicted
+		float lodBias = 0.0f; // added to the level picked from the footprint, positive is blurrier
+	};
+
+	struct TextureStreamerStats {
+		unsigned int numTextures = 0;
+		unsigned int numStreaming = 0; // textures with fewer levels resident than they want
+		unsigned int pendingRequests = 0; // levels being read or waiting to upload
+		size_t residentBytes = 0;
+		size_t memoryBudget = 0;
+		size_t bytesStreamedLastUpdate = 0;
+		size_t bytesStreamedTotal = 0;
+		unsigned int levelsLoaded = 0;
+		unsigned int levelsEvicted = 0;
+	};
+
+	class TextureStreamer {
+	public:
+		/// <param name="registry">Decodes source images. Must outlive the streamer.</param>
+		TextureStreamer(TextureRegistry& registry, const TextureStreamerSettings& settings = TextureStreamerSettings(), unsigned int numWorkers = 0);
+		~TextureStreamer();
+		TextureStreamer(const TextureStreamer&) = delete;
+		TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+		/// <summary>
+		/// Starts loading the tail of a texture's mip chain. Cooked .dds files are read a level at a time straight from disk,
+		/// anything else is decoded once and its mip chain kept in system memory to stream from.
+		/// </summary>
+		/// <returns>Id for the other calls, stays valid for the streamer's lifetime.</returns>
+		int add(const std::string& path, const TextureSettings& settings = TextureSettings());
+
+		/// <summary>
+		/// Reports where a texture is drawn this frame. The finest level asked for by any call in a frame is the one streamed in.
+		/// </summary>
+		/// <param name="center">World space center of the object's bounding sphere.</param>
+		/// <param name="screenHeight">Height of the render target in pixels.</param>
+		/// <param name="uvScale">How many times the texture repeats across the object's diameter.</param>
+		void requestFootprint(int texture, const ew::Camera& camera, const glm::vec3& center, float radius, float screenHeight, float uvScale = 1.0f);
+
+		/// <summary>
+		/// Uploads levels that finished reading, evicts under memory pressure and queues the next reads. Call once per frame on the GL thread, after the requests.
+		/// </summary>
+		void update();
+
+		/// <summary>
+		/// The GL texture with every resident level. Changes whenever levels come or go, so fetch it each frame.
+		/// A grey placeholder is returned until the tail has loaded.
+		/// </summary>
+		unsigned int getId(int texture) const;
+		/// <summary>
+		/// Finest resident level, or the number of levels while nothing is resident.
+		/// </summary>
+		int getResidentLevel(int texture) const;
+		int getWantedLevel(int texture) const;
+
+		TextureStreamerStats getStats() const;
+		const TextureStreamerSettings& getSettings() const { return mSettings; }
+	private:
+		struct StreamedTexture {
+			std::string path;
+			TextureSettings settings;
+			bool failed = false;
+			unsigned int compressedFormat = 0; // 0 for RGBA8
+			std::vector<CompressedLevel> levels; // sizes and offsets, in the file or in memory
+			std::string file; // set for .dds, levels are read from here
+			size_t dataOffset = 0;
+			std::shared_ptr<const std::vector<unsigned char>> memory; // set for decoded sources
+			int tailLevel = 0;
+
+			unsigned int texture = 0;
+			int baseLevel = 0; // finest resident level, levels.size() when none
+			int wantedLevel = 0;
+			bool requestPending = false;
+			unsigned long long lastUsedFrame = 0;
+			size_t residentBytes = 0;
+		};
+
+		// worker output, either a new texture's level table with its tail or one finer level
+		struct LoadedLevels {
+			int texture = 0;
+			bool failed = false;
+			bool isTail = false;
+			int firstLevel = 0;
+			int numLevels = 0;
+			std::vector<unsigned char> data; // the levels back to back
+			// only for the tail
+			unsigned int compressedFormat = 0;
+			std::vector<CompressedLevel> levels;
+			std::string file;
+			size_t dataOffset = 0;
+			std::shared_ptr<const std::vector<unsigned char>> memory;
+			int tailLevel = 0;
+		};
+
+		void loadTail(int texture, std::string path, bool mipmap);
+		void loadLevel(int texture, int level, std::string file, size_t offset, size_t size, std::shared_ptr<const std::vector<unsigned char>> memory);
+		bool applyLoaded(LoadedLevels& loaded);
+		// rebuilds the texture with levels [baseLevel, end), uploading [firstUploaded, firstUploaded + numUploaded) from data and copying the rest from the old texture
+		void reallocate(StreamedTexture& texture, int baseLevel, int firstUploaded, int numUploaded, const unsigned char* data);
+		// evicts least recently used levels until bytes fit the budget, never from exclude
+		bool makeRoom(size_t bytes, int exclude);
+		size_t levelBytes(const StreamedTexture& texture, int level) const { return texture.levels[level].size; }
+
+		TextureRegistry& mRegistry;
+		TextureStreamerSettings mSettings;
+		std::vector<StreamedTexture> mTextures;
+		unsigned long long mFrame = 1;
+		unsigned int mPlaceholder = 0;
+
+		std::mutex mLoadedMutex;
+		std::vector<LoadedLevels> mLoaded;
+		std::deque<LoadedLevels> mReady; // read, waiting for upload budget
+		unsigned int mNumLoading = 0;
+		size_t mPendingBytes = 0; // reserved in the budget for levels in flight
+
+		size_t mResidentBytes = 0;
+		size_t mBytesStreamedLastUpdate = 0;
+		size_t mBytesStreamedTotal = 0;
+		unsigned int mLevelsLoaded = 0;
+		unsigned int mLevelsEvicted = 0;
+
+		// declared last so workers are joined before anything they write to is destroyed
+		std::unique_ptr<ThreadPool> mWorkers;
+	};
+}
@@ -0,0 +1,98 @@
+#include "ThreadPool.h"
+#include "Trace.h"
+
+#include <algorithm>
+
+namespace vg3o {
+	ThreadPool::ThreadPool(unsigned int numThreads) {
+		if (numThreads == 0)
+		{
+			unsigned int hardwareThreads = std::thread::hardware_concurrency();
+			numThreads = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+		}
+		for (unsigned int i = 0; i < numThreads; i++)
+			mWorkers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+
+	ThreadPool::~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mStopping = true;
+			mJobs.clear();
+		}
+		mJobAvailable.notify_all();
+		for (std::thread& worker : mWorkers)
+			worker.join();
+	}
+
+	void ThreadPool::submit(std::function<void()> job) {
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mJobs.push_back(std::move(job));
+		}
+		mJobAvailable.notify_one();
+	}
+
+	void ThreadPool::parallelFor(size_t count, const std::function<void(size_t begin, size_t end)>& fn) {
+		if (count == 0) return;
+		size_t numRanges = std::min(count, (size_t)mWorkers.size() + 1);
+		size_t rangeSize = (count + numRanges - 1) / numRanges;
+
+		std::mutex doneMutex;
+		std::condition_variable doneCondition;
+		size_t remaining = numRanges - 1;
+		for (size_t i = 1; i < numRanges; i++)
+		{
+			size_t begin = i * rangeSize;
+			size_t end = std::min(begin + rangeSize, count);
+			submit([&, begin, end] {
+				if (begin < end) fn(begin, end);
+				std::lock_guard<std::mutex> lock(doneMutex);
+				if (--remaining == 0) doneCondition.notify_one();
+			});
+		}
+
+		fn(0, std::min(rangeSize, count));
+
+		std::unique_lock<std::mutex> lock(doneMutex);
+		doneCondition.wait(lock, [&] { return remaining == 0; });
+	}
+
+	void ThreadPool::wait() {
+		std::unique_lock<std::mutex> lock(mMutex);
+		mIdle.wait(lock, [this] { return mJobs.empty() && mNumBusy == 0; });
+	}
+
+	size_t ThreadPool::getNumQueued() {
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mJobs.size();
+	}
+
+	void ThreadPool::workerLoop() {
+		Trace::setThreadName("Worker");
+		while (true)
+		{
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(mMutex);
+				mJobAvailable.wait(lock, [this] { return mStopping || !mJobs.empty(); });
+				if (mStopping) return;
+				job = std::move(mJobs.front());
+				mJobs.pop_front();
+				mNumBusy++;
+			}
+
+			{
+				VG3O_TRACE_SCOPE("ThreadPool job");
+				job();
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mNumBusy--;
+				if (mJobs.empty() && mNumBusy == 0)
+					mIdle.notify_all();
+			}
+		}
+	}
+}
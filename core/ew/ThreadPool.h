@@ -0,0 +1,56 @@
+/*
+	ThreadPool // Brandon Salvietti
+
+	Fixed set of worker threads pulling jobs off a shared queue.
+*/
+
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vg3o {
+
+	class ThreadPool {
+	public:
+		/// <summary>
+		/// Starts the workers.
+		/// </summary>
+		/// <param name="numThreads">0 picks one less than the number of hardware threads, leaving one for the render thread.</param>
+		ThreadPool(unsigned int numThreads = 0);
+
+		/// <summary>
+		/// Jobs that have not started yet are dropped, running jobs are finished.
+		/// </summary>
+		~ThreadPool();
+
+		void submit(std::function<void()> job);
+
+		/// <summary>
+		/// Splits [0, count) into one range per worker plus one for the calling thread, and blocks until all are done.
+		/// Do not call from inside a job, the caller waits on the same workers it would be occupying.
+		/// </summary>
+		void parallelFor(size_t count, const std::function<void(size_t begin, size_t end)>& fn);
+
+		/// <summary>
+		/// Blocks until the queue is empty and every worker is idle.
+		/// </summary>
+		void wait();
+
+		unsigned int getNumThreads() const { return (unsigned int)mWorkers.size(); }
+		size_t getNumQueued();
+	private:
+		void workerLoop();
+
+		std::vector<std::thread> mWorkers;
+		std::deque<std::function<void()>> mJobs;
+		std::mutex mMutex;
+		std::condition_variable mJobAvailable;
+		std::condition_variable mIdle;
+		unsigned int mNumBusy = 0;
+		bool mStopping = false;
+	};
+}
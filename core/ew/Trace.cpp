@@ -0,0 +1,230 @@
+#include "Trace.h"
+#include "BenchmarkReport.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdio.h>
+#include <unordered_set>
+#include <vector>
+
+namespace vg3o {
+	struct TraceEvent {
+		const char* name;
+		uint64_t begin;
+		uint64_t end;
+	};
+
+	// written only by its own thread, read by whichever thread ends the capture
+	struct ThreadRing {
+		std::vector<TraceEvent> events;
+		std::atomic<uint64_t> head{ 0 }; // events ever written, the next one goes to head % size
+		uint64_t captureHead = 0; // head when the current capture began, guarded by s_mutex
+		unsigned int id = 0;
+		std::string name;
+	};
+
+	std::atomic<bool> Trace::sRecording{ false };
+
+	static std::mutex s_mutex; // registration, interning and capture state, never taken while recording a scope
+	static std::vector<std::unique_ptr<ThreadRing>> s_rings; // kept after their thread exits so its events still make the file
+	static thread_local ThreadRing* t_ring = nullptr;
+	static thread_local std::string t_name; // set before the ring exists, rings are only made once a thread records
+	static size_t s_ringSize = 16 * 1024;
+	static std::unordered_set<std::string> s_interned;
+
+	static uint64_t s_captureBegin = 0;
+	static unsigned int s_framesLeft = 0;
+	static std::string s_capturePath;
+	static std::string s_lastFile;
+	static unsigned long long s_eventsDropped = 0;
+	static thread_local uint64_t t_lastFrame = 0;
+
+	static ThreadRing* getRing() {
+		if (t_ring != nullptr)
+			return t_ring;
+		std::lock_guard<std::mutex> lock(s_mutex);
+		std::unique_ptr<ThreadRing> ring(new ThreadRing());
+		ring->events.resize(s_ringSize > 0 ? s_ringSize : 1);
+		ring->id = (unsigned int)s_rings.size() + 1;
+		char name[32];
+		snprintf(name, sizeof(name), "Thread %u", ring->id);
+		ring->name = t_name.empty() ? name : t_name;
+		t_ring = ring.get();
+		s_rings.push_back(std::move(ring));
+		return t_ring;
+	}
+
+	uint64_t Trace::now() {
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void Trace::record(const char* name, uint64_t begin, uint64_t end) {
+		ThreadRing* ring = getRing();
+		uint64_t head = ring->head.load(std::memory_order_relaxed);
+		ring->events[head % ring->events.size()] = { name, begin, end };
+		// release so a reader that sees the new head also sees the event
+		ring->head.store(head + 1, std::memory_order_release);
+	}
+
+	void Trace::setRingSize(size_t events) {
+		std::lock_guard<std::mutex> lock(s_mutex);
+		s_ringSize = events;
+	}
+
+	void Trace::setThreadName(const std::string& name) {
+		t_name = name;
+		if (t_ring == nullptr) return;
+		std::lock_guard<std::mutex> lock(s_mutex);
+		t_ring->name = name;
+	}
+
+	const char* Trace::intern(const std::string& name) {
+		std::lock_guard<std::mutex> lock(s_mutex);
+		// nodes of an unordered_set never move, so the pointer stays valid through rehashes
+		return s_interned.insert(name).first->c_str();
+	}
+
+	/*
+		----
+		Capturing
+		----
+	*/
+	void Trace::beginCapture(unsigned int numFrames, const std::string& path) {
+		std::lock_guard<std::mutex> lock(s_mutex);
+		for (std::unique_ptr<ThreadRing>& ring : s_rings)
+			ring->captureHead = ring->head.load(std::memory_order_acquire);
+		s_captureBegin = now();
+		s_framesLeft = numFrames;
+		s_capturePath = path;
+		s_eventsDropped = 0;
+		sRecording.store(true, std::memory_order_relaxed);
+	}
+
+	bool Trace::endCapture() {
+		if (!sRecording.exchange(false))
+			return false;
+		uint64_t captureEnd = now();
+
+		std::lock_guard<std::mutex> lock(s_mutex);
+		s_lastFile.clear();
+		struct ThreadEvents {
+			unsigned int id;
+			std::string name;
+			std::vector<TraceEvent> events;
+		};
+		std::vector<ThreadEvents> threads;
+		for (std::unique_ptr<ThreadRing>& ring : s_rings)
+		{
+			// scopes that began before the capture stopped can still be finishing, anything that
+			// the owner overwrote while it was being copied is thrown away below
+			uint64_t size = ring->events.size();
+			uint64_t head = ring->head.load(std::memory_order_acquire);
+			uint64_t first = std::max(ring->captureHead, head > size ? head - size : 0);
+			s_eventsDropped += first - ring->captureHead;
+
+			ThreadEvents thread;
+			thread.id = ring->id;
+			thread.name = ring->name;
+			for (uint64_t i = first; i < head; i++)
+				thread.events.push_back(ring->events[i % size]);
+			uint64_t newHead = ring->head.load(std::memory_order_acquire);
+			uint64_t overwritten = newHead > size ? newHead - size : 0;
+			if (overwritten > first)
+			{
+				size_t numLost = (size_t)std::min<uint64_t>(overwritten - first, thread.events.size());
+				thread.events.erase(thread.events.begin(), thread.events.begin() + numLost);
+				s_eventsDropped += numLost;
+			}
+			if (!thread.events.empty())
+				threads.push_back(std::move(thread));
+		}
+
+		std::ofstream file(s_capturePath, std::ios::trunc);
+		if (!file.is_open())
+		{
+			std::cout << "ERROR::TRACE:: Could not write " << s_capturePath << std::endl;
+			return false;
+		}
+		// complete ("X") events, one track per thread, microseconds since the capture began
+		file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"CPU\"}}";
+		char line[128];
+		for (const ThreadEvents& thread : threads)
+		{
+			file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.id << ",\"args\":{\"name\":\"" << escapeJson(thread.name) << "\"}}";
+			for (const TraceEvent& event : thread.events)
+			{
+				if (event.begin < s_captureBegin || event.end > captureEnd) continue;
+				file << ",\n{\"name\":\"" << escapeJson(event.name) << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1";
+				snprintf(line, sizeof(line), ",\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", thread.id,
+					(event.begin - s_captureBegin) / 1000.0, (event.end - event.begin) / 1000.0);
+				file << line;
+			}
+		}
+		file << "\n]}\n";
+		if (!file.good())
+			return false;
+		s_lastFile = s_capturePath;
+		return true;
+	}
+
+	void Trace::frame() {
+		uint64_t time = now();
+		if (isRecording() && t_lastFrame != 0)
+			record("Frame", t_lastFrame, time);
+		t_lastFrame = time;
+
+		bool finished = false;
+		{
+			std::lock_guard<std::mutex> lock(s_mutex);
+			if (isRecording() && s_framesLeft > 0)
+				finished = --s_framesLeft == 0;
+		}
+		if (finished)
+			endCapture();
+	}
+
+	TraceOverhead Trace::measureOverhead(unsigned int iterations) {
+		TraceOverhead overhead;
+		if (isRecording() || iterations == 0)
+			return overhead;
+		uint64_t start = now();
+		for (unsigned int i = 0; i < iterations; i++)
+		{
+			TraceScope scope("Trace overhead");
+		}
+		overhead.idleNanoseconds = (double)(now() - start) / iterations;
+
+		// the recording path is forced on this thread only, flipping sRecording would make every worker record
+		// too. Each iteration still pays the flag check a real scope does, and stops if a capture begins
+		unsigned int recorded = 0;
+		start = now();
+		for (; recorded < iterations && !isRecording(); recorded++)
+		{
+			TraceScope scope("Trace overhead", TraceScope::Forced());
+		}
+		if (recorded == iterations)
+			overhead.recordingNanoseconds = (double)(now() - start) / iterations;
+		return overhead;
+	}
+
+	TraceStats Trace::getStats() {
+		std::lock_guard<std::mutex> lock(s_mutex);
+		TraceStats stats;
+		stats.capturing = isRecording();
+		stats.framesLeft = s_framesLeft;
+		for (std::unique_ptr<ThreadRing>& ring : s_rings)
+		{
+			uint64_t head = ring->head.load(std::memory_order_relaxed);
+			stats.eventsRecorded += head;
+			if (head > 0) stats.numThreads++;
+		}
+		stats.eventsDropped = s_eventsDropped;
+		stats.lastFile = s_lastFile;
+		return stats;
+	}
+}
@@ -0,0 +1,131 @@
+/*
+	Trace // Brandon Salvietti
+
+	CPU scope tracing for the hot paths. Every thread writes the scopes it finishes into its own
+	ring buffer, so recording never takes a lock or touches another thread's memory. Nothing is
+	recorded until a capture is started, and then the rings are gathered into a Chrome/Perfetto
+	trace file once it ends.
+
+	VG3O_TRACE_SCOPE("Name") times the rest of the enclosing block. Names must outlive the capture,
+	string literals or Trace::intern(). Compiling with VG3O_TRACE=0 removes the scopes entirely,
+	otherwise an idle scope costs one relaxed atomic load.
+*/
+
+#pragma once
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#ifndef VG3O_TRACE
+#define VG3O_TRACE 1
+#endif
+
+#define VG3O_TRACE_CONCAT_INNER(a, b) a##b
+#define VG3O_TRACE_CONCAT(a, b) VG3O_TRACE_CONCAT_INNER(a, b)
+#if VG3O_TRACE
+#define VG3O_TRACE_SCOPE(name) vg3o::TraceScope VG3O_TRACE_CONCAT(traceScope, __LINE__)(name)
+#else
+#define VG3O_TRACE_SCOPE(name) (void)0
+#endif
+
+namespace vg3o {
+
+	struct TraceStats {
+		bool capturing = false;
+		unsigned int framesLeft = 0; // 0 while capturing runs until endCapture()
+		unsigned int numThreads = 0; // that have recorded at least one scope
+		unsigned long long eventsRecorded = 0; // since startup, captures and benchmarks alike
+		unsigned long long eventsDropped = 0; // overwritten in a ring before the capture ended
+		std::string lastFile; // written by the last capture, empty if it failed
+	};
+
+	struct TraceOverhead {
+		double idleNanoseconds = 0; // per scope with nothing recording
+		double recordingNanoseconds = 0; // per scope while recording
+	};
+
+	class Trace {
+	public:
+		/// <summary>
+		/// Events each thread keeps. Only applies to threads that haven't recorded anything yet.
+		/// </summary>
+		static void setRingSize(size_t events);
+
+		/// <summary>
+		/// Starts recording on every thread.
+		/// </summary>
+		/// <param name="numFrames">Ends the capture by itself after this many frame() calls, 0 to wait for endCapture().</param>
+		/// <param name="path">Where the trace is written when the capture ends.</param>
+		static void beginCapture(unsigned int numFrames, const std::string& path);
+		/// <summary>
+		/// Stops recording and writes the events captured since beginCapture().
+		/// </summary>
+		/// <returns>False if nothing was capturing or the file couldn't be written.</returns>
+		static bool endCapture();
+
+		/// <summary>
+		/// Marks a frame boundary on the calling thread. Call once per frame from the main loop.
+		/// </summary>
+		static void frame();
+
+		/// <summary>
+		/// Names the calling thread in the trace. Cheap, its ring isn't made until it records something.
+		/// </summary>
+		static void setThreadName(const std::string& name);
+
+		/// <summary>
+		/// A copy of the string that lives as long as the program, for scope names built at runtime.
+		/// Takes a lock, so do it once rather than per scope.
+		/// </summary>
+		static const char* intern(const std::string& name);
+
+		static TraceStats getStats();
+
+		/// <summary>
+		/// Times empty scopes on the calling thread, idle and recording. Only this thread records, other threads
+		/// keep running idle scopes. Returns zeros while a capture is running, and no recording time if one starts meanwhile.
+		/// </summary>
+		static TraceOverhead measureOverhead(unsigned int iterations);
+
+		/// <summary>
+		/// True while a capture is recording. What every scope checks first.
+		/// </summary>
+		static bool isRecording() { return sRecording.load(std::memory_order_relaxed); }
+
+		static uint64_t now();
+		static void record(const char* name, uint64_t begin, uint64_t end);
+	private:
+		static std::atomic<bool> sRecording;
+	};
+
+	/// <summary>
+	/// Records the time between its construction and destruction. Use VG3O_TRACE_SCOPE instead of declaring these.
+	/// </summary>
+	class TraceScope {
+	public:
+		TraceScope(const char* name) {
+			if (Trace::isRecording()) {
+				mName = name;
+				mBegin = Trace::now();
+			}
+		}
+		~TraceScope() {
+			if (mName != nullptr)
+				Trace::record(mName, mBegin, Trace::now());
+		}
+		TraceScope(const TraceScope&) = delete;
+		TraceScope& operator=(const TraceScope&) = delete;
+	private:
+		friend class Trace;
+		// records whatever the capture state, for measureOverhead() on its own thread only
+		struct Forced {};
+		TraceScope(const char* name, Forced) {
+			mName = name;
+			mBegin = Trace::now();
+		}
+
+		const char* mName = nullptr;
+		uint64_t mBegin = 0;
+	};
+}
@@ -0,0 +1,52 @@
+#include "UniformBuffer.h"
+#include "external/glad.h"
+
+#include <iostream>
+#include <utility>
+
+namespace vg3o {
+	unsigned int UniformBuffer::sNumUpdates = 0;
+
+	UniformBuffer::UniformBuffer(size_t size, unsigned int binding) {
+		mSize = size;
+		mBinding = binding;
+		glCreateBuffers(1, &mBuffer);
+		glNamedBufferData(mBuffer, size, NULL, GL_DYNAMIC_DRAW);
+		bind();
+	}
+
+	UniformBuffer::~UniformBuffer() {
+		if (mBuffer != 0)
+			glDeleteBuffers(1, &mBuffer);
+	}
+
+	UniformBuffer::UniformBuffer(UniformBuffer&& other) noexcept {
+		mBuffer = other.mBuffer;
+		mBinding = other.mBinding;
+		mSize = other.mSize;
+		other.mBuffer = 0;
+		other.mSize = 0;
+	}
+
+	UniformBuffer& UniformBuffer::operator=(UniformBuffer&& other) noexcept {
+		// the old buffer goes with other when it dies
+		std::swap(mBuffer, other.mBuffer);
+		std::swap(mBinding, other.mBinding);
+		std::swap(mSize, other.mSize);
+		return *this;
+	}
+
+	void UniformBuffer::update(const void* data, size_t size, size_t offset) {
+		if (offset + size > mSize)
+		{
+			std::cout << "ERROR::UNIFORMBUFFER:: Update of " << size << " bytes at " << offset << " overflows block of " << mSize << std::endl;
+			return;
+		}
+		glNamedBufferSubData(mBuffer, offset, size, data);
+		sNumUpdates++;
+	}
+
+	void UniformBuffer::bind() const {
+		glBindBufferBase(GL_UNIFORM_BUFFER, mBinding, mBuffer);
+	}
+}
@@ -0,0 +1,47 @@
+/*
+	UniformBuffer // Brandon Salvietti
+
+	A std140 uniform block backed by one buffer. Fill a C++ struct that mirrors the block layout
+	and upload it once per frame/pass/material instead of setting each uniform on each draw.
+*/
+
+#pragma once
+#include <stddef.h>
+
+namespace vg3o {
+
+	class UniformBuffer {
+	public:
+		UniformBuffer() {};
+		/// <param name="size">Size of the block in bytes, must match the std140 layout in the shader.</param>
+		/// <param name="binding">Binding point, the shader side uses layout(std140, binding = N).</param>
+		UniformBuffer(size_t size, unsigned int binding);
+		~UniformBuffer();
+		// owns its buffer, so it can be moved (e.g. into an array slot) but never copied
+		UniformBuffer(const UniformBuffer&) = delete;
+		UniformBuffer& operator=(const UniformBuffer&) = delete;
+		UniformBuffer(UniformBuffer&& other) noexcept;
+		UniformBuffer& operator=(UniformBuffer&& other) noexcept;
+
+		void update(const void* data, size_t size, size_t offset = 0);
+
+		template<typename T>
+		void update(const T& data) { update(&data, sizeof(T)); }
+
+		/// <summary>
+		/// Attaches the buffer to its binding point. Needed when several buffers share one binding.
+		/// </summary>
+		void bind() const;
+
+		unsigned int getBinding() const { return mBinding; }
+		unsigned int getBuffer() const { return mBuffer; }
+
+		static unsigned int getNumUpdates() { return sNumUpdates; }
+		static void resetNumUpdates() { sNumUpdates = 0; }
+	private:
+		unsigned int mBuffer = 0;
+		unsigned int mBinding = 0;
+		size_t mSize = 0;
+		static unsigned int sNumUpdates;
+	};
+}
@@ -7,64 +7,292 @@
 
 #include "mesh.h"
 #include "external/glad.h"
+#include "GeometryArena.h"
+#include "GLState.h"
+#include <stdio.h>
+#include <string.h>
 
 namespace ew {
-	Mesh::Mesh(const MeshData& meshData)
+	static MeshUploadStats s_uploadStats;
+
+	MeshUploadStats getMeshUploadStats()
+	{
+		return s_uploadStats;
+	}
+	void resetMeshUploadStats()
 	{
+		s_uploadStats = MeshUploadStats();
+	}
+
+	/// <summary>
+	/// Writes data into a bound buffer, only reallocating when it no longer fits. Capacity grows by 1.5x to amortize growth.
+	/// </summary>
+	/// <param name="target">GL_ARRAY_BUFFER or GL_ELEMENT_ARRAY_BUFFER</param>
+	/// <param name="capacity">Current capacity in elements, updated on reallocation</param>
+	static void uploadDynamic(GLenum target, const void* data, unsigned int count, unsigned int elementSize, unsigned int& capacity)
+	{
+		if (count > capacity) {
+			capacity = count + count / 2;
+			glBufferData(target, (size_t)elementSize * capacity, NULL, GL_DYNAMIC_DRAW);
+			s_uploadStats.reallocations++;
+		}
+		if (count > 0) {
+			glBufferSubData(target, 0, (size_t)elementSize * count, data);
+			s_uploadStats.bytesUploaded += (size_t)elementSize * count;
+		}
+	}
+
+	Mesh::Mesh(const MeshData& meshData, MeshUsage usage)
+	{
+		m_usage = usage;
 		load(meshData);
 	}
-	void Mesh::load(const MeshData& meshData)
+	void Mesh::createVertexArray()
 	{
-		if (!m_initialized) {
-			glGenVertexArrays(1, &m_vao);
-			glBindVertexArray(m_vao);
+		if (m_usage == MeshUsage::STREAM) {
+			//Attribute formats are split from the buffer binding so each frame can point binding 0 at a different region
+			glCreateVertexArrays(1, &m_vao);
+			glVertexArrayAttribFormat(m_vao, 0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, pos));
+			glVertexArrayAttribBinding(m_vao, 0, 0);
+			glEnableVertexArrayAttrib(m_vao, 0);
+			glVertexArrayAttribFormat(m_vao, 1, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, normal));
+			glVertexArrayAttribBinding(m_vao, 1, 0);
+			glEnableVertexArrayAttrib(m_vao, 1);
+			glVertexArrayAttribFormat(m_vao, 2, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, uv));
+			glVertexArrayAttribBinding(m_vao, 2, 0);
+			glEnableVertexArrayAttrib(m_vao, 2);
 
-			glGenBuffers(1, &m_vbo);
-			glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+			glCreateBuffers(1, &m_ebo);
+			glVertexArrayElementBuffer(m_vao, m_ebo);
+			m_stream = std::make_shared<StreamState>();
+			m_initialized = true;
+			return;
+		}
+
+		glGenVertexArrays(1, &m_vao);
+		vg3o::GLState::bindVertexArray(m_vao);
 
-			glGenBuffers(1, &m_ebo);
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
-			//Position attribute
-			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, pos));
-			glEnableVertexAttribArray(0);
+		glGenBuffers(1, &m_vbo);
+		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
 
-			//Normal attribute
-			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, normal));
-			glEnableVertexAttribArray(1);
+		glGenBuffers(1, &m_ebo);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+		//Position attribute
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, pos));
+		glEnableVertexAttribArray(0);
 
-			//UV attribute
-			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(offsetof(Vertex, uv)));
-			glEnableVertexAttribArray(2);
+		//Normal attribute
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, normal));
+		glEnableVertexAttribArray(1);
 
-			m_initialized = true;
+		//UV attribute
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(offsetof(Vertex, uv)));
+		glEnableVertexAttribArray(2);
+
+		m_initialized = true;
+	}
+	void Mesh::createStreamStorage(unsigned int vertexCapacity)
+	{
+		//Storage is immutable, so growing means a new buffer. Everything in flight has to finish first.
+		if (m_vbo != 0) {
+			for (int i = 0; i < STREAM_REGIONS; i++)
+				waitForRegion(i);
+			glUnmapNamedBuffer(m_vbo);
+			glDeleteBuffers(1, &m_vbo);
+			s_uploadStats.reallocations++;
+		}
+		m_vertexCapacity = vertexCapacity;
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		size_t size = sizeof(Vertex) * (size_t)m_vertexCapacity * STREAM_REGIONS;
+		glCreateBuffers(1, &m_vbo);
+		glNamedBufferStorage(m_vbo, size, NULL, flags);
+		m_stream->mapping = (char*)glMapNamedBufferRange(m_vbo, 0, size, flags);
+		m_stream->region = 0;
+	}
+	void Mesh::waitForRegion(int region)
+	{
+		GLsync fence = (GLsync)m_stream->fences[region];
+		if (fence == NULL)
+			return;
+		if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+			s_uploadStats.fenceWaits++;
+			while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {}
 		}
+		glDeleteSync(fence);
+		m_stream->fences[region] = NULL;
+	}
+	void Mesh::reserve(unsigned int numVertices, unsigned int numIndices)
+	{
+		if (m_usage == MeshUsage::STREAM) {
+			if (!m_initialized)
+				createVertexArray();
+			if (numVertices > m_vertexCapacity)
+				createStreamStorage(numVertices);
+			if (numIndices > m_indexCapacity) {
+				m_indexCapacity = numIndices;
+				glNamedBufferData(m_ebo, sizeof(unsigned int) * (size_t)m_indexCapacity, NULL, GL_DYNAMIC_DRAW);
+				m_numIndices = 0; //The old indices went with the old storage
+			}
+			return;
+		}
+		if (m_usage != MeshUsage::DYNAMIC)
+			return;
+		if (!m_initialized)
+			createVertexArray();
+		//GL_ARRAY_BUFFER isn't part of the VAO, so these go through DSA instead of relying on whatever is bound
+		//Growing discards what was there, nothing is drawn from it until the next load()
+		if (numVertices > m_vertexCapacity) {
+			m_vertexCapacity = numVertices;
+			glNamedBufferData(m_vbo, sizeof(Vertex) * (size_t)m_vertexCapacity, NULL, GL_DYNAMIC_DRAW);
+			m_numVertices = 0;
+		}
+		if (numIndices > m_indexCapacity) {
+			m_indexCapacity = numIndices;
+			glNamedBufferData(m_ebo, sizeof(unsigned int) * (size_t)m_indexCapacity, NULL, GL_DYNAMIC_DRAW);
+			m_numIndices = 0;
+		}
+	}
+	void Mesh::load(const MeshData& meshData)
+	{
+		if (m_usage == MeshUsage::ARENA) {
+			m_arenaId = vg3o::GeometryArena::get().reallocate(m_arenaId, meshData);
+			m_numVertices = meshData.vertices.size();
+			m_numIndices = meshData.indices.size();
+			m_initialized = m_arenaId >= 0;
+			return;
+		}
+		if (!m_initialized) {
+			createVertexArray();
+		}
+		unsigned int numVertices = meshData.vertices.size();
+		unsigned int numIndices = meshData.indices.size();
+
+		if (m_usage == MeshUsage::STREAM) {
+			if (numVertices > m_vertexCapacity)
+				createStreamStorage(numVertices + numVertices / 2);
+
+			//Move to the next region and make sure the GPU is done reading what was written there 3 frames ago
+			m_stream->region = (m_stream->region + 1) % STREAM_REGIONS;
+			waitForRegion(m_stream->region);
+			size_t regionOffset = sizeof(Vertex) * (size_t)m_vertexCapacity * m_stream->region;
+			if (numVertices > 0) {
+				memcpy(m_stream->mapping + regionOffset, meshData.vertices.data(), sizeof(Vertex) * numVertices);
+				s_uploadStats.bytesUploaded += sizeof(Vertex) * numVertices;
+			}
+			glVertexArrayVertexBuffer(m_vao, 0, m_vbo, regionOffset, sizeof(Vertex));
 
-		glBindVertexArray(m_vao);
+			if (numIndices > m_indexCapacity) {
+				m_indexCapacity = numIndices + numIndices / 2;
+				glNamedBufferData(m_ebo, sizeof(unsigned int) * (size_t)m_indexCapacity, NULL, GL_DYNAMIC_DRAW);
+				s_uploadStats.reallocations++;
+			}
+			//Deforming and particle geometry can change topology without changing the count, so indices always go up
+			if (numIndices > 0) {
+				glNamedBufferSubData(m_ebo, 0, sizeof(unsigned int) * numIndices, meshData.indices.data());
+				s_uploadStats.bytesUploaded += sizeof(unsigned int) * numIndices;
+			}
+			m_numVertices = numVertices;
+			m_numIndices = numIndices;
+			return;
+		}
+
+		vg3o::GLState::bindVertexArray(m_vao);
 		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
 
-		if (meshData.vertices.size() > 0) {
-			glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * meshData.vertices.size(), meshData.vertices.data(), GL_STATIC_DRAW);
+		if (m_usage == MeshUsage::DYNAMIC) {
+			uploadDynamic(GL_ARRAY_BUFFER, meshData.vertices.data(), numVertices, sizeof(Vertex), m_vertexCapacity);
+			uploadDynamic(GL_ELEMENT_ARRAY_BUFFER, meshData.indices.data(), numIndices, sizeof(unsigned int), m_indexCapacity);
 		}
-		if (meshData.indices.size() > 0) {
-			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * meshData.indices.size(), meshData.indices.data(), GL_STATIC_DRAW);
+		else {
+			if (meshData.vertices.size() > 0) {
+				glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * meshData.vertices.size(), meshData.vertices.data(), GL_STATIC_DRAW);
+				s_uploadStats.bytesUploaded += sizeof(Vertex) * meshData.vertices.size();
+			}
+			if (meshData.indices.size() > 0) {
+				glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * meshData.indices.size(), meshData.indices.data(), GL_STATIC_DRAW);
+				s_uploadStats.bytesUploaded += sizeof(unsigned int) * meshData.indices.size();
+			}
+			m_vertexCapacity = numVertices;
+			m_indexCapacity = numIndices;
 		}
-		m_numVertices = meshData.vertices.size();
-		m_numIndices = meshData.indices.size();
+		m_numVertices = numVertices;
+		m_numIndices = numIndices;
 
-		glBindVertexArray(0);
+		vg3o::GLState::bindVertexArray(0);
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 	}
+	void Mesh::updateVertices(const Vertex* vertices, unsigned int firstVertex, unsigned int numVertices)
+	{
+		if (!m_initialized || numVertices == 0)
+			return;
+		if (m_usage != MeshUsage::STATIC && m_usage != MeshUsage::DYNAMIC)
+			return;
+		if (firstVertex + numVertices > m_vertexCapacity) {
+			printf("Mesh::updateVertices range %u-%u is outside of capacity %u\n", firstVertex, firstVertex + numVertices, m_vertexCapacity);
+			return;
+		}
+		glNamedBufferSubData(m_vbo, sizeof(Vertex) * (size_t)firstVertex, sizeof(Vertex) * (size_t)numVertices, vertices);
+		s_uploadStats.bytesUploaded += sizeof(Vertex) * (size_t)numVertices;
+		if (firstVertex + numVertices > m_numVertices)
+			m_numVertices = firstVertex + numVertices;
+	}
 	void Mesh::draw(ew::DrawMode drawMode) const
 	{
-		glBindVertexArray(m_vao);
+		if (m_usage == MeshUsage::ARENA) {
+			if (m_arenaId < 0) return;
+			vg3o::GeometryArena& arena = vg3o::GeometryArena::get();
+			const vg3o::ArenaAllocation& allocation = arena.getAllocation(m_arenaId);
+			arena.bind();
+			if (drawMode == DrawMode::TRIANGLES) {
+				glDrawElementsBaseVertex(GL_TRIANGLES, allocation.numIndices, GL_UNSIGNED_INT, (const void*)(sizeof(unsigned int) * allocation.firstIndex), allocation.baseVertex);
+			}
+			else {
+				glDrawArrays(GL_POINTS, allocation.baseVertex, allocation.numVertices);
+			}
+			vg3o::GLState::countDrawCall();
+			return;
+		}
+		vg3o::GLState::bindVertexArray(m_vao);
 		if (drawMode == DrawMode::TRIANGLES) {
 			glDrawElements(GL_TRIANGLES, m_numIndices, GL_UNSIGNED_INT, NULL);
 		}
 		else {
 			glDrawArrays(GL_POINTS, 0, m_numVertices);
 		}
-		
+		vg3o::GLState::countDrawCall();
+		if (m_usage == MeshUsage::STREAM) {
+			//Replaces any fence from an earlier draw this frame, the newest one covers both
+			void*& fence = m_stream->fences[m_stream->region];
+			if (fence != NULL)
+				glDeleteSync((GLsync)fence);
+			fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		}
+	}
+	void Mesh::release()
+	{
+		if (m_usage == MeshUsage::ARENA) {
+			vg3o::GeometryArena::get().free(m_arenaId);
+			m_arenaId = -1;
+		}
+		else if (m_initialized) {
+			if (m_usage == MeshUsage::STREAM) {
+				for (int i = 0; i < STREAM_REGIONS; i++)
+					waitForRegion(i);
+				if (m_vbo != 0)
+					glUnmapNamedBuffer(m_vbo);
+				m_stream->mapping = nullptr;
+				m_stream.reset();
+			}
+			glDeleteBuffers(1, &m_vbo);
+			glDeleteBuffers(1, &m_ebo);
+			glDeleteVertexArrays(1, &m_vao);
+			vg3o::GLState::vertexArrayDeleted(m_vao);
+			m_vao = m_vbo = m_ebo = 0;
+		}
+		m_initialized = false;
+		m_numVertices = m_numIndices = 0;
+		m_vertexCapacity = m_indexCapacity = 0;
 	}
-}
\ No newline at end of file
+}
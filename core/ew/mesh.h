@@ -5,6 +5,7 @@
 #pragma once
 #include <glm/glm.hpp>
 #include <vector>
+#include <memory>
 
 namespace ew {
 	struct Vertex {
@@ -23,20 +24,63 @@ namespace ew {
 		POINTS = 1
 	};
 
+	enum class MeshUsage {
+		STATIC = 0, //Mesh owns its own VAO/VBO/EBO
+		ARENA = 1, //Mesh lives in the shared vg3o::GeometryArena
+		DYNAMIC = 2, //Updated often. Storage keeps its capacity and is rewritten with glBufferSubData
+		STREAM = 3 //Rewritten every frame. Vertices go through a triple-buffered persistent mapping, indices are uploaded with glBufferSubData
+	};
+
+	//Totals across all meshes, for measuring upload cost
+	struct MeshUploadStats {
+		size_t bytesUploaded = 0;
+		unsigned int reallocations = 0; //Times storage had to be recreated because the data outgrew it
+		unsigned int fenceWaits = 0; //Times a stream mesh had to wait for the GPU to finish with a region
+	};
+	MeshUploadStats getMeshUploadStats();
+	void resetMeshUploadStats();
+
 	class Mesh {
 	public:
 		Mesh() {};
-		Mesh(const MeshData& meshData);
+		Mesh(const MeshData& meshData, MeshUsage usage = MeshUsage::STATIC);
 		void load(const MeshData& meshData);
+		//Overwrites a range of vertices in place. STATIC and DYNAMIC only, STREAM meshes are rewritten whole with load()
+		void updateVertices(const Vertex* vertices, unsigned int firstVertex, unsigned int numVertices);
+		//Reserves storage ahead of time so later loads up to this size never reallocate. DYNAMIC and STREAM only
+		//Storage that has to grow is recreated empty, so anything loaded before is gone until the next load()
+		void reserve(unsigned int numVertices, unsigned int numIndices);
 		void draw(DrawMode drawMode = DrawMode::TRIANGLES)const;
+		//Frees GL storage or the arena allocation. Meshes are copied by value, so this is never done implicitly.
+		void release();
 		inline int getNumVertices()const { return m_numVertices; }
 		inline int getNumIndices()const { return m_numIndices; }
+		inline MeshUsage getUsage()const { return m_usage; }
+		inline int getArenaId()const { return m_arenaId; }
 	private:
+		MeshUsage m_usage = MeshUsage::STATIC;
+		int m_arenaId = -1;
 		bool m_initialized = false;
 		unsigned int m_vao = 0;
 		unsigned int m_vbo = 0;
 		unsigned int m_ebo = 0;
 		unsigned int m_numVertices = 0;
 		unsigned int m_numIndices = 0;
+		unsigned int m_vertexCapacity = 0;
+		unsigned int m_indexCapacity = 0;
+
+		//STREAM only
+		static const int STREAM_REGIONS = 3;
+		void createVertexArray();
+		void createStreamStorage(unsigned int vertexCapacity);
+		void waitForRegion(int region);
+		//Copies of a mesh share its buffers, so they share the mapping and fences too. Otherwise two copies
+		//would wait on and delete the same fence
+		struct StreamState {
+			char* mapping = nullptr;
+			int region = 0;
+			void* fences[STREAM_REGIONS] = {}; //GLsync per region, set after the draws that read it
+		};
+		std::shared_ptr<StreamState> m_stream;
 	};
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 */
 
 #include "model.h"
+#include "Trace.h"
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 
@@ -10,24 +11,66 @@
 #include <glm/glm.hpp>
 
 namespace ew {
-	ew::Mesh processAiMesh(aiMesh* aiMesh);
+	ew::Mesh processAiMesh(const aiMesh* aiMesh, vg3o::MorphTargetSet* morphTargets);
 
 	Model::Model(const std::string& filePath)
 	{
+		VG3O_TRACE_SCOPE("Model::Model");
 		Assimp::Importer importer;
 		const aiScene* aiScene = importer.ReadFile(filePath, aiProcess_Triangulate);
 		for (size_t i = 0; i < aiScene->mNumMeshes; i++)
 		{
 			aiMesh* aiMesh = aiScene->mMeshes[i];
-			m_meshes.push_back(processAiMesh(aiMesh));
+			m_morphTargets.push_back(vg3o::MorphTargetSet());
+			m_meshes.push_back(processAiMesh(aiMesh, &m_morphTargets.back()));
 		}
 	}
 
 	void Model::draw()
 	{
+		//Arena offsets only move on defragment, so the commands are rebuilt just then
+		unsigned int generation = vg3o::GeometryArena::get().getGeneration();
+		if (!m_batchBuilt || m_batchGeneration != generation) {
+			m_batch.clear();
+			addToBatch(m_batch);
+			m_batchGeneration = generation;
+			m_batchBuilt = true;
+		}
+		m_batch.submit();
+
 		for (size_t i = 0; i < m_meshes.size(); i++)
 		{
-			m_meshes[i].draw();
+			if (m_meshes[i].getUsage() != ew::MeshUsage::ARENA)
+				m_meshes[i].draw();
+		}
+	}
+
+	void Model::release()
+	{
+		for (size_t i = 0; i < m_meshes.size(); i++)
+		{
+			m_meshes[i].release();
+		}
+		m_meshes.clear();
+		m_morphTargets.clear();
+		m_batch.clear();
+		m_batchBuilt = false;
+	}
+
+	void Model::updateMorphTargets()
+	{
+		for (size_t i = 0; i < m_meshes.size(); i++)
+		{
+			if (!m_morphTargets[i].empty())
+				m_morphTargets[i].apply(m_meshes[i]);
+		}
+	}
+
+	void Model::addToBatch(vg3o::IndirectBatch& batch, unsigned int baseInstance) const
+	{
+		for (size_t i = 0; i < m_meshes.size(); i++)
+		{
+			batch.add(m_meshes[i], baseInstance);
 		}
 	}
 
@@ -35,9 +78,9 @@ namespace ew {
 		return glm::vec3(v.x, v.y, v.z);
 	}
 
-	//Utility functions local to this file
-	ew::Mesh processAiMesh(aiMesh* aiMesh) {
-		ew::MeshData meshData;
+	bool convertAiMesh(const aiMesh* aiMesh, ew::MeshData& meshData, vg3o::MorphTargetSet* morphTargets) {
+		meshData.vertices.clear();
+		meshData.indices.clear();
 		for (size_t i = 0; i < aiMesh->mNumVertices; i++)
 		{
 			ew::Vertex vertex;
@@ -58,7 +101,40 @@ namespace ew {
 				meshData.indices.push_back(aiMesh->mFaces[i].mIndices[j]);
 			}
 		}
-		return ew::Mesh(meshData);
+		if (aiMesh->mNumAnimMeshes == 0) {
+			return false;
+		}
+
+		//Anim meshes hold absolute positions/normals for every vertex, MorphTargetSet keeps only the ones that moved
+		morphTargets->setBase(meshData);
+		std::vector<glm::vec3> positions, normals;
+		for (size_t i = 0; i < aiMesh->mNumAnimMeshes; i++)
+		{
+			aiAnimMesh* animMesh = aiMesh->mAnimMeshes[i];
+			if (animMesh->mNumVertices != aiMesh->mNumVertices)
+				continue;
+			positions.clear();
+			normals.clear();
+			for (size_t j = 0; j < animMesh->mNumVertices; j++)
+			{
+				positions.push_back(animMesh->HasPositions() ? convertAIVec3(animMesh->mVertices[j]) : meshData.vertices[j].pos);
+				if (animMesh->HasNormals())
+					normals.push_back(convertAIVec3(animMesh->mNormals[j]));
+			}
+			int target = morphTargets->addTarget(animMesh->mName.C_Str(), positions.data(), normals.empty() ? nullptr : normals.data());
+			morphTargets->setWeight(target, animMesh->mWeight);
+		}
+		return true;
+	}
+
+	//Utility functions local to this file
+	ew::Mesh processAiMesh(const aiMesh* aiMesh, vg3o::MorphTargetSet* morphTargets) {
+		ew::MeshData meshData;
+		if (!convertAiMesh(aiMesh, meshData, morphTargets)) {
+			return ew::Mesh(meshData, ew::MeshUsage::ARENA);
+		}
+		//Blended every time weights change, so it gets its own growable buffers instead of an arena range
+		return ew::Mesh(meshData, ew::MeshUsage::DYNAMIC);
 	}
 
 }
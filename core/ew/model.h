@@ -5,14 +5,36 @@
 #pragma once
 #include "mesh.h"
 #include "shader.h"
+#include "GeometryArena.h"
+#include "MorphTargets.h"
 #include <vector>
 
+struct aiMesh;
+
 namespace ew {
+	//Copies an assimp mesh's vertices and indices into meshData, and its anim meshes into morphTargets.
+	//CPU only, Model uploads the result. Returns true if the mesh has morph targets
+	bool convertAiMesh(const aiMesh* aiMesh, MeshData& meshData, vg3o::MorphTargetSet* morphTargets);
+
 	class Model {
 	public:
 		Model(const std::string& filePath);
+		//Static submeshes live in the geometry arena and are drawn with one multi-draw, morphing ones are drawn after
 		void draw();
+		//Returns every submesh's arena range and GL objects. Explicit, like Mesh::release()
+		void release();
+		//Adds this model's arena submeshes to a batch that is submitted elsewhere. Morphing submeshes are skipped
+		void addToBatch(vg3o::IndirectBatch& batch, unsigned int baseInstance = 0) const;
+		//Blends and uploads every submesh whose morph weights changed since the last call
+		void updateMorphTargets();
+		inline size_t getNumMeshes()const { return m_meshes.size(); }
+		//Blend shapes of one submesh. Empty if it has none
+		inline vg3o::MorphTargetSet& getMorphTargets(size_t meshIndex) { return m_morphTargets[meshIndex]; }
 	private:
 		std::vector<ew::Mesh> m_meshes;
+		std::vector<vg3o::MorphTargetSet> m_morphTargets; //Parallel to m_meshes
+		vg3o::IndirectBatch m_batch;
+		unsigned int m_batchGeneration = 0;
+		bool m_batchBuilt = false;
 	};
 }
\ No newline at end of file
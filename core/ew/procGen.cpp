@@ -3,21 +3,106 @@
 */
 
 #include "procGen.h"
+#include "ThreadPool.h"
 #include <stdlib.h>
+#include <map>
+#include <mutex>
+#include <unordered_map>
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 
 using namespace glm;
 
 namespace ew {
+	/// <summary>
+	/// Shared by every generator that takes the parallel path. Created on first use.
+	/// </summary>
+	static vg3o::ThreadPool& getProcGenPool() {
+		static vg3o::ThreadPool pool;
+		return pool;
+	}
+
+	/// <summary>
+	/// Runs fn over [0, count) either inline or split across the worker pool.
+	/// </summary>
+	template<typename Fn>
+	static void forRows(size_t count, bool parallel, const Fn& fn) {
+		if (parallel) {
+			getProcGenPool().parallelFor(count, fn);
+		}
+		else {
+			fn(0, count);
+		}
+	}
+
+	static bool fits(const MeshSpan& out, const MeshSize& size) {
+		return out.vertices != nullptr && out.indices != nullptr
+			&& out.numVertices >= size.numVertices && out.numIndices >= size.numIndices;
+	}
+
+	/// <summary>
+	/// Sizes mesh to exactly fit, then runs the span version of a generator into it.
+	/// </summary>
+	template<typename Fn>
+	static void fillMeshData(MeshData& mesh, MeshSize size, const Fn& generate) {
+		mesh.vertices.resize(size.numVertices);
+		mesh.indices.resize(size.numIndices);
+		MeshSpan span;
+		span.vertices = mesh.vertices.data();
+		span.numVertices = size.numVertices;
+		span.indices = mesh.indices.data();
+		span.numIndices = size.numIndices;
+		generate(span);
+	}
+
+	MeshSize getCubeSize() {
+		MeshSize size;
+		size.numVertices = 24; //6 x 4 vertices
+		size.numIndices = 36; //6 x 6 indices
+		return size;
+	}
+	MeshSize getPlaneSize(int subdivisions) {
+		MeshSize size;
+		size.numVertices = (subdivisions + 1) * (subdivisions + 1);
+		size.numIndices = subdivisions * subdivisions * 6;
+		return size;
+	}
+	MeshSize getSphereSize(int subdivisions) {
+		MeshSize size;
+		size.numVertices = (subdivisions + 1) * (subdivisions + 1);
+		//Two caps of one triangle per column, plus quads for the rows in between
+		int sideRows = subdivisions > 2 ? subdivisions - 2 : 0;
+		size.numIndices = subdivisions * 3 * 2 + sideRows * subdivisions * 6;
+		return size;
+	}
+	MeshSize getCylinderSize(int subdivisions) {
+		MeshSize size;
+		//2 center vertices and 4 rings
+		size.numVertices = 2 + (subdivisions + 1) * 4;
+		//Caps and sides, one triangle per column on each cap and a quad per column on the side
+		size.numIndices = (subdivisions + 1) * 12;
+		return size;
+	}
+	static int clampIcosphereSubdivisions(int subdivisions) {
+		return subdivisions < 0 ? 0 : subdivisions > ICOSPHERE_MAX_SUBDIVISIONS ? ICOSPHERE_MAX_SUBDIVISIONS : subdivisions;
+	}
+	MeshSize getIcosphereSize(int subdivisions) {
+		MeshSize size;
+		unsigned long long faces = 20ull << (2 * clampIcosphereSubdivisions(subdivisions));
+		size.numVertices = (unsigned int)(faces / 2 + 2);
+		size.numIndices = (unsigned int)(faces * 3);
+		return size;
+	}
+
 	/// <summary>
 	/// Helper function for createCube. Note that this is not meant to be used standalone
 	/// </summary>
 	/// <param name="normal">Normal direction of the face</param>
 	/// <param name="size">Width/height of the face</param>
-	/// <param name="mesh">MeshData struct to fill</param>
-	static void createCubeFace(vec3 normal, float size, MeshData* mesh) {
-		unsigned int startVertex = mesh->vertices.size();
+	/// <param name="startVertex">Index of the first of this face's 4 vertices</param>
+	/// <param name="vertices">Where this face's 4 vertices go</param>
+	/// <param name="indices">Where this face's 6 indices go</param>
+	static void createCubeFace(vec3 normal, float size, unsigned int startVertex, Vertex* vertices, unsigned int* indices) {
 		vec3 a = vec3(normal.z, normal.x, normal.y); //U axis
 		vec3 b = cross(normal, a); //V axis
 		for (int i = 0; i < 4; i++)
@@ -28,140 +113,150 @@ namespace ew {
 			vec3 pos = normal * size * 0.5f;
 			pos -= (a + b) * size * 0.5f;
 			pos += (a * (float)col + b * (float)row) * size;
-			Vertex vertex;// = &mesh->vertices[mesh->vertices.size()];
+			Vertex& vertex = vertices[i];
 			vertex.pos = pos;
 			vertex.normal = normal;
 			vertex.uv = glm::vec2(col, row);
-			mesh->vertices.push_back(vertex);
 		}
 
 		//Indices
-		mesh->indices.push_back(startVertex);
-		mesh->indices.push_back(startVertex + 1);
-		mesh->indices.push_back(startVertex + 3);
-		mesh->indices.push_back(startVertex + 3);
-		mesh->indices.push_back(startVertex + 2);
-		mesh->indices.push_back(startVertex);
+		indices[0] = startVertex;
+		indices[1] = startVertex + 1;
+		indices[2] = startVertex + 3;
+		indices[3] = startVertex + 3;
+		indices[4] = startVertex + 2;
+		indices[5] = startVertex;
 	}
 	/// <summary>
 	/// Creates a cube of uniform size
 	/// </summary>
 	/// <param name="size">Total width, height, depth</param>
-	/// <param name="mesh">MeshData struct to fill. Will be cleared.</param>
-	MeshData createCube(float size) {
-		MeshData mesh;
-		mesh.vertices.reserve(24); //6 x 4 vertices
-		mesh.indices.reserve(36); //6 x 6 indices
-		createCubeFace(vec3{ +0.0f,+0.0f,+1.0f }, size, &mesh); //Front
-		createCubeFace(vec3{ +1.0f,+0.0f,+0.0f }, size, &mesh); //Right
-		createCubeFace(vec3{ +0.0f,+1.0f,+0.0f }, size, &mesh); //Top
-		createCubeFace(vec3{ -1.0f,+0.0f,+0.0f }, size, &mesh); //Left
-		createCubeFace(vec3{ +0.0f,-1.0f,+0.0f }, size, &mesh); //Bottom
-		createCubeFace(vec3{ +0.0f,+0.0f,-1.0f }, size, &mesh); //Back
-		return mesh;
-	}
-	MeshData createPlane(float width, float height, int subdivisions)
-	{
-		//VERTICES
-		MeshData mesh;
-		int columns = subdivisions + 1;
-		for (size_t row = 0; row <= subdivisions; row++)
+	/// <param name="out">Span to fill. Needs room for getCubeSize()</param>
+	bool createCube(float size, MeshSpan out) {
+		if (!fits(out, getCubeSize())) return false;
+		const vec3 normals[6] = {
+			vec3{ +0.0f,+0.0f,+1.0f }, //Front
+			vec3{ +1.0f,+0.0f,+0.0f }, //Right
+			vec3{ +0.0f,+1.0f,+0.0f }, //Top
+			vec3{ -1.0f,+0.0f,+0.0f }, //Left
+			vec3{ +0.0f,-1.0f,+0.0f }, //Bottom
+			vec3{ +0.0f,+0.0f,-1.0f }, //Back
+		};
+		for (int i = 0; i < 6; i++)
 		{
-			for (size_t col = 0; col <= subdivisions; col++)
-			{
-				Vertex v;                                                                                                                                                                                                                                                                                                                                                                                                    
-				v.uv.x = ((float)col / subdivisions);
-				v.uv.y = ((float)row / subdivisions);
-				v.pos.x = -width/2 + width * v.uv.x;
-				v.pos.y = 0;
-				v.pos.z = height/2 -height * v.uv.y;
-				v.normal = vec3(0, 1, 0);
-				mesh.vertices.push_back(v);
-			}
+			createCubeFace(normals[i], size, i * 4, out.vertices + i * 4, out.indices + i * 6);
 		}
-		//INDICES
-		for (size_t row = 0; row < subdivisions; row++)
-		{
-			for (size_t col = 0; col < subdivisions; col++)
+		return true;
+	}
+	bool createPlane(float width, float height, int subdivisions, MeshSpan out)
+	{
+		if (!fits(out, getPlaneSize(subdivisions))) return false;
+		unsigned int columns = subdivisions + 1;
+		//Each row writes its own vertices and the quads below it, so rows are independent
+		forRows(subdivisions + 1, subdivisions >= PROCGEN_PARALLEL_SUBDIVISIONS, [&](size_t rowBegin, size_t rowEnd) {
+			for (size_t row = rowBegin; row < rowEnd; row++)
 			{
-				int start = row * columns + col;
-				mesh.indices.push_back(start);
-				mesh.indices.push_back(start + 1);
-				mesh.indices.push_back(start + columns + 1);
-				mesh.indices.push_back(start + columns + 1);
-				mesh.indices.push_back(start + columns);
-				mesh.indices.push_back(start);
+				//VERTICES
+				for (size_t col = 0; col <= subdivisions; col++)
+				{
+					Vertex& v = out.vertices[row * columns + col];
+					v.uv.x = ((float)col / subdivisions);
+					v.uv.y = ((float)row / subdivisions);
+					v.pos.x = -width / 2 + width * v.uv.x;
+					v.pos.y = 0;
+					v.pos.z = height / 2 - height * v.uv.y;
+					v.normal = vec3(0, 1, 0);
+				}
+				//INDICES
+				if (row == subdivisions) continue;
+				unsigned int* indices = out.indices + row * subdivisions * 6;
+				for (size_t col = 0; col < subdivisions; col++)
+				{
+					unsigned int start = row * columns + col;
+					*indices++ = start;
+					*indices++ = start + 1;
+					*indices++ = start + columns + 1;
+					*indices++ = start + columns + 1;
+					*indices++ = start + columns;
+					*indices++ = start;
+				}
 			}
-		}
-		return mesh;
+		});
+		return true;
 	}
-	MeshData createSphere(float radius, int subdivisions)
+	bool createSphere(float radius, int subdivisions, MeshSpan out)
 	{
-		MeshData mesh;
-		//VERTICES
+		if (!fits(out, getSphereSize(subdivisions))) return false;
 		float thetaStep = glm::two_pi<float>() / subdivisions;
 		float phiStep = glm::pi<float>() / subdivisions;
-		for (size_t row = 0; row <= subdivisions; row++)
-		{
-			float phi = row * phiStep;
-			for (size_t col = 0; col <= subdivisions; col++)
+		unsigned int columns = subdivisions + 1;
+		//Side rows sit between the two caps in the index buffer
+		unsigned int* sideIndices = out.indices + subdivisions * 3;
+		unsigned int* bottomIndices = out.indices + getSphereSize(subdivisions).numIndices - subdivisions * 3;
+
+		forRows(subdivisions + 1, subdivisions >= PROCGEN_PARALLEL_SUBDIVISIONS, [&](size_t rowBegin, size_t rowEnd) {
+			for (size_t row = rowBegin; row < rowEnd; row++)
 			{
-				float theta = thetaStep * col;
-				Vertex v;
-				v.normal.x = cosf(theta) * sinf(phi);
-				v.normal.y = cosf(phi);
-				v.normal.z = sinf(theta) * sinf(phi);
-				v.pos = v.normal * radius;
-				v.uv.x = (float)col / subdivisions;
-				v.uv.y = 1.0 - ((float)row / subdivisions);
-				mesh.vertices.push_back(v);
+				//VERTICES
+				float phi = row * phiStep;
+				for (size_t col = 0; col <= subdivisions; col++)
+				{
+					float theta = thetaStep * col;
+					Vertex& v = out.vertices[row * columns + col];
+					v.normal.x = cosf(theta) * sinf(phi);
+					v.normal.y = cosf(phi);
+					v.normal.z = sinf(theta) * sinf(phi);
+					v.pos = v.normal * radius;
+					v.uv.x = (float)col / subdivisions;
+					v.uv.y = 1.0 - ((float)row / subdivisions);
+				}
+				//Rows of quads for sides
+				if (row < 1 || (int)row >= subdivisions - 1) continue;
+				unsigned int* indices = sideIndices + (row - 1) * subdivisions * 6;
+				for (size_t col = 0; col < subdivisions; col++)
+				{
+					unsigned int start = row * columns + col;
+					*indices++ = start;
+					*indices++ = start + 1;
+					*indices++ = start + columns;
+					*indices++ = start + columns;
+					*indices++ = start + 1;
+					*indices++ = start + columns + 1;
+				}
 			}
-		}
-		
+		});
+
 		//INDICES
-		unsigned int columns = subdivisions + 1;
 		unsigned int sideStart = columns;
 		unsigned int poleStart = 0;
 		//Top cap
+		unsigned int* indices = out.indices;
 		for (size_t i = 0; i < subdivisions; i++)
 		{
-			mesh.indices.push_back(sideStart + i);
-			mesh.indices.push_back(poleStart + i);
-			mesh.indices.push_back(sideStart +i+1);
-		}
-		//Rows of quads for sides
-		for (size_t row = 1; row < subdivisions - 1; row++)
-		{
-			for (size_t col = 0; col < subdivisions; col++)
-			{
-				unsigned int start = row * columns + col;
-				mesh.indices.push_back(start);
-				mesh.indices.push_back(start + 1);
-				mesh.indices.push_back(start + columns);
-				mesh.indices.push_back(start + columns);
-				mesh.indices.push_back(start + 1);
-				mesh.indices.push_back(start + columns + 1);
-			}
+			*indices++ = sideStart + i;
+			*indices++ = poleStart + i;
+			*indices++ = sideStart + i + 1;
 		}
 		//Bottom cap
 		poleStart = (columns * columns) - columns;
 		sideStart = poleStart - columns;
+		indices = bottomIndices;
 		for (size_t i = 0; i < subdivisions; i++)
 		{
-			mesh.indices.push_back(sideStart + i);
-			mesh.indices.push_back(sideStart + i + 1);
-			mesh.indices.push_back(poleStart + i);
+			*indices++ = sideStart + i;
+			*indices++ = sideStart + i + 1;
+			*indices++ = poleStart + i;
 		}
-		return mesh;
+		return true;
 	}
-	void createCylinderRing(MeshData* meshData, float radius, int subdivisions, float y, bool sideFacing) {
+	static void createCylinderRing(Vertex* vertices, float radius, int subdivisions, float y, bool sideFacing) {
 		float thetaStep = two_pi<float>() / subdivisions;
 		for (size_t i = 0; i <= subdivisions; i++)
 		{
 			float theta = i * thetaStep;
 			float cosA = cosf(theta);
 			float sinA = sinf(theta);
-			Vertex v;
+			Vertex& v = vertices[i];
 			v.pos = vec3(cosA * radius, y, sinA * radius);
 			if (sideFacing) {
 				v.normal = vec3(cosA, 0, sinA);
@@ -171,70 +266,218 @@ namespace ew {
 				v.normal = vec3(0, sign(y), 0);
 				v.uv = vec2(cosA * 0.5f + 0.5f, sinA * 0.5f + 0.5f);
 			}
-
-			meshData->vertices.push_back(v);
 		}
 	}
-	MeshData createCylinder(float radius, float height, int subdivisions)
+	bool createCylinder(float radius, float height, int subdivisions, MeshSpan out)
 	{
-		MeshData mesh;
+		MeshSize size = getCylinderSize(subdivisions);
+		if (!fits(out, size)) return false;
+		int columns = subdivisions + 1;
 
 		//VERTICES
 		{
 			const float topY = height * 0.5;
 			const float bottomY = -topY;
 
-			Vertex topVertex;
+			Vertex& topVertex = out.vertices[0];
 			topVertex.pos = vec3(0, topY, 0);
 			topVertex.normal = vec3(0, 1, 0);
 			topVertex.uv = vec2(0.5f);
-			mesh.vertices.push_back(topVertex);
 
-			createCylinderRing(&mesh, radius, subdivisions, topY, false);
-			createCylinderRing(&mesh, radius, subdivisions, topY, true);
-			createCylinderRing(&mesh, radius, subdivisions, bottomY, true);
-			createCylinderRing(&mesh, radius, subdivisions, bottomY, false);
+			createCylinderRing(out.vertices + 1, radius, subdivisions, topY, false);
+			createCylinderRing(out.vertices + 1 + columns, radius, subdivisions, topY, true);
+			createCylinderRing(out.vertices + 1 + columns * 2, radius, subdivisions, bottomY, true);
+			createCylinderRing(out.vertices + 1 + columns * 3, radius, subdivisions, bottomY, false);
 
-			Vertex bottomVertex;
+			Vertex& bottomVertex = out.vertices[size.numVertices - 1];
 			bottomVertex.pos = vec3(0, bottomY, 0);
 			bottomVertex.normal = vec3(0, -1, 0);
 			bottomVertex.uv = vec2(0.5f);
-			mesh.vertices.push_back(bottomVertex);
 		}
-		
 
 		//INDICES
 		{
-			int columns = subdivisions + 1;
+			unsigned int* indices = out.indices;
 			//Top cap
 			for (size_t i = 0; i < columns; i++)
 			{
-				mesh.indices.push_back(0);
-				mesh.indices.push_back(i + 1);
-				mesh.indices.push_back(i);
+				*indices++ = 0;
+				*indices++ = i + 1;
+				*indices++ = i;
 			}
 			int sideStart = columns;
 			//Sides
 			for (size_t i = 0; i < columns; i++)
 			{
 				unsigned int start = sideStart + i;
-				mesh.indices.push_back(start);
-				mesh.indices.push_back(start + 1);
-				mesh.indices.push_back(start + columns);
-				mesh.indices.push_back(start + columns);
-				mesh.indices.push_back(start + 1);
-				mesh.indices.push_back(start + columns + 1);
+				*indices++ = start;
+				*indices++ = start + 1;
+				*indices++ = start + columns;
+				*indices++ = start + columns;
+				*indices++ = start + 1;
+				*indices++ = start + columns + 1;
 			}
 			//Bottom cap
-			unsigned int bottomIndex = mesh.vertices.size() - 1;
+			unsigned int bottomIndex = size.numVertices - 1;
 			sideStart = bottomIndex - columns;
 			for (size_t i = 0; i < columns; i++)
 			{
-				mesh.indices.push_back(bottomIndex);
-				mesh.indices.push_back(sideStart + i);
-				mesh.indices.push_back(sideStart + i + 1);
+				*indices++ = bottomIndex;
+				*indices++ = sideStart + i;
+				*indices++ = sideStart + i + 1;
 			}
 		}
+		return true;
+	}
+	/// <summary>
+	/// Subdivided icosahedron. Triangles are close to equal in size, unlike the UV sphere's poles.
+	/// Edge midpoints are shared through a scratch map, so this one allocates internally.
+	/// </summary>
+	bool createIcosphere(float radius, int subdivisions, MeshSpan out)
+	{
+		subdivisions = clampIcosphereSubdivisions(subdivisions);
+		MeshSize size = getIcosphereSize(subdivisions);
+		if (!fits(out, size)) return false;
+
+		const float t = (1.0f + sqrtf(5.0f)) / 2.0f;
+		const vec3 corners[12] = {
+			vec3(-1, t, 0), vec3(1, t, 0), vec3(-1, -t, 0), vec3(1, -t, 0),
+			vec3(0, -1, t), vec3(0, 1, t), vec3(0, -1, -t), vec3(0, 1, -t),
+			vec3(t, 0, -1), vec3(t, 0, 1), vec3(-t, 0, -1), vec3(-t, 0, 1)
+		};
+		const unsigned int faces[60] = {
+			0, 11, 5,	0, 5, 1,	0, 1, 7,	0, 7, 10,	0, 10, 11,
+			1, 5, 9,	5, 11, 4,	11, 10, 2,	10, 7, 6,	7, 1, 8,
+			3, 9, 4,	3, 4, 2,	3, 2, 6,	3, 6, 8,	3, 8, 9,
+			4, 9, 5,	2, 4, 11,	6, 2, 10,	8, 6, 7,	9, 8, 1
+		};
+
+		//Directions are kept in normal until the end, pos is filled from them
+		unsigned int numVertices = 0;
+		for (int i = 0; i < 12; i++)
+			out.vertices[numVertices++].normal = normalize(corners[i]);
+
+		//Ping-pong between the two halves of scratch, the final level is written straight into out.indices
+		std::vector<unsigned int> scratch(subdivisions > 0 ? size.numIndices / 4 : 0);
+		unsigned int* src = subdivisions > 0 ? scratch.data() : out.indices;
+		for (int i = 0; i < 60; i++)
+			src[i] = faces[i];
+		std::vector<unsigned int> levelScratch;
+
+		std::unordered_map<unsigned long long, unsigned int> midpoints;
+		midpoints.reserve(size.numVertices);
+		auto midpoint = [&](unsigned int a, unsigned int b) {
+			unsigned long long key = a < b ? ((unsigned long long)a << 32) | b : ((unsigned long long)b << 32) | a;
+			auto it = midpoints.find(key);
+			if (it != midpoints.end()) return it->second;
+			out.vertices[numVertices].normal = normalize(out.vertices[a].normal + out.vertices[b].normal);
+			midpoints[key] = numVertices;
+			return numVertices++;
+		};
+
+		unsigned int numFaces = 20;
+		for (int level = 0; level < subdivisions; level++)
+		{
+			unsigned int* dst;
+			if (level == subdivisions - 1) {
+				dst = out.indices;
+			}
+			else {
+				levelScratch.resize(numFaces * 12);
+				dst = levelScratch.data();
+			}
+			midpoints.clear();
+			for (unsigned int f = 0; f < numFaces; f++)
+			{
+				unsigned int a = src[f * 3], b = src[f * 3 + 1], c = src[f * 3 + 2];
+				unsigned int ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+				unsigned int* face = dst + f * 12;
+				face[0] = a; face[1] = ab; face[2] = ca;
+				face[3] = b; face[4] = bc; face[5] = ab;
+				face[6] = c; face[7] = ca; face[8] = bc;
+				face[9] = ab; face[10] = bc; face[11] = ca;
+			}
+			numFaces *= 4;
+			if (dst != out.indices) {
+				scratch.swap(levelScratch);
+				src = scratch.data();
+			}
+		}
+
+		for (unsigned int i = 0; i < numVertices; i++)
+		{
+			Vertex& v = out.vertices[i];
+			v.pos = v.normal * radius;
+			v.uv.x = 0.5f + atan2f(v.normal.z, v.normal.x) / glm::two_pi<float>();
+			v.uv.y = 0.5f + asinf(v.normal.y) / glm::pi<float>();
+		}
+		return true;
+	}
+
+	void createCube(float size, MeshData& mesh) {
+		fillMeshData(mesh, getCubeSize(), [&](MeshSpan span) { createCube(size, span); });
+	}
+	void createPlane(float width, float height, int subdivisions, MeshData& mesh) {
+		fillMeshData(mesh, getPlaneSize(subdivisions), [&](MeshSpan span) { createPlane(width, height, subdivisions, span); });
+	}
+	void createSphere(float radius, int subdivisions, MeshData& mesh) {
+		fillMeshData(mesh, getSphereSize(subdivisions), [&](MeshSpan span) { createSphere(radius, subdivisions, span); });
+	}
+	void createCylinder(float radius, float height, int subdivisions, MeshData& mesh) {
+		fillMeshData(mesh, getCylinderSize(subdivisions), [&](MeshSpan span) { createCylinder(radius, height, subdivisions, span); });
+	}
+	void createIcosphere(float radius, int subdivisions, MeshData& mesh) {
+		fillMeshData(mesh, getIcosphereSize(subdivisions), [&](MeshSpan span) { createIcosphere(radius, subdivisions, span); });
+	}
+
+	MeshData createCube(float size) {
+		MeshData mesh;
+		createCube(size, mesh);
+		return mesh;
+	}
+	MeshData createPlane(float width, float height, int subdivisions)
+	{
+		MeshData mesh;
+		createPlane(width, height, subdivisions, mesh);
+		return mesh;
+	}
+	MeshData createSphere(float radius, int subdivisions)
+	{
+		MeshData mesh;
+		createSphere(radius, subdivisions, mesh);
+		return mesh;
+	}
+	MeshData createCylinder(float radius, float height, int subdivisions)
+	{
+		MeshData mesh;
+		createCylinder(radius, height, subdivisions, mesh);
+		return mesh;
+	}
+	MeshData createIcosphere(float radius, int subdivisions)
+	{
+		MeshData mesh;
+		createIcosphere(radius, subdivisions, mesh);
 		return mesh;
 	}
-}
\ No newline at end of file
+
+	static std::mutex s_icosphereCacheMutex;
+	static std::map<std::pair<float, int>, MeshData> s_icosphereCache;
+
+	const MeshData& getCachedIcosphere(float radius, int subdivisions)
+	{
+		std::lock_guard<std::mutex> lock(s_icosphereCacheMutex);
+		std::pair<float, int> key(radius, subdivisions);
+		auto it = s_icosphereCache.find(key);
+		if (it != s_icosphereCache.end())
+			return it->second;
+		//std::map nodes never move, so the reference stays valid as the cache grows
+		MeshData& mesh = s_icosphereCache[key];
+		createIcosphere(radius, subdivisions, mesh);
+		return mesh;
+	}
+	void clearIcosphereCache()
+	{
+		std::lock_guard<std::mutex> lock(s_icosphereCacheMutex);
+		s_icosphereCache.clear();
+	}
+}
@@ -6,8 +6,53 @@
 #include "mesh.h"
 
 namespace ew {
+	//Exact vertex and index counts a generator will write
+	struct MeshSize {
+		unsigned int numVertices = 0;
+		unsigned int numIndices = 0;
+	};
+
+	//Caller-owned output for the allocation-free generators. Must hold at least the counts from the matching get*Size()
+	struct MeshSpan {
+		Vertex* vertices = nullptr;
+		unsigned int numVertices = 0;
+		unsigned int* indices = nullptr;
+		unsigned int numIndices = 0;
+	};
+
+	//At or above this many subdivisions, planes and spheres split their rows across worker threads
+	const int PROCGEN_PARALLEL_SUBDIVISIONS = 256;
+	//Icosphere subdivisions are clamped to [0, this], one more would overflow the 32 bit index count
+	const int ICOSPHERE_MAX_SUBDIVISIONS = 13;
+
+	MeshSize getCubeSize();
+	MeshSize getPlaneSize(int subdivisions);
+	MeshSize getSphereSize(int subdivisions);
+	MeshSize getCylinderSize(int subdivisions);
+	MeshSize getIcosphereSize(int subdivisions);
+
+	//Return a new MeshData
 	MeshData createCube(float size);
 	MeshData createPlane(float width, float height, int subdivisions);
 	MeshData createSphere(float radius, int subdivisions);
 	MeshData createCylinder(float radius, float height, int subdivisions);
+	MeshData createIcosphere(float radius, int subdivisions);
+
+	//Write into caller-owned memory. Return false without writing if the span is too small
+	bool createCube(float size, MeshSpan out);
+	bool createPlane(float width, float height, int subdivisions, MeshSpan out);
+	bool createSphere(float radius, int subdivisions, MeshSpan out);
+	bool createCylinder(float radius, float height, int subdivisions, MeshSpan out);
+	bool createIcosphere(float radius, int subdivisions, MeshSpan out);
+
+	//Refill an existing MeshData, reusing its capacity so repeated generation stops allocating
+	void createCube(float size, MeshData& mesh);
+	void createPlane(float width, float height, int subdivisions, MeshData& mesh);
+	void createSphere(float radius, int subdivisions, MeshData& mesh);
+	void createCylinder(float radius, float height, int subdivisions, MeshData& mesh);
+	void createIcosphere(float radius, int subdivisions, MeshData& mesh);
+
+	//Generates each radius/subdivision pair once and hands back the cached copy after that. Thread safe
+	const MeshData& getCachedIcosphere(float radius, int subdivisions);
+	void clearIcosphereCache();
 }
@@ -3,13 +3,130 @@
 */
 
 #include "shader.h"
+#include <chrono>
+#include <filesystem>
 #include <fstream>
 #include <sstream>
+#include <string.h>
+#include <vector>
 #include "external/glad.h"
+#include "GLState.h"
+#include "Trace.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 namespace ew {
+	static ShaderStats s_shaderStats;
+
+	ShaderStats getShaderStats() {
+		return s_shaderStats;
+	}
+	void resetShaderStats() {
+		s_shaderStats = ShaderStats();
+	}
+
+	static std::string s_shaderCacheDirectory = "shader_cache";
+	static ShaderCacheStats s_shaderCacheStats;
+
+	void setShaderCacheDirectory(const std::string& directory) {
+		s_shaderCacheDirectory = directory;
+	}
+	ShaderCacheStats getShaderCacheStats() {
+		return s_shaderCacheStats;
+	}
+
+	//Header in front of every cached program binary
+	struct ProgramBinaryHeader {
+		char magic[4] = { 'E', 'W', 'P', 'B' };
+		unsigned int version = 1;
+		unsigned int format = 0;
+		unsigned int length = 0;
+	};
+
+	static unsigned long long hashBytes(const char* data, size_t length, unsigned long long hash) {
+		//FNV-1a
+		for (size_t i = 0; i < length; i++) {
+			hash ^= (unsigned char)data[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+	static unsigned long long hashString(const char* str, unsigned long long hash) {
+		if (str == NULL) str = "";
+		//Include the terminator so "ab"+"c" and "a"+"bc" hash differently
+		return hashBytes(str, strlen(str) + 1, hash);
+	}
+
+	/// <summary>
+	/// Where the binary for this exact source/defines/driver combination lives. Empty if caching is off.
+	/// A driver update changes the version string, which moves every program to a new file.
+	/// </summary>
+	static std::string getProgramCachePath(const char* vertexShaderSource, const char* fragmentShaderSource, const char* defines) {
+		if (s_shaderCacheDirectory.empty())
+			return {};
+		unsigned long long hash = 14695981039346656037ull;
+		hash = hashString(vertexShaderSource, hash);
+		hash = hashString(fragmentShaderSource, hash);
+		hash = hashString(defines, hash);
+		hash = hashString((const char*)glGetString(GL_VENDOR), hash);
+		hash = hashString((const char*)glGetString(GL_RENDERER), hash);
+		hash = hashString((const char*)glGetString(GL_VERSION), hash);
+		char fileName[32];
+		snprintf(fileName, sizeof(fileName), "%016llx.bin", hash);
+		return s_shaderCacheDirectory + "/" + fileName;
+	}
+
+	/// <returns>A linked program, or 0 if there is no usable binary on disk.</returns>
+	static unsigned int loadCachedProgram(const std::string& path) {
+		std::ifstream file(path, std::ios::binary);
+		if (!file.is_open())
+			return 0;
+		ProgramBinaryHeader header, expected;
+		file.read((char*)&header, sizeof(header));
+		if (!file || memcmp(header.magic, expected.magic, 4) != 0 || header.version != expected.version)
+			return 0;
+		std::vector<char> binary(header.length);
+		file.read(binary.data(), header.length);
+		if (!file)
+			return 0;
+
+		unsigned int program = glCreateProgram();
+		glProgramBinary(program, header.format, binary.data(), header.length);
+		int success;
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		if (!success) {
+			//Drivers may reject binaries from older versions of themselves, recompiling will overwrite it
+			glDeleteProgram(program);
+			s_shaderCacheStats.rejected++;
+			return 0;
+		}
+		return program;
+	}
+
+	static void storeCachedProgram(const std::string& path, unsigned int program) {
+		int length = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0)
+			return;
+		ProgramBinaryHeader header;
+		std::vector<char> binary(length);
+		GLenum format = 0;
+		glGetProgramBinary(program, length, NULL, &format, binary.data());
+		header.format = format;
+		header.length = (unsigned int)length;
+
+		std::error_code error;
+		std::filesystem::create_directories(s_shaderCacheDirectory, error);
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			printf("Failed to write shader cache file %s", path.c_str());
+			return;
+		}
+		file.write((const char*)&header, sizeof(header));
+		file.write(binary.data(), length);
+		s_shaderCacheStats.written++;
+	}
+
 	/// <summary>
 	/// Loads shader source code from a file.
 	/// </summary>
@@ -37,8 +154,11 @@ namespace ew {
 		unsigned int shader = glCreateShader(shaderType);
 		//Supply the shader object with source code
 		glShaderSource(shader, 1, &sourceCode, NULL);
-		//Compile the shader object
+		//Compile the shader object. The status is checked in finishShaderProgram so drivers can compile in the background
 		glCompileShader(shader);
+		return shader;
+	}
+	static bool checkShaderCompiled(unsigned int shader) {
 		int success;
 		glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
 		if (!success) {
@@ -47,36 +167,123 @@ namespace ew {
 			glGetShaderInfoLog(shader, 512, NULL, infoLog);
 			printf("Failed to compile shader: %s", infoLog);
 		}
-		return shader;
+		return success;
+	}
+
+	//Not in the bundled glad, values from the GL_KHR_parallel_shader_compile spec
+	#define EW_GL_COMPLETION_STATUS_KHR 0x91B1
+
+	bool hasParallelShaderCompile() {
+		static int supported = -1;
+		if (supported < 0) {
+			supported = 0;
+			int numExtensions = 0;
+			glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+			for (int i = 0; i < numExtensions; i++) {
+				const char* name = (const char*)glGetStringi(GL_EXTENSIONS, i);
+				if (name != NULL && (strcmp(name, "GL_KHR_parallel_shader_compile") == 0 || strcmp(name, "GL_ARB_parallel_shader_compile") == 0)) {
+					supported = 1;
+					break;
+				}
+			}
+		}
+		return supported == 1;
 	}
 
 	/// <summary>
 	/// Creates a shader program with a vertex and fragment shader
 	/// </summary>
-	/// <param name="vertexShaderSource">GLSL source code for the vertex shader</param>
-	/// <param name="fragmentShaderSource">GLSL source code for the fragment shader</param>
-	/// <returns></returns>
-	unsigned int createShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource) {
-		unsigned int vertexShader = createShader(GL_VERTEX_SHADER, vertexShaderSource);
-		unsigned int fragmentShader = createShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
+	/// <param name="vertexShaderSource">Source code for vertex shader</param>
+	/// <param name="fragmentShaderSource">Source code for fragment shader</param>
+	/// <returns>Id of the shader program, or 0 if it failed to link</returns>
+	unsigned int createShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource, const char* defines) {
+		PendingProgram pending = beginShaderProgram(vertexShaderSource, fragmentShaderSource, defines);
+		return finishShaderProgram(pending);
+	}
+	PendingProgram beginShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource, const char* defines) {
+		VG3O_TRACE_SCOPE("ew::beginShaderProgram");
+		auto startTime = std::chrono::high_resolution_clock::now();
+		PendingProgram pending;
+
+		int numBinaryFormats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numBinaryFormats);
+		pending.cachePath = numBinaryFormats > 0 ? getProgramCachePath(vertexShaderSource, fragmentShaderSource, defines) : std::string();
+		if (!pending.cachePath.empty()) {
+			pending.program = loadCachedProgram(pending.cachePath);
+			if (pending.program != 0) {
+				s_shaderCacheStats.hits++;
+				s_shaderCacheStats.milliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+				pending.cachePath.clear();
+				return pending;
+			}
+			s_shaderCacheStats.misses++;
+		}
 
-		unsigned int shaderProgram = glCreateProgram();
+		std::string vertexSource = insertDefines(vertexShaderSource, defines);
+		std::string fragmentSource = insertDefines(fragmentShaderSource, defines);
+		pending.vertexShader = createShader(GL_VERTEX_SHADER, vertexSource.c_str());
+		pending.fragmentShader = createShader(GL_FRAGMENT_SHADER, fragmentSource.c_str());
+
+		pending.program = glCreateProgram();
+		//Ask the driver to keep the binary around so it can be cached
+		if (!pending.cachePath.empty())
+			glProgramParameteri(pending.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 		//Attach each stage
-		glAttachShader(shaderProgram, vertexShader);
-		glAttachShader(shaderProgram, fragmentShader);
+		glAttachShader(pending.program, pending.vertexShader);
+		glAttachShader(pending.program, pending.fragmentShader);
 		//Link all the stages together
-		glLinkProgram(shaderProgram);
+		glLinkProgram(pending.program);
+		s_shaderCacheStats.milliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+		return pending;
+	}
+	bool isShaderProgramReady(const PendingProgram& pending) {
+		//Cache hits are linked already
+		if (pending.vertexShader == 0 || !hasParallelShaderCompile())
+			return true;
+		int complete = 0;
+		glGetProgramiv(pending.program, EW_GL_COMPLETION_STATUS_KHR, &complete);
+		return complete != 0;
+	}
+	unsigned int finishShaderProgram(PendingProgram& pending) {
+		if (pending.vertexShader == 0)
+			return pending.program;
+		VG3O_TRACE_SCOPE("ew::finishShaderProgram");
+		auto startTime = std::chrono::high_resolution_clock::now();
+		checkShaderCompiled(pending.vertexShader);
+		checkShaderCompiled(pending.fragmentShader);
 		int success;
-		glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
+		glGetProgramiv(pending.program, GL_LINK_STATUS, &success);
 		if (!success) {
 			char infoLog[512];
-			glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
+			glGetProgramInfoLog(pending.program, 512, NULL, infoLog);
 			printf("Failed to link shader program: %s", infoLog);
+			glDeleteProgram(pending.program);
+			pending.program = 0;
+		}
+		else if (!pending.cachePath.empty()) {
+			storeCachedProgram(pending.cachePath, pending.program);
 		}
 		//The linked program now contains our compiled code, so we can delete these intermediate objects
-		glDeleteShader(vertexShader);
-		glDeleteShader(fragmentShader);
-		return shaderProgram;
+		glDeleteShader(pending.vertexShader);
+		glDeleteShader(pending.fragmentShader);
+		pending.vertexShader = pending.fragmentShader = 0;
+		s_shaderCacheStats.milliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+		return pending.program;
+	}
+	std::string insertDefines(const std::string& source, const std::string& defines)
+	{
+		if (defines.empty())
+			return source;
+		//GLSL requires #version to come first, so the defines go on the line after it
+		size_t versionPos = source.find("#version");
+		if (versionPos == std::string::npos)
+			return defines + source;
+		size_t lineEnd = source.find('\n', versionPos);
+		if (lineEnd == std::string::npos)
+			return source + "\n" + defines;
+		std::string result = source;
+		result.insert(lineEnd + 1, defines);
+		return result;
 	}
 	/// <summary>
 	/// Creates a shader instance with vertex + fragment stages
@@ -88,46 +295,172 @@ namespace ew {
 		std::string vertexShaderSource = ew::loadShaderSourceFromFile(vertexShader.c_str());
 		std::string fragmentShaderSource = ew::loadShaderSourceFromFile(fragmentShader.c_str());
 		m_id = ew::createShaderProgram(vertexShaderSource.c_str(), fragmentShaderSource.c_str());
+		reflect();
+	}
+	/// <summary>
+	/// Creates a shader instance with compile-time defines
+	/// </summary>
+	/// <param name="vertexShader">File path to vertex shader</param>
+	/// <param name="fragmentShader">File path to fragment shader</param>
+	/// <param name="defines">"NAME" or "NAME value" for each #define</param>
+	Shader::Shader(const std::string& vertexShader, const std::string& fragmentShader, const std::vector<std::string>& defines)
+	{
+		std::string defineBlock;
+		for (const std::string& define : defines)
+			defineBlock += "#define " + define + "\n";
+		std::string vertexShaderSource = ew::loadShaderSourceFromFile(vertexShader.c_str());
+		std::string fragmentShaderSource = ew::loadShaderSourceFromFile(fragmentShader.c_str());
+		m_id = ew::createShaderProgram(vertexShaderSource.c_str(), fragmentShaderSource.c_str(), defineBlock.c_str());
+		reflect();
+	}
+	Shader::Shader(unsigned int program)
+	{
+		m_id = program;
+		reflect();
+	}
+	void Shader::setProgram(unsigned int program)
+	{
+		if (program == m_id)
+			return;
+		glDeleteProgram(m_id);
+		m_id = program;
+		reflect();
+	}
+	/// <summary>
+	/// Caches the location of every active uniform and the index of every uniform block,
+	/// so setters never have to ask the driver again.
+	/// </summary>
+	void Shader::reflect()
+	{
+		m_uniformLocations.clear();
+		m_uniformBlocks.clear();
+		//Failed links leave program 0, which has nothing to ask about
+		if (m_id == 0)
+			return;
+
+		int numUniforms = 0, maxNameLength = 0;
+		glGetProgramiv(m_id, GL_ACTIVE_UNIFORMS, &numUniforms);
+		glGetProgramiv(m_id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+		std::string name(maxNameLength, '\0');
+		for (int i = 0; i < numUniforms; i++)
+		{
+			int length = 0, size = 0;
+			GLenum type;
+			glGetActiveUniform(m_id, i, maxNameLength, &length, &size, &type, &name[0]);
+			std::string uniformName = name.substr(0, length);
+			//Block members have no location
+			int location = glGetUniformLocation(m_id, uniformName.c_str());
+			s_shaderStats.locationLookups++;
+			if (location < 0) continue;
+			m_uniformLocations[uniformName] = location;
+			//Arrays are reported as "name[0]", also answer to plain "name" like glGetUniformLocation does
+			size_t bracket = uniformName.find("[0]");
+			if (bracket != std::string::npos && bracket + 3 == uniformName.size())
+				m_uniformLocations[uniformName.substr(0, bracket)] = location;
+		}
+
+		int numBlocks = 0;
+		glGetProgramiv(m_id, GL_ACTIVE_UNIFORM_BLOCKS, &numBlocks);
+		glGetProgramiv(m_id, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxNameLength);
+		name.assign(maxNameLength, '\0');
+		for (int i = 0; i < numBlocks; i++)
+		{
+			int length = 0;
+			glGetActiveUniformBlockName(m_id, i, maxNameLength, &length, &name[0]);
+			m_uniformBlocks[name.substr(0, length)] = (unsigned int)i;
+		}
+	}
+	UniformId Shader::getUniformId(const std::string& name) const
+	{
+		UniformId id;
+		auto it = m_uniformLocations.find(name);
+		if (it != m_uniformLocations.end())
+			id.location = it->second;
+		return id;
+	}
+	bool Shader::bindUniformBlock(const std::string& name, unsigned int binding) const
+	{
+		auto it = m_uniformBlocks.find(name);
+		if (it == m_uniformBlocks.end())
+			return false;
+		glUniformBlockBinding(m_id, it->second, binding);
+		return true;
 	}
 	void Shader::use()const
 	{
-		glUseProgram(m_id);
+		vg3o::GLState::useProgram(m_id);
+		s_shaderStats.programBinds++;
+	}
+	void Shader::setInt(UniformId id, int v) const
+	{
+		if (id.location < 0) return;
+		glUniform1i(id.location, v);
+		s_shaderStats.uniformCalls++;
+	}
+	void Shader::setFloat(UniformId id, float v) const
+	{
+		if (id.location < 0) return;
+		glUniform1f(id.location, v);
+		s_shaderStats.uniformCalls++;
+	}
+	void Shader::setVec2(UniformId id, const glm::vec2& v) const
+	{
+		if (id.location < 0) return;
+		glUniform2f(id.location, v.x, v.y);
+		s_shaderStats.uniformCalls++;
+	}
+	void Shader::setVec3(UniformId id, const glm::vec3& v) const
+	{
+		if (id.location < 0) return;
+		glUniform3f(id.location, v.x, v.y, v.z);
+		s_shaderStats.uniformCalls++;
+	}
+	void Shader::setVec4(UniformId id, const glm::vec4& v) const
+	{
+		if (id.location < 0) return;
+		glUniform4f(id.location, v.x, v.y, v.z, v.w);
+		s_shaderStats.uniformCalls++;
+	}
+	void Shader::setMat4(UniformId id, const glm::mat4& m) const
+	{
+		if (id.location < 0) return;
+		glUniformMatrix4fv(id.location, 1, GL_FALSE, glm::value_ptr(m));
+		s_shaderStats.uniformCalls++;
 	}
 	void Shader::setInt(const std::string& name, int v) const
 	{
-		glUniform1i(glGetUniformLocation(m_id, name.c_str()), v);
+		setInt(getUniformId(name), v);
 	}
 	void Shader::setFloat(const std::string& name, float v) const
 	{
-		glUniform1f(glGetUniformLocation(m_id, name.c_str()), v);
+		setFloat(getUniformId(name), v);
 	}
 	void Shader::setVec2(const std::string& name, float x, float y) const
 	{
-		glUniform2f(glGetUniformLocation(m_id, name.c_str()), x, y);
+		setVec2(getUniformId(name), glm::vec2(x, y));
 	}
 	void Shader::setVec2(const std::string& name, const glm::vec2& v) const
 	{
-		setVec2(name, v.x, v.y);
+		setVec2(getUniformId(name), v);
 	}
 	void Shader::setVec3(const std::string& name, float x, float y, float z) const
 	{
-		glUniform3f(glGetUniformLocation(m_id, name.c_str()), x, y, z);
+		setVec3(getUniformId(name), glm::vec3(x, y, z));
 	}
 	void Shader::setVec3(const std::string& name, const glm::vec3& v) const
 	{
-		setVec3(name, v.x, v.y, v.z);
+		setVec3(getUniformId(name), v);
 	}
 	void Shader::setVec4(const std::string& name, float x, float y, float z, float w) const
 	{
-		glUniform4f(glGetUniformLocation(m_id, name.c_str()), x, y, z, w);
+		setVec4(getUniformId(name), glm::vec4(x, y, z, w));
 	}
 	void Shader::setVec4(const std::string& name, const glm::vec4& v) const
 	{
-		setVec4(name, v.x, v.y, v.z, v.w);
+		setVec4(getUniformId(name), v);
 	}
 	void Shader::setMat4(const std::string& name, const glm::mat4& m) const
 	{
-		glUniformMatrix4fv(glGetUniformLocation(m_id, name.c_str()), 1, GL_FALSE, glm::value_ptr(m));
+		setMat4(getUniformId(name), m);
 	}
-}
-
+}
\ No newline at end of file
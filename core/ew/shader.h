@@ -4,15 +4,79 @@
 
 #pragma once
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include <glm/glm.hpp>
 
 namespace ew {
 	std::string loadShaderSourceFromFile(const std::string& filePath);
-	unsigned int createShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource);
+	unsigned int createShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource, const char* defines = "");
+	//A program whose compile and link were issued but not yet checked
+	struct PendingProgram {
+		unsigned int program = 0;
+		unsigned int vertexShader = 0; //0 once finished, or when the program came from the binary cache
+		unsigned int fragmentShader = 0;
+		std::string cachePath;
+	};
+	//Issues compile + link without asking for the result, so the driver can work while the frame continues
+	PendingProgram beginShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource, const char* defines = "");
+	//Never blocks when GL_KHR_parallel_shader_compile is available. Without it this is always true and finishing may stall
+	bool isShaderProgramReady(const PendingProgram& pending);
+	//Prints compile/link errors and caches the binary. Returns the program, or 0 if it failed
+	unsigned int finishShaderProgram(PendingProgram& pending);
+	bool hasParallelShaderCompile();
+
+	//Inserts lines of #defines right after the #version directive
+	std::string insertDefines(const std::string& source, const std::string& defines);
+
+	//Linked programs are saved here with glGetProgramBinary and reloaded on later launches. Empty string turns caching off
+	void setShaderCacheDirectory(const std::string& directory);
+
+	struct ShaderCacheStats {
+		unsigned int hits = 0; //Loaded from a cached binary
+		unsigned int misses = 0; //Compiled from source because nothing was cached
+		unsigned int rejected = 0; //Cached binary the driver refused, compiled from source instead
+		unsigned int written = 0;
+		double milliseconds = 0; //Total time spent in createShaderProgram
+	};
+	ShaderCacheStats getShaderCacheStats();
+
+	//A uniform location resolved ahead of time. Setters that take one skip the name lookup entirely
+	struct UniformId {
+		int location = -1;
+	};
+
+	//GL calls made through Shader, totalled across all shaders until reset
+	struct ShaderStats {
+		unsigned int uniformCalls = 0; //glUniform*
+		unsigned int locationLookups = 0; //glGetUniformLocation
+		unsigned int programBinds = 0; //glUseProgram
+	};
+	ShaderStats getShaderStats();
+	void resetShaderStats();
+
 	class Shader {
 	public:
 		Shader(const std::string& vertexShader, const std::string& fragmentShader);
+		//Each define is "NAME" or "NAME value" and is compiled into both stages
+		Shader(const std::string& vertexShader, const std::string& fragmentShader, const std::vector<std::string>& defines);
+		//Takes ownership of an already linked program
+		explicit Shader(unsigned int program);
+		//Replaces the program (e.g. after a hot reload) and rebuilds the uniform tables. The old program is deleted,
+		//so copies of this Shader must not outlive the swap. UniformIds fetched before it should be fetched again
+		void setProgram(unsigned int program);
 		void use()const;
+		//Resolved from the table built at link time. Inactive uniforms give an id with location -1, which setters ignore
+		UniformId getUniformId(const std::string& name) const;
+		//Points a uniform block at a binding point. Only needed for blocks without a layout(binding = N) qualifier
+		bool bindUniformBlock(const std::string& name, unsigned int binding) const;
+		inline unsigned int getId()const { return m_id; }
+		void setInt(UniformId id, int v) const;
+		void setFloat(UniformId id, float v) const;
+		void setVec2(UniformId id, const glm::vec2& v) const;
+		void setVec3(UniformId id, const glm::vec3& v) const;
+		void setVec4(UniformId id, const glm::vec4& v) const;
+		void setMat4(UniformId id, const glm::mat4& m) const;
 		void setInt(const std::string& name, int v) const;
 		void setFloat(const std::string& name, float v) const;
 		void setVec2(const std::string& name, float x, float y) const;
@@ -23,6 +87,9 @@ namespace ew {
 		void setVec4(const std::string& name, const glm::vec4& v) const;
 		void setMat4(const std::string& name, const glm::mat4& m) const;
 	private:
+		void reflect();
 		unsigned int m_id; //Shader program handle
+		std::unordered_map<std::string, int> m_uniformLocations; //Every active uniform, filled once after linking
+		std::unordered_map<std::string, unsigned int> m_uniformBlocks; //Active uniform block indices
 	};
 }
\ No newline at end of file
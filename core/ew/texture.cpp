@@ -5,6 +5,13 @@
 #include "texture.h"
 #include "external/glad.h"
 #include "external/stb_image.h"
+#include "GLState.h"
+#include "TextureFile.h"
+#include "Trace.h"
+#include <ctype.h>
+#include <chrono>
+#include <filesystem>
+#include <string>
 
 static int getTextureFormat(int numComponents) {
 	switch (numComponents) {
@@ -18,11 +25,93 @@ static int getTextureFormat(int numComponents) {
 		return GL_RED;
 	}
 }
+static bool hasExtension(const std::string& path, const char* extension) {
+	std::string pathExtension = std::filesystem::path(path).extension().string();
+	for (char& c : pathExtension) c = (char)tolower(c);
+	return pathExtension == extension;
+}
+
 namespace ew {
+	static TextureStats s_textureStats;
+
+	TextureStats getTextureStats() {
+		return s_textureStats;
+	}
+
+	/// <summary>
+	/// Uploads every level stored in the file, nothing is decoded or generated at runtime.
+	/// </summary>
+	static unsigned int loadCompressedTexture(const char* filePath, int wrapMode, int magFilter, int minFilter, bool mipmap) {
+		vg3o::CompressedImage image;
+		if (!vg3o::readDDS(filePath, image)) {
+			printf("Failed to load image %s\n", filePath);
+			return 0;
+		}
+		if (!vg3o::isTextureFormatSupported(image.format)) {
+			printf("Failed to load image %s, the driver has no S3TC support\n", filePath);
+			return 0;
+		}
+		size_t numLevels = mipmap ? image.levels.size() : 1;
+		unsigned int texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		unsigned int format = vg3o::getGLFormat(image.format);
+		for (size_t i = 0; i < numLevels; i++) {
+			const vg3o::CompressedLevel& level = image.levels[i];
+			glCompressedTexImage2D(GL_TEXTURE_2D, (int)i, format, level.width, level.height, 0, (int)level.size, image.data.data() + level.offset);
+			s_textureStats.gpuBytes += level.size;
+		}
+		//A file without a full chain would otherwise leave the texture incomplete under a mipmapped filter
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (int)numLevels - 1);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapMode);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapMode);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magFilter);
+
+		float borderColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+		glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
+
+		glBindTexture(GL_TEXTURE_2D, 0);
+		vg3o::GLState::invalidateTexture(0);
+		s_textureStats.numCompressed++;
+		return texture;
+	}
+
+	std::string resolveTexturePath(const std::string& filePath) {
+		if (isCompressedTexturePath(filePath))
+			return filePath;
+		//Prefer the cooked version if it was made from this source and the driver can sample its format
+		std::filesystem::path cooked = std::filesystem::path(filePath).replace_extension(".dds");
+		std::error_code error;
+		if (!std::filesystem::exists(cooked, error) || std::filesystem::last_write_time(cooked, error) < std::filesystem::last_write_time(filePath, error))
+			return filePath;
+		vg3o::CompressedImage header;
+		size_t dataOffset;
+		if (!vg3o::readDDSHeader(cooked.string(), header, dataOffset) || !vg3o::isTextureFormatSupported(header.format))
+			return filePath;
+		return cooked.string();
+	}
+	bool isCompressedTexturePath(const std::string& filePath) {
+		return hasExtension(filePath, ".dds");
+	}
+
 	unsigned int loadTexture(const char* filePath) {
 		return loadTexture(filePath, GL_REPEAT, GL_LINEAR, GL_LINEAR_MIPMAP_LINEAR, true);
 	}
 	unsigned int loadTexture(const char* filePath, int wrapMode, int magFilter, int minFilter, bool mipmap) {
+		VG3O_TRACE_SCOPE("ew::loadTexture");
+		vg3o::queryTextureFormats();
+		auto startTime = std::chrono::high_resolution_clock::now();
+		std::string path = resolveTexturePath(filePath);
+		if (isCompressedTexturePath(path)) {
+			unsigned int texture = loadCompressedTexture(path.c_str(), wrapMode, magFilter, minFilter, mipmap);
+			if (texture != 0) {
+				s_textureStats.numLoaded++;
+				s_textureStats.milliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+			}
+			return texture;
+		}
+
 		int width, height, numComponents;
 		unsigned char* data = stbi_load(filePath, &width, &height, &numComponents, 0);
 		if (data == NULL) {
@@ -49,7 +138,13 @@ namespace ew {
 		}
 
 		glBindTexture(GL_TEXTURE_2D, 0);
+		vg3o::GLState::invalidateTexture(0);
 		stbi_image_free(data);
+
+		size_t levelBytes = (size_t)width * height * (numComponents == 3 ? 4 : numComponents);
+		s_textureStats.gpuBytes += mipmap ? levelBytes * 4 / 3 : levelBytes;
+		s_textureStats.numLoaded++;
+		s_textureStats.milliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
 		return texture;
 	}
 }
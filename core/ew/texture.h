@@ -3,8 +3,24 @@
 */
 
 #pragma once
+#include <stddef.h>
+#include <string>
 
 namespace ew {
+	//.dds files are uploaded as-is with glCompressedTexImage2D. For anything else, a cooked .dds next to the
+	//source (same name, not older) is used instead when it exists, otherwise the image is decoded with stb_image
 	unsigned int loadTexture(const char* filePath);
 	unsigned int loadTexture(const char* filePath, int wrapMode, int magFilter, int minFilter, bool mipmap);
+	//The file loadTexture would actually read for this path, i.e. the cooked .dds when there is an up to date one
+	std::string resolveTexturePath(const std::string& filePath);
+	bool isCompressedTexturePath(const std::string& filePath);
+
+	//Totals for every loadTexture call
+	struct TextureStats {
+		unsigned int numLoaded = 0;
+		unsigned int numCompressed = 0; //Came from a .dds
+		double milliseconds = 0; //Decode/read + upload time
+		size_t gpuBytes = 0; //Estimated, including mips. Uncompressed RGB counts as 4 bytes per texel since drivers pad it
+	};
+	TextureStats getTextureStats();
 }
@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+"""
+compare.py // Brandon Salvietti
+
+Usage: compare.py baseline.json current.json [--threshold 0.05] [--stat p50]
+
+Compares two reports written by core_bench or assignment0 --headless, metric by metric. Only
+timings are checked, and for sampled metrics only the chosen statistic. A timing that grew by more
+than the threshold (a fraction, 0.05 is 5%) is a regression. Exits with 1 if there is one.
+"""
+
+import argparse
+import json
+import sys
+
+TIME_UNITS = {"ns", "us", "ms", "s"}
+STATS = ("avg", "p50", "p95", "p99", "max")
+
+
+def load_metrics(path):
+    with open(path) as file:
+        return json.load(file).get("metrics", {})
+
+
+def is_compared(name, unit, stat):
+    if unit not in TIME_UNITS:
+        return False
+    suffix = name.rsplit(".", 1)[-1]
+    # single measurements have no statistic suffix and are always compared
+    return suffix == stat or suffix not in STATS
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Flag timing regressions between two benchmark reports.")
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=0.05, help="allowed growth as a fraction (default 0.05)")
+    parser.add_argument("--stat", choices=STATS, default="p50", help="statistic compared for sampled metrics (default p50)")
+    args = parser.parse_args()
+
+    baseline = load_metrics(args.baseline)
+    current = load_metrics(args.current)
+
+    regressions = 0
+    improvements = 0
+    rows = []
+    for name in sorted(set(baseline) | set(current)):
+        old = baseline.get(name)
+        new = current.get(name)
+        if old is None or new is None:
+            metric = old or new
+            if is_compared(name, metric["unit"], args.stat):
+                rows.append((name, "only in " + ("baseline" if new is None else "current"), ""))
+            continue
+        if not is_compared(name, new["unit"], args.stat):
+            continue
+        if old["unit"] != new["unit"]:
+            rows.append((name, "unit changed %s -> %s" % (old["unit"], new["unit"]), ""))
+            continue
+        if old["value"] <= 0:
+            continue
+        change = new["value"] / old["value"] - 1.0
+        flag = ""
+        if change > args.threshold:
+            flag = "REGRESSION"
+            regressions += 1
+        elif change < -args.threshold:
+            flag = "faster"
+            improvements += 1
+        rows.append((name, "%.4g -> %.4g %s (%+.1f%%)" % (old["value"], new["value"], new["unit"], change * 100.0), flag))
+
+    width = max([len(row[0]) for row in rows] + [0])
+    for name, text, flag in rows:
+        print("%-*s  %s  %s" % (width, name, text, flag))
+    print("%d compared, %d regressions, %d faster beyond %.1f%%" % (len(rows), regressions, improvements, args.threshold * 100.0))
+    return 1 if regressions > 0 else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,558 @@
+/*
+	core_bench // Brandon Salvietti
+
+	Usage: core_bench [--filter text] [--samples N] [--textures N] [--out path]
+	Microbenchmarks for the CPU hot paths in core. Every benchmark is calibrated once to a batch that
+	takes at least a millisecond, then timed for N batches, and reported as nanoseconds per operation
+	(avg/p50/p95/p99/max) in the same JSON format as the assignment0 headless report. Mesh uploads
+	also report their p50 as MB/s.
+	Compare two runs with compare.py.
+
+	The model, mesh upload, draw submission and texture batch benchmarks need a GL context. It is made the same way as the headless
+	renderer, and those benchmarks are skipped if it can't be.
+
+	The texture batch benchmark loads --textures (500) hard links to one image once through
+	TextureRegistry and once serially through ew::loadTexture. Every copy stays resident until the
+	batch is done, so lower the count on a GPU with little memory.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ew/external/glad.h>
+#include <GLFW/glfw3.h>
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+
+#include <ew/Animation.h>
+#include <ew/BenchmarkReport.h>
+#include <ew/FKSolver.h>
+#include <ew/GeometryArena.h>
+#include <ew/MorphTargets.h>
+#include <ew/TextureRegistry.h>
+#include <ew/Trace.h>
+#include <ew/mesh.h>
+#include <ew/model.h>
+#include <ew/procGen.h>
+#include <ew/texture.h>
+#include <ew/transform.h>
+
+#include "referenceProcGen.h"
+
+#ifndef CORE_BENCH_ASSETS
+#define CORE_BENCH_ASSETS "assets/"
+#endif
+
+// results are folded in here so the optimizer can't drop the work being timed
+static volatile float s_sink = 0;
+
+struct BenchOptions {
+	std::string filter;
+	int samples = 30;
+	int textures = 500;
+	std::string outPath = "core_bench.json";
+};
+
+class BenchRunner {
+public:
+	BenchRunner(const BenchOptions& options, vg3o::BenchmarkReport& report) : mOptions(options), mReport(report) {}
+
+	/// <summary>
+	/// Times fn, which performs operationsPerCall operations, and reports nanoseconds per operation.
+	/// </summary>
+	/// <returns>The nanoseconds per operation, empty if the filter skipped it.</returns>
+	vg3o::SampleSummary run(const std::string& name, unsigned int operationsPerCall, const std::function<void()>& fn) {
+		if (!mOptions.filter.empty() && name.find(mOptions.filter) == std::string::npos)
+			return vg3o::SampleSummary();
+		// doubles the batch until it is long enough for the clock, once, so every sample runs the same work
+		unsigned int calls = 1;
+		fn();
+		while (calls < (1u << 24) && timeCalls(fn, calls) < 1e6)
+			calls *= 2;
+
+		std::vector<double> samples;
+		for (int i = 0; i < mOptions.samples; i++)
+			samples.push_back(timeCalls(fn, calls) / ((double)calls * operationsPerCall));
+		mReport.addSamples(name, samples, "ns");
+		vg3o::SampleSummary summary = vg3o::summarizeSamples(samples);
+		printf("%-48s %12.1f ns p50 %12.1f ns p95\n", name.c_str(), summary.p50, summary.p95);
+		mNumRun++;
+		return summary;
+	}
+
+	int getNumRun() const { return mNumRun; }
+	vg3o::BenchmarkReport& getReport() { return mReport; }
+private:
+	static double timeCalls(const std::function<void()>& fn, unsigned int calls) {
+		auto start = std::chrono::steady_clock::now();
+		for (unsigned int i = 0; i < calls; i++)
+			fn();
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	const BenchOptions& mOptions;
+	vg3o::BenchmarkReport& mReport;
+	int mNumRun = 0;
+};
+
+/*
+	----
+	Animation
+	----
+*/
+static void benchAnimation(BenchRunner& bench) {
+	const int clipSizes[] = { 2, 16, 128 };
+	const int animatorCounts[] = { 1, 64, 1024 };
+	for (int keys : clipSizes)
+	{
+		// Animation registers itself in a static list, the destructor takes it back out
+		vg3o::Animation* position = new vg3o::Animation();
+		vg3o::Animation* rotation = new vg3o::Animation();
+		vg3o::Animation* scale = new vg3o::Animation();
+		for (int i = 0; i < keys; i++)
+		{
+			float time = (float)i / (keys - 1);
+			vg3o::EasingStyle ease = (vg3o::EasingStyle)(i % 10);
+			position->AddKeyframe(vg3o::Keyframe(time, glm::vec3(time, 0, -time), ease));
+			rotation->AddKeyframe(vg3o::Keyframe(time, glm::vec3(0, time * 360.f, 0), ease));
+			scale->AddKeyframe(vg3o::Keyframe(time, glm::vec3(1.f + time), ease));
+		}
+		for (int count : animatorCounts)
+		{
+			std::vector<vg3o::Animator> animators(count);
+			for (int i = 0; i < count; i++)
+			{
+				animators[i].SetAnimation(position, 1);
+				animators[i].SetAnimation(rotation, 2);
+				animators[i].SetAnimation(scale, 3);
+				animators[i].Loop(true);
+				animators[i].Play();
+				animators[i].playbackTime = (float)i / count; // spread out so the keyframe search differs
+			}
+			bench.run("animator.update.keys" + std::to_string(keys) + ".animators" + std::to_string(count), count, [&]() {
+				for (vg3o::Animator& animator : animators)
+					s_sink = s_sink + animator.UpdateAnimations(1.0f / 240.0f).position.x;
+			});
+		}
+		delete position;
+		delete rotation;
+		delete scale;
+	}
+
+	// one two-key clip per style, the easing functions are only reachable through the animator
+	for (int style = 0; style < 10; style++)
+	{
+		for (int easeIn = 0; easeIn < 2; easeIn++)
+		{
+			vg3o::Animation* clip = new vg3o::Animation();
+			vg3o::Keyframe first(0.f, glm::vec3(0), (vg3o::EasingStyle)style);
+			first.easeIn = easeIn != 0;
+			clip->AddKeyframe(first);
+			clip->AddKeyframe(vg3o::Keyframe(1.f, glm::vec3(1)));
+			vg3o::Animator animator;
+			animator.SetAnimation(clip, 1);
+			animator.Loop(true);
+			animator.Play();
+			bench.run(std::string("ease.") + vg3o::EasingNames[style] + (easeIn ? ".in" : ".out"), 1, [&]() {
+				s_sink = s_sink + animator.UpdateAnimations(1.0f / 240.0f).position.x;
+			});
+			delete clip;
+		}
+	}
+}
+
+/*
+	----
+	Transforms
+	----
+*/
+static void benchTransforms(BenchRunner& bench) {
+	const int depths[] = { 4, 16, 64, 256 };
+	for (int depth : depths)
+	{
+		std::vector<vg3o::Joint> joints;
+		joints.reserve(depth);
+		for (int i = 0; i < depth; i++)
+		{
+			joints.push_back(vg3o::Joint("Joint " + std::to_string(i), glm::vec3(0, 1, 0), glm::vec3(0.1f, 0.2f, 0), glm::vec3(0.99f)));
+			joints[i].parent = i > 0 ? &joints[i - 1] : nullptr;
+			if (i > 0) joints[i - 1].children.push_back(&joints[i]);
+		}
+		vg3o::Skeleton skeleton;
+		skeleton.root = &joints[0];
+		bench.run("fk.solve.depth" + std::to_string(depth), 1, [&]() {
+			vg3o::SolveFK(&skeleton, nullptr);
+			s_sink = s_sink + joints.back().globalPose[3][1];
+		});
+	}
+
+	std::vector<ew::Transform> transforms(1024);
+	for (size_t i = 0; i < transforms.size(); i++)
+	{
+		transforms[i].position = glm::vec3((float)i, 0, -(float)i);
+		transforms[i].rotation = glm::quat(glm::vec3(0.01f * i, 0.02f * i, 0));
+		transforms[i].scale = glm::vec3(1.f + i * 0.001f);
+	}
+	bench.run("transform.modelMatrix", (unsigned int)transforms.size(), [&]() {
+		float sum = 0;
+		for (const ew::Transform& transform : transforms)
+		{
+			// reads rotation, scale and translation so none of it can be skipped
+			glm::mat4 m = transform.modelMatrix();
+			sum += m[0][0] + m[1][1] + m[2][2] + m[3][0];
+		}
+		s_sink = s_sink + sum;
+	});
+}
+
+/*
+	----
+	Procedural Meshes
+	----
+*/
+static void benchProcGen(BenchRunner& bench) {
+	// the refill overloads, so this is generation and not allocation
+	ew::MeshData mesh;
+	bench.run("procgen.cube", 1, [&]() { ew::createCube(1.f, mesh); });
+	const int subdivisions[] = { 16, 64, 256, 1024 };
+	for (int subdivision : subdivisions)
+	{
+		std::string suffix = ".s" + std::to_string(subdivision);
+		bench.run("procgen.plane" + suffix, 1, [&]() { ew::createPlane(1.f, 1.f, subdivision, mesh); });
+		bench.run("procgen.sphere" + suffix, 1, [&]() { ew::createSphere(1.f, subdivision, mesh); });
+		bench.run("procgen.cylinder" + suffix, 1, [&]() { ew::createCylinder(1.f, 1.f, subdivision, mesh); });
+	}
+	// against the original push_back generators, both returning by value so each pays for its own allocations
+	bench.run("procgen.reference.cube", 1, [&]() { s_sink = s_sink + (float)reference::createCube(1.f).vertices.size(); });
+	bench.run("procgen.byValue.cube", 1, [&]() { s_sink = s_sink + (float)ew::createCube(1.f).vertices.size(); });
+	for (int subdivision : subdivisions)
+	{
+		std::string suffix = ".s" + std::to_string(subdivision);
+		bench.run("procgen.reference.plane" + suffix, 1, [&]() { s_sink = s_sink + (float)reference::createPlane(1.f, 1.f, subdivision).vertices.size(); });
+		bench.run("procgen.byValue.plane" + suffix, 1, [&]() { s_sink = s_sink + (float)ew::createPlane(1.f, 1.f, subdivision).vertices.size(); });
+		bench.run("procgen.reference.sphere" + suffix, 1, [&]() { s_sink = s_sink + (float)reference::createSphere(1.f, subdivision).vertices.size(); });
+		bench.run("procgen.byValue.sphere" + suffix, 1, [&]() { s_sink = s_sink + (float)ew::createSphere(1.f, subdivision).vertices.size(); });
+		bench.run("procgen.reference.cylinder" + suffix, 1, [&]() { s_sink = s_sink + (float)reference::createCylinder(1.f, 1.f, subdivision).vertices.size(); });
+		bench.run("procgen.byValue.cylinder" + suffix, 1, [&]() { s_sink = s_sink + (float)ew::createCylinder(1.f, 1.f, subdivision).vertices.size(); });
+	}
+	// every level has four times the faces of the last
+	for (int subdivision = 0; subdivision <= 5; subdivision++)
+		bench.run("procgen.icosphere.s" + std::to_string(subdivision), 1, [&]() { ew::createIcosphere(1.f, subdivision, mesh); });
+
+	// eight targets each moving a quarter of a 64x64 sphere's vertices
+	ew::MeshData base = ew::createSphere(1.f, 64);
+	vg3o::MorphTargetSet morphTargets;
+	morphTargets.setBase(base);
+	std::vector<glm::vec3> positions(base.vertices.size()), normals(base.vertices.size());
+	for (int target = 0; target < 8; target++)
+	{
+		for (size_t i = 0; i < base.vertices.size(); i++)
+		{
+			bool moved = (i + target * base.vertices.size() / 8) % 4 == 0;
+			positions[i] = base.vertices[i].pos + (moved ? base.vertices[i].normal * 0.1f : glm::vec3(0));
+			normals[i] = base.vertices[i].normal;
+		}
+		int index = morphTargets.addTarget("Target " + std::to_string(target), positions.data(), normals.data());
+		morphTargets.setWeight(index, 0.5f);
+	}
+	ew::MeshData blended;
+	// evaluate() always does the full blend, only apply() skips clean sets, so no weight needs to change between runs
+	bench.run("morph.evaluate.targets8", 1, [&]() {
+		morphTargets.evaluate(blended);
+	});
+}
+
+/*
+	----
+	Trace
+	----
+*/
+static void benchTrace(BenchRunner& bench, vg3o::BenchmarkReport& report, const BenchOptions& options) {
+	if (!options.filter.empty() && std::string("trace.scope").find(options.filter) == std::string::npos)
+		return;
+	// measureOverhead() already averages a long loop, so its samples are taken directly
+	std::vector<double> idle, recording;
+	for (int i = 0; i < options.samples; i++)
+	{
+		vg3o::TraceOverhead overhead = vg3o::Trace::measureOverhead(100000);
+		idle.push_back(overhead.idleNanoseconds);
+		recording.push_back(overhead.recordingNanoseconds);
+	}
+	report.addSamples("trace.scope.idle", idle, "ns");
+	report.addSamples("trace.scope.recording", recording, "ns");
+	printf("%-48s %12.1f ns p50\n", "trace.scope.idle", vg3o::summarizeSamples(idle).p50);
+	printf("%-48s %12.1f ns p50\n", "trace.scope.recording", vg3o::summarizeSamples(recording).p50);
+}
+
+/*
+	----
+	Models
+	----
+*/
+static const char* const s_modelFiles[] = { "Suzanne.obj", "Suzanne.fbx" };
+
+static void benchModelConvert(BenchRunner& bench) {
+	for (const char* file : s_modelFiles)
+	{
+		// imported once, this times only the conversion processAiMesh does before uploading
+		Assimp::Importer importer;
+		const aiScene* scene = importer.ReadFile(std::string(CORE_BENCH_ASSETS) + file, aiProcess_Triangulate);
+		if (scene == nullptr)
+		{
+			printf("Skipping %s, could not import it from %s\n", file, CORE_BENCH_ASSETS);
+			continue;
+		}
+		ew::MeshData meshData;
+		std::vector<vg3o::MorphTargetSet> morphTargets(scene->mNumMeshes);
+		bench.run(std::string("model.convert.") + file, 1, [&]() {
+			for (unsigned int i = 0; i < scene->mNumMeshes; i++)
+				ew::convertAiMesh(scene->mMeshes[i], meshData, &morphTargets[i]);
+		});
+		bench.run(std::string("model.import.") + file, 1, [&]() {
+			Assimp::Importer timedImporter;
+			s_sink = s_sink + (timedImporter.ReadFile(std::string(CORE_BENCH_ASSETS) + file, aiProcess_Triangulate) != nullptr);
+		});
+	}
+}
+
+static void benchModelLoad(BenchRunner& bench) {
+	for (const char* file : s_modelFiles)
+	{
+		std::string path = std::string(CORE_BENCH_ASSETS) + file;
+		bench.run(std::string("model.load.") + file, 1, [&]() {
+			ew::Model model(path);
+			model.release();
+		});
+	}
+
+	// the upload sizes from the mesh streaming work, glFinish so the driver's copy is counted
+	const int megabytes[] = { 1, 16, 64 };
+	const ew::MeshUsage usages[] = { ew::MeshUsage::STATIC, ew::MeshUsage::DYNAMIC, ew::MeshUsage::STREAM };
+	const char* const usageNames[] = { "static", "dynamic", "stream" };
+	for (int size : megabytes)
+	{
+		ew::MeshData data;
+		data.vertices.resize((size_t)size * 1024 * 1024 / sizeof(ew::Vertex), ew::Vertex{ glm::vec3(0), glm::vec3(0, 1, 0), glm::vec2(0) });
+		data.indices.resize(3, 0);
+		for (int usage = 0; usage < 3; usage++)
+		{
+			ew::Mesh mesh(data, usages[usage]);
+			std::string name = "mesh.upload." + std::to_string(size) + "mb." + usageNames[usage];
+			vg3o::SampleSummary summary = bench.run(name, 1, [&]() {
+				mesh.load(data);
+				glFinish();
+			});
+			mesh.release();
+			if (summary.count == 0)
+				continue;
+			// the same p50 as bytes per second, from everything load() sends
+			double bytes = (double)(sizeof(ew::Vertex) * data.vertices.size() + sizeof(unsigned int) * data.indices.size());
+			double megabytesPerSecond = bytes / (1024.0 * 1024.0) / (summary.p50 * 1e-9);
+			bench.getReport().addMetric(name + ".bandwidth", megabytesPerSecond, "MB/s");
+			printf("%-48s %12.1f MB/s\n", (name + ".bandwidth").c_str(), megabytesPerSecond);
+		}
+	}
+}
+
+/*
+	----
+	Draw Submission
+	----
+*/
+static void benchSubmit(BenchRunner& bench) {
+	// the CPU cost of issuing draws: one VAO bind and draw per mesh, against the arena's one multi-draw.
+	// Nothing is rasterized, so the GPU never holds the submitting thread back
+	glEnable(GL_RASTERIZER_DISCARD);
+	ew::MeshData cube = ew::createCube(1.f);
+	const int meshCounts[] = { 16, 256, 4096 };
+	for (int count : meshCounts)
+	{
+		std::vector<ew::Mesh> ownMeshes, arenaMeshes;
+		for (int i = 0; i < count; i++)
+		{
+			ownMeshes.push_back(ew::Mesh(cube, ew::MeshUsage::STATIC));
+			arenaMeshes.push_back(ew::Mesh(cube, ew::MeshUsage::ARENA));
+		}
+		std::string suffix = ".meshes" + std::to_string(count);
+		bench.run("submit.perMesh" + suffix, count, [&]() {
+			for (const ew::Mesh& mesh : ownMeshes)
+				mesh.draw();
+			glFlush();
+		});
+		// the batch is rebuilt every call, like a pass whose contents change each frame
+		vg3o::IndirectBatch batch;
+		bench.run("submit.multiDraw" + suffix, count, [&]() {
+			batch.clear();
+			for (const ew::Mesh& mesh : arenaMeshes)
+				batch.add(mesh);
+			batch.submit();
+			glFlush();
+		});
+		for (ew::Mesh& mesh : ownMeshes)
+			mesh.release();
+		for (ew::Mesh& mesh : arenaMeshes)
+			mesh.release();
+	}
+	glFinish();
+	glDisable(GL_RASTERIZER_DISCARD);
+}
+
+/*
+	----
+	Texture Loading
+	----
+*/
+static void benchTextureBatch(vg3o::BenchmarkReport& report, const BenchOptions& options) {
+	if (!options.filter.empty() && std::string("texture.batch").find(options.filter) == std::string::npos)
+		return;
+	// distinct paths so the registry can't share one decode, links so the copies cost no disk space
+	namespace fs = std::filesystem;
+	std::error_code error;
+	fs::path source = fs::path(CORE_BENCH_ASSETS) / "brick_color.jpg";
+	fs::path directory = fs::temp_directory_path(error) / "core_bench_textures";
+	fs::create_directories(directory, error);
+	std::vector<std::string> paths;
+	for (int i = 0; i < options.textures; i++)
+	{
+		fs::path link = directory / ("brick" + std::to_string(i) + ".jpg");
+		fs::remove(link, error);
+		fs::create_hard_link(source, link, error);
+		if (error)
+			fs::copy_file(source, link, fs::copy_options::overwrite_existing, error);
+		if (error)
+		{
+			printf("Skipping texture.batch, could not make copies of %s in %s\n", source.string().c_str(), directory.string().c_str());
+			fs::remove_all(directory, error);
+			return;
+		}
+		paths.push_back(link.string());
+	}
+	// the links share one file, so reading it once puts both runs on a warm cache and neither pays for the disk
+	{
+		std::ifstream file(source, std::ios::binary);
+		std::vector<char> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		s_sink = s_sink + (float)contents.size();
+	}
+	// a batch is timed once, it takes seconds and repeats would only measure the same warm cache
+	std::string suffix = ".textures" + std::to_string(options.textures);
+	{
+		auto start = std::chrono::steady_clock::now();
+		vg3o::TextureRegistry registry;
+		std::vector<vg3o::TextureHandle> handles;
+		for (const std::string& path : paths)
+			handles.push_back(registry.load(path));
+		registry.finish();
+		glFinish();
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		vg3o::TextureRegistryStats stats = registry.getStats();
+		report.addMetric("texture.batch.registry" + suffix, milliseconds, "ms");
+		report.addMetric("texture.batch.registry.lastBatch" + suffix, stats.lastBatchMilliseconds, "ms");
+		printf("%-48s %12.1f ms (%.1f ms batch, %.1f ms decoding over all workers)\n", ("texture.batch.registry" + suffix).c_str(),
+			milliseconds, stats.lastBatchMilliseconds, stats.decodeMilliseconds);
+		handles.clear();
+		registry.update(); // frees the textures while the registry is still around
+	}
+	{
+		auto start = std::chrono::steady_clock::now();
+		std::vector<unsigned int> textures;
+		for (const std::string& path : paths)
+			textures.push_back(ew::loadTexture(path.c_str()));
+		glFinish();
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		report.addMetric("texture.batch.serial" + suffix, milliseconds, "ms");
+		printf("%-48s %12.1f ms\n", ("texture.batch.serial" + suffix).c_str(), milliseconds);
+		glDeleteTextures((int)textures.size(), textures.data());
+	}
+	fs::remove_all(directory, error);
+}
+
+// same context as assignment0's headless mode, nothing is ever shown
+static GLFWwindow* createContext() {
+	glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+	if (!glfwInit())
+		return nullptr;
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+	GLFWwindow* window = glfwCreateWindow(64, 64, "core_bench", NULL, NULL);
+	if (window == NULL)
+	{
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+		window = glfwCreateWindow(64, 64, "core_bench", NULL, NULL);
+	}
+	if (window == NULL)
+		return nullptr;
+	glfwMakeContextCurrent(window);
+	if (!gladLoadGL(glfwGetProcAddress))
+	{
+		glfwDestroyWindow(window);
+		return nullptr;
+	}
+	return window;
+}
+
+int main(int argc, char** argv) {
+	BenchOptions options;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) options.filter = argv[++i];
+		else if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) options.samples = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--textures") == 0 && i + 1 < argc) options.textures = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) options.outPath = argv[++i];
+		else
+		{
+			printf("Usage: core_bench [--filter text] [--samples N] [--textures N] [--out path]\n");
+			return 1;
+		}
+	}
+	if (options.samples < 1) options.samples = 1;
+	if (options.textures < 1) options.textures = 1;
+
+	vg3o::BenchmarkReport report;
+#ifdef NDEBUG
+	report.setInfo("build", "release");
+#else
+	report.setInfo("build", "debug");
+#endif
+	report.setInfo("samples", std::to_string(options.samples));
+	report.setInfo("hardware_threads", std::to_string(std::thread::hardware_concurrency()));
+
+	BenchRunner bench(options, report);
+	benchAnimation(bench);
+	benchTransforms(bench);
+	benchProcGen(bench);
+	benchTrace(bench, report, options);
+	benchModelConvert(bench);
+
+	GLFWwindow* window = createContext();
+	if (window != nullptr)
+	{
+		report.setInfo("renderer", (const char*)glGetString(GL_RENDERER));
+		benchModelLoad(bench);
+		benchSubmit(bench);
+		benchTextureBatch(report, options);
+		glfwDestroyWindow(window);
+		glfwTerminate();
+	}
+	else
+	{
+		report.setInfo("renderer", "none");
+		printf("No GL context, skipping model load, mesh upload, draw submission and texture batch benchmarks\n");
+	}
+
+	bool written = report.write(options.outPath);
+	printf("%d benchmarks, report %s %s\n", bench.getNumRun(), written ? "written to" : "failed to write to", options.outPath.c_str());
+	return written ? 0 : 1;
+}
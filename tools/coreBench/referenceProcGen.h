@@ -0,0 +1,15 @@
+/*
+*	Author: Eric Winebrenner
+*
+*	The original push_back generators, a baseline for core_bench's procgen benchmarks.
+*/
+
+#pragma once
+#include <ew/mesh.h>
+
+namespace reference {
+	ew::MeshData createCube(float size);
+	ew::MeshData createPlane(float width, float height, int subdivisions);
+	ew::MeshData createSphere(float radius, int subdivisions);
+	ew::MeshData createCylinder(float radius, float height, int subdivisions);
+}
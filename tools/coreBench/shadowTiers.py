@@ -0,0 +1,60 @@
+#!/usr/bin/env python3
+"""
+shadowTiers.py // Brandon Salvietti
+
+Usage: shadowTiers.py path/to/assignment0 [--frames 600] [--warmup 60] [--out dir]
+
+Runs assignment0 --headless once per SHADOW_FILTER tier and prints the Lit pass time of each, with
+the renderer that produced them, formatted for the header of lit.frag. The reports are kept in the
+output directory so they can be compared again with compare.py.
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+
+FETCHES = ("1 fetch", "4 fetches", "16 fetches", "32 fetches")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Time the Lit pass for every shadow filter tier.")
+    parser.add_argument("executable")
+    parser.add_argument("--frames", type=int, default=600)
+    parser.add_argument("--warmup", type=int, default=60)
+    parser.add_argument("--out", default=".", help="directory for the shadowN.json reports (default .)")
+    args = parser.parse_args()
+
+    executable = os.path.abspath(args.executable)
+    out = os.path.abspath(args.out)
+    os.makedirs(out, exist_ok=True)
+
+    rows = []
+    renderer = None
+    for tier in range(4):
+        report = os.path.join(out, "shadow%d.json" % tier)
+        command = [executable, "--headless", "--frames", str(args.frames), "--warmup", str(args.warmup),
+                   "--shadow-filter", str(tier), "--report", report]
+        # assets are loaded relative to the working directory, which is next to the executable
+        if subprocess.run(command, cwd=os.path.dirname(executable)).returncode != 0:
+            print("tier %d failed: %s" % (tier, " ".join(command)))
+            return 1
+        with open(report) as file:
+            data = json.load(file)
+        info = data.get("info", {})
+        metrics = data.get("metrics", {})
+        if "gpu.Lit.p50" not in metrics:
+            print("tier %d: no gpu.Lit.p50 in %s" % (tier, report))
+            return 1
+        renderer = "%s, %s timer, %s" % (info.get("renderer", "?"), info.get("gpu_timer", "?"), info.get("resolution", "?"))
+        rows.append((tier, metrics["gpu.Lit.p50"]["value"], metrics["gpu.Lit.p95"]["value"]))
+
+    print("//Lit pass on %s, %d frames:" % (renderer, args.frames))
+    for tier, p50, p95 in rows:
+        print("//  %d = %-10s %.3fms p50, %.3fms p95" % (tier, FETCHES[tier], p50, p95))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,47 @@
+/*
+	textureCooker // Brandon Salvietti
+
+	Usage: textureCooker [--bc1 | --bc3 | --bc7] [--no-mips] [--threads N] input... 
+	Each input is written next to itself with a .dds extension.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <ew/TextureCooker.h>
+
+int main(int argc, char** argv) {
+	vg3o::CookSettings settings;
+	std::vector<std::string> inputs;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--bc1") == 0) settings.format = vg3o::TextureFormat::BC1;
+		else if (strcmp(argv[i], "--bc3") == 0) settings.format = vg3o::TextureFormat::BC3;
+		else if (strcmp(argv[i], "--bc7") == 0) settings.format = vg3o::TextureFormat::BC7;
+		else if (strcmp(argv[i], "--no-mips") == 0) settings.mipmaps = false;
+		else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) settings.numThreads = (unsigned int)atoi(argv[++i]);
+		else inputs.push_back(argv[i]);
+	}
+	if (inputs.empty())
+	{
+		printf("Usage: textureCooker [--bc1 | --bc3 | --bc7] [--no-mips] [--threads N] input...\n");
+		return 1;
+	}
+
+	auto startTime = std::chrono::high_resolution_clock::now();
+	int failures = 0;
+	for (const std::string& input : inputs)
+	{
+		std::string output = std::filesystem::path(input).replace_extension(".dds").string();
+		if (!vg3o::cookTexture(input, output, settings))
+			failures++;
+	}
+	double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+	printf("Cooked %d of %d textures in %.1fms\n", (int)inputs.size() - failures, (int)inputs.size(), milliseconds);
+	return failures == 0 ? 0 : 1;
+}